@@ -16,13 +16,25 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <ppelib/ppelib-low-level.h>
 #include <ppelib/ppelib.h>
 
-int LLVMFuzzerTestOneInput(const uint8_t *buffer, size_t size) {
+typedef ppelib_handle *(*create_func)(const uint8_t *buffer, size_t size);
+
+static size_t buffer_read(void *userdata, size_t offset, uint8_t *buffer, size_t size) {
+	memcpy(buffer, (const uint8_t *)userdata + offset, size);
+	return size;
+}
+
+static ppelib_handle *create_from_reader(const uint8_t *buffer, size_t size) {
+	return ppelib_create_from_reader(buffer_read, (void *)buffer, size);
+}
+
+static void fuzz_create(const uint8_t *buffer, size_t size, create_func create) {
 	ppelib_handle *pe2 = NULL;
-	ppelib_handle *pe = ppelib_create_from_buffer(buffer, size);
+	ppelib_handle *pe = create(buffer, size);
 	if (ppelib_error()) {
 		printf("PPELib-Error: %s\n", ppelib_error());
 		goto out;
@@ -32,6 +44,8 @@ int LLVMFuzzerTestOneInput(const uint8_t *buffer, size_t size) {
 	//	ppelib_update_resource_table(pe);
 	//	ppelib_recalculate(pe);
 
+	ppelib_get_import_table(pe);
+
 	ppelib_dos_header *dos_header = ppelib_dos_header_get(pe);
 
 	ppelib_dos_header_delete_rich_table(dos_header);
@@ -59,5 +73,30 @@ int LLVMFuzzerTestOneInput(const uint8_t *buffer, size_t size) {
 out:
 	ppelib_destroy(pe);
 	ppelib_destroy(pe2);
+}
+
+static void fuzz_stream(const uint8_t *buffer, size_t size) {
+	ppelib_stream *stream = ppelib_stream_create();
+
+	// Odd sized pieces so state changes don't line up with chunk boundaries
+	enum ppelib_stream_state state = PPELIB_STREAM_MZ_SIGNATURE;
+	for (size_t offset = 0; offset < size && state < PPELIB_STREAM_DONE; offset += 509) {
+		state = ppelib_stream_feed(stream, buffer + offset, size - offset < 509 ? size - offset : 509);
+	}
+
+	if (ppelib_stream_finish(stream) == PPELIB_STREAM_DONE) {
+		ppelib_header_print(ppelib_header_get(ppelib_stream_get_handle(stream)));
+	}
+
+	ppelib_stream_destroy(stream);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *buffer, size_t size) {
+	fuzz_create(buffer, size, ppelib_create_from_buffer);
+	fuzz_create(buffer, size, ppelib_create_from_buffer_borrowed);
+	fuzz_create(buffer, size, ppelib_create_from_buffer_lazy);
+	fuzz_create(buffer, size, create_from_reader);
+	fuzz_stream(buffer, size);
+
 	return 0; // Non-zero return values are reserved for future use.
 }
@@ -109,6 +109,7 @@ def generate_extradata(structure):
     structure["pe_size"] = pe_size
     structure["peplus_size"] = peplus_size
     structure["common_size"] = common_size
+    structure["pe_variants"] = not all(field["common"] for field in structure["fields"])
     structure["max_sizes"] = max_sizes
 
 
@@ -25,46 +25,28 @@
 #include "generated/{{s.structure}}_private.h"
 
 size_t ppelib_{{s.structure}}_deserialize(const uint8_t* buffer, const size_t size, const size_t offset, {{s.structure}}_t* {{s.structure}}) {
-	ppelib_reset_error();
-
 	if (offset + {{s.common_size}} > size) {
 		ppelib_set_error("Not enough space for COFF headers");
 		return 0;
 	}
 
-	{{s.structure}}->modified = 0;
-
-	{% for field in s.fields -%}
-	{%- if field.common == True -%}
-	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + offset + {{field.pe_offset}});
-	{% endif -%}
-	{% endfor %}
+	{{s.structure}}_decode_common(buffer + offset, {{s.structure}});
 
 	if ({{s.structure}}->magic == PE32_MAGIC) {
 		if (offset + {{s.pe_size}} > size) {
 			ppelib_set_error("Not enough space for PE headers");
 			return 0;
 		}
-		{% for field in s.fields -%}
-		{%- if not field.common -%}
-		{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + offset + {{field.pe_offset}});
-		{% endif -%}
-		{%- endfor %}
+
+		{{s.structure}}_decode_pe(buffer + offset, {{s.structure}});
 		return {{s.pe_size}};
-	} else if ({{s.structure}}-> magic == PE32PLUS_MAGIC) {
+	} else if ({{s.structure}}->magic == PE32PLUS_MAGIC) {
 		if (offset + {{s.peplus_size}} > size) {
 			ppelib_set_error("Not enough space for PE+ headers");
 			return 0;
 		}
-		{% for field in s.fields -%}
-		{%- if not field.common and not field.pe_only-%}
-		{%- if field.peplus_type -%}
-		{{s.structure}}->{{field.struct_name}} = read_{{field.peplus_type}}(buffer + offset + {{field.peplus_offset}});
-		{% else -%}
-		{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + offset + {{field.peplus_offset}});
-		{% endif -%}
-		{% endif -%}
-		{% endfor %}
+
+		{{s.structure}}_decode_peplus(buffer + offset, {{s.structure}});
 		return {{s.peplus_size}};
 	} else {
 		ppelib_set_error("Unknown magic type");
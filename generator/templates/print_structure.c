@@ -47,13 +47,9 @@ EXPORT_SYM void ppelib_{{s.structure}}_fprint(FILE* stream, const {{s.structure}
 
 {%- for field in s.fields -%}
 {%- if field.getset_type == "string_name" %}
-	const char* {{field.struct_name}}_name = NULL;
 	uint32_t {{field.struct_name}}_index = 0;
-	if ({{s.structure}}->{{field.struct_name}}[0] == '/') {
-		{{field.struct_name}}_index = (uint32_t) atoi({{s.structure}}->{{field.struct_name}} + 1);
-		{{field.struct_name}}_name = string_table_get(&{{s.structure}}->pe->string_table, {{field.struct_name}}_index);
-		ppelib_reset_error();
-	}
+	const char* {{field.struct_name}}_name = string_table_resolve_name(&{{s.structure}}->pe->string_table, {{s.structure}}->{{field.struct_name}}, &{{field.struct_name}}_index);
+	ppelib_reset_error();
 	if ({{field.struct_name}}_name) {
 		fprintf(stream, "{{field.name}}: %s (%i)\n", {{field.struct_name}}_name, {{field.struct_name}}_index);
 	} else {
@@ -71,6 +71,53 @@ EXPORT_SYM const char* ppelib_{{s.structure}}_get_{{field.struct_name}}_string(c
 {% endif -%}
 {% endfor %}
 
+// Decoders for callers that already made sure the data is there. They don't
+// touch the error state.
+{% if not s.pe_variants -%}
+static inline void {{s.structure}}_decode(const uint8_t* buffer, {{s.structure}}_t* {{s.structure}}) {
+	{{s.structure}}->modified = 0;
+
+	{% for field in s.fields -%}
+	{% if field.getset_type == "string_name" -%}
+	memcpy({{s.structure}}->{{field.struct_name}}, buffer + {{field.pe_offset}}, 8);
+	{{s.structure}}->{{field.struct_name}}[8] = 0;
+	{% else -%}
+	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + {{field.pe_offset}});
+	{% endif -%}
+	{% endfor %}
+}
+{%- else -%}
+static inline void {{s.structure}}_decode_common(const uint8_t* buffer, {{s.structure}}_t* {{s.structure}}) {
+	{{s.structure}}->modified = 0;
+
+	{% for field in s.fields -%}
+	{%- if field.common == True -%}
+	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + {{field.pe_offset}});
+	{% endif -%}
+	{% endfor %}
+}
+
+static inline void {{s.structure}}_decode_pe(const uint8_t* buffer, {{s.structure}}_t* {{s.structure}}) {
+	{% for field in s.fields -%}
+	{%- if not field.common -%}
+	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + {{field.pe_offset}});
+	{% endif -%}
+	{%- endfor %}
+}
+
+static inline void {{s.structure}}_decode_peplus(const uint8_t* buffer, {{s.structure}}_t* {{s.structure}}) {
+	{% for field in s.fields -%}
+	{%- if not field.common and not field.pe_only-%}
+	{%- if field.peplus_type -%}
+	{{s.structure}}->{{field.struct_name}} = read_{{field.peplus_type}}(buffer + {{field.peplus_offset}});
+	{% else -%}
+	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + {{field.peplus_offset}});
+	{% endif -%}
+	{% endif -%}
+	{% endfor %}
+}
+{%- endif %}
+
 EXPORT_SYM size_t ppelib_{{s.structure}}_serialize(const {{s.structure}}_t* {{s.structure}}, uint8_t* buffer, const size_t offset);
 EXPORT_SYM size_t ppelib_{{s.structure}}_deserialize(const uint8_t* buffer, const size_t size, const size_t offset, {{s.structure}}_t* {{s.structure}});
 EXPORT_SYM void ppelib_{{s.structure}}_fprint(FILE* stream, const {{s.structure}}_t* {{s.structure}});
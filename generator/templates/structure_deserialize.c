@@ -27,23 +27,12 @@
 #include "generated/{{s.structure}}_private.h"
 
 size_t ppelib_{{s.structure}}_deserialize(const uint8_t* buffer, const size_t size, const size_t offset, {{s.structure}}_t* {{s.structure}}) {
-	ppelib_reset_error();
-
 	if (offset + {{s.common_size}} > size) {
 		ppelib_set_error("Not enough space for {{s.structure}} headers");
 		return 0;
 	}
 
-	{{s.structure}}->modified = 0;
-
-	{% for field in s.fields -%}
-	{% if field.getset_type == "string_name" -%}
-	memcpy({{s.structure}}->{{field.struct_name}}, buffer + offset + {{field.pe_offset}}, 8);
-	{{s.structure}}->{{field.struct_name}}[8] = 0;
-	{% else -%}
-	{{s.structure}}->{{field.struct_name}} = read_{{field.pe_type}}(buffer + offset + {{field.pe_offset}});
-	{% endif -%}
-	{% endfor %}
+	{{s.structure}}_decode(buffer + offset, {{s.structure}});
 
 	return {{s.common_size}};
 }
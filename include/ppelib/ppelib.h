@@ -32,14 +32,148 @@
 typedef struct ppelib_handle_s ppelib_handle;
 typedef struct ppelib_rich_table_s ppelib_rich_table;
 typedef struct ppelib_import_table_s ppelib_import_table;
+typedef struct ppelib_export_table_s ppelib_export_table;
+typedef struct ppelib_symbol_table_s ppelib_symbol_table;
+typedef struct ppelib_resource_table_s ppelib_resource_table;
+typedef struct ppelib_resource_directory_s ppelib_resource_directory;
+typedef struct ppelib_resource_builder_s ppelib_resource_builder;
+typedef struct ppelib_certificate_table_s ppelib_certificate_table;
+typedef struct ppelib_utf8_batch_s ppelib_utf8_batch;
+typedef struct ppelib_stream_s ppelib_stream;
+typedef struct ppelib_context_s ppelib_context;
+
+// Fill buffer with size bytes starting at offset, returns the number of bytes read.
+typedef size_t (*ppelib_read_func)(void *userdata, size_t offset, uint8_t *buffer, size_t size);
 
 const char *ppelib_error();
 
+// Context API
+// A context decides how the handles created from it allocate and parse. The errors
+// of creating them, writing them and loading their contents are reported through
+// ppelib_context_error() instead of ppelib_error(). A context may be shared by
+// handles that are all used from the same thread and has to outlive them.
+//
+// Memory parsed out of a file comes from the allocator, and so does the scratch
+// space for writing and hashing. Data that is modified afterwards gets its own
+// allocation from the C library.
+typedef struct ppelib_allocator {
+	void *(*malloc)(void *userdata, size_t size);
+	void *(*realloc)(void *userdata, void *buffer, size_t size);
+	void (*free)(void *userdata, void *buffer);
+	void *userdata;
+} ppelib_allocator;
+
+enum ppelib_parse_options {
+	// See ppelib_create_from_buffer_borrowed() and ppelib_create_from_file_mapped()
+	PPELIB_PARSE_BORROW = 1 << 0,
+	// See ppelib_create_from_buffer_lazy() and ppelib_create_from_file_lazy()
+	PPELIB_PARSE_LAZY = 1 << 1,
+};
+
+// allocator is copied, NULL uses the C library
+ppelib_context *ppelib_context_create(const ppelib_allocator *allocator, uint32_t parse_options);
+void ppelib_context_destroy(ppelib_context *context);
+// Error of the last call made on behalf of context, NULL if it succeeded
+const char *ppelib_context_error(const ppelib_context *context);
+ppelib_handle *ppelib_context_create_from_buffer(ppelib_context *context, const uint8_t *buffer, size_t size);
+ppelib_handle *ppelib_context_create_from_file(ppelib_context *context, const char *filename);
+// Always lazy, see ppelib_create_from_reader()
+ppelib_handle *ppelib_context_create_from_reader(ppelib_context *context, ppelib_read_func read, void *userdata,
+		size_t size);
+
 ppelib_handle *ppelib_create();
 ppelib_handle *ppelib_create_from_buffer(const uint8_t *buffer, size_t size);
+// Like ppelib_create_from_buffer() but references buffer instead of copying out of it.
+// buffer must stay valid and unchanged until ppelib_destroy(). Section contents, the
+// overlay and the DOS stub are only copied once they are modified.
+ppelib_handle *ppelib_create_from_buffer_borrowed(const uint8_t *buffer, size_t size);
+// Like ppelib_create_from_buffer_borrowed() but only parses the headers up front.
+// Section contents and the import table are looked at when they are first used.
+ppelib_handle *ppelib_create_from_buffer_lazy(const uint8_t *buffer, size_t size);
 ppelib_handle *ppelib_create_from_file(const char *filename);
+// Like ppelib_create_from_file() but memory maps the file instead of reading it.
+// Section contents and the overlay are only copied once they are modified.
+ppelib_handle *ppelib_create_from_file_mapped(const char *filename);
+// Like ppelib_create_from_file_mapped() but parses lazily, see ppelib_create_from_buffer_lazy().
+ppelib_handle *ppelib_create_from_file_lazy(const char *filename);
+// Parse a file of size bytes that can only be read piecewise. Only the headers are
+// read up front, section contents and the overlay are read when they are first used,
+// so read and userdata must stay valid until ppelib_destroy().
+ppelib_handle *ppelib_create_from_reader(ppelib_read_func read, void *userdata, size_t size);
+// Like ppelib_create_from_reader() reading from an open file descriptor with pread().
+// fd is not closed by ppelib_destroy().
+ppelib_handle *ppelib_create_from_fd(int fd);
 size_t ppelib_write_to_buffer(ppelib_handle *pe, const uint8_t *buffer, size_t size);
 size_t ppelib_write_to_file(ppelib_handle *pe, const char *filename);
+// Write the changes made to a handle back to the file it was parsed from, which must
+// still hold the same data. Only what changed is rewritten: header edits only touch
+// the headers, modified sections that still fit where they were are written in place
+// and anything that moved past the end of the section data is appended. Changes that
+// need the file rearranged fall back to ppelib_write_to_file().
+size_t ppelib_write_changes_to_file(ppelib_handle *pe, const char *filename);
+
+enum ppelib_digest_algorithm {
+	PPELIB_DIGEST_SHA1 = 1,
+	PPELIB_DIGEST_SHA256 = 2,
+};
+
+#define PPELIB_DIGEST_MAX_SIZE 32
+
+typedef struct ppelib_write_options {
+	// When set the Authenticode digest of the written file is stored in digest
+	uint32_t digest_algorithm;
+	uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+	// When set the checksum of the written file is computed, written to its header and
+	// stored in checksum. The handle keeps the checksum it had.
+	uint8_t update_checksum;
+	uint32_t checksum;
+} ppelib_write_options;
+
+size_t ppelib_write_to_buffer_with_options(ppelib_handle *pe, uint8_t *buffer, size_t size,
+		ppelib_write_options *options);
+size_t ppelib_write_to_file_with_options(ppelib_handle *pe, const char *filename, ppelib_write_options *options);
+// The Authenticode digest of the file ppelib_write_to_file() would write. It leaves out
+// the checksum, the certificate table data directory entry and the certificate table.
+// Returns the size of the digest, digest must hold PPELIB_DIGEST_MAX_SIZE bytes.
+size_t ppelib_authenticode_digest(ppelib_handle *pe, uint32_t algorithm, uint8_t *digest);
+// The same for a file in memory, without parsing it into a handle
+size_t ppelib_authenticode_digest_buffer(const uint8_t *buffer, size_t size, uint32_t algorithm, uint8_t *digest);
+// The PE checksum of the file ppelib_write_to_file() would write
+uint32_t ppelib_checksum(ppelib_handle *pe);
+uint32_t ppelib_checksum_buffer(const uint8_t *buffer, size_t size);
+// Whether the checksum in the header matches the file
+uint8_t ppelib_checksum_verify(ppelib_handle *pe);
+uint8_t ppelib_checksum_verify_buffer(const uint8_t *buffer, size_t size);
+// The page hash table of page hash signatures for the file ppelib_write_to_file() would
+// write. Each entry is a 4 byte file offset followed by the digest of the 4 KiB page
+// there: first the headers, then the section data in file order, and last the end of
+// the section data with a zero digest. Pages are hashed on number_of_threads threads,
+// 0 uses one per CPU, the table is the same either way. Returns the size of the table,
+// buffer may be NULL to only get that.
+size_t ppelib_page_hashes(ppelib_handle *pe, uint32_t algorithm, uint32_t number_of_threads, uint8_t *buffer,
+		size_t size);
+// Whether table is the page hash table of the handle
+uint8_t ppelib_page_hashes_verify(ppelib_handle *pe, uint32_t algorithm, uint32_t number_of_threads,
+		const uint8_t *table, size_t size);
+
+enum ppelib_marker {
+	PPELIB_MARKER_MZ = 1 << 0,
+	PPELIB_MARKER_PE = 1 << 1,
+	PPELIB_MARKER_RICH = 1 << 2,
+	PPELIB_MARKER_VLV = 1 << 3,
+};
+
+typedef struct ppelib_marker_match {
+	size_t offset;
+	uint32_t marker;
+} ppelib_marker_match;
+
+// Finds every occurrence of the markers, a mask of enum ppelib_marker, in one pass over
+// buffer. Useful for finding executables and signatures in overlays. The matches are in
+// file order, the first capacity of them are stored in matches. Returns the number of
+// matches.
+size_t ppelib_scan_markers(const uint8_t *buffer, size_t size, uint32_t markers, ppelib_marker_match *matches,
+		size_t capacity);
 
 void ppelib_destroy(ppelib_handle *pe);
 
@@ -49,7 +183,22 @@ void ppelib_set_overlay_data(ppelib_handle *handle, const uint8_t *buffer, size_
 
 const ppelib_data_directory *ppelib_data_directory_get(ppelib_handle *handle, uint32_t data_directory_index);
 
+// The section stays valid until a section is added to the handle
 const ppelib_section *ppelib_section_get(ppelib_handle *handle, uint16_t section_index);
+const uint8_t *ppelib_section_get_contents(const ppelib_section *section);
+size_t ppelib_section_get_contents_size(const ppelib_section *section);
+
+typedef struct ppelib_rva_location {
+	// NULL if no section holds the RVA
+	const ppelib_section *section;
+	// Offset of the RVA into the section's contents
+	size_t offset;
+	size_t file_offset;
+} ppelib_rva_location;
+
+// Look up count RVAs at once, returns how many of them are inside a section.
+// Runs of nearby RVAs are the cheapest to translate.
+size_t ppelib_translate_rvas(ppelib_handle *handle, const uint32_t *rvas, size_t count, ppelib_rva_location *locations);
 
 // DOS Stub API
 ppelib_dos_header *ppelib_dos_header_get(ppelib_handle *handle);
@@ -84,5 +233,251 @@ uint32_t ppelib_header_compare_non_volitile(ppelib_header *header1, ppelib_heade
 
 // Import table
 ppelib_import_table *ppelib_get_import_table(ppelib_handle *handle);
+void ppelib_import_table_fprint(FILE *stream, ppelib_import_table *import_table);
 void ppelib_import_table_print(ppelib_import_table *import_table);
+
+typedef struct ppelib_import {
+	const char *dll_name;
+	// NULL for imports by ordinal
+	const char *name;
+	uint16_t hint;
+	uint16_t ordinal;
+	// RVA of the import's slot in the Import Address Table
+	uint32_t import_address_table_rva;
+} ppelib_import;
+
+// Look an import up by DLL and symbol name, or by DLL and ordinal. DLL names are
+// compared case-insensitively and include their extension, symbol names are case
+// sensitive. Returns 1 and fills import, if not NULL, when the file has the import.
+// The first lookup builds an index over the table, after that lookups take
+// constant time.
+uint8_t ppelib_import_table_find(ppelib_import_table *import_table, const char *dll_name, const char *name,
+		ppelib_import *import);
+uint8_t ppelib_import_table_find_ordinal(ppelib_import_table *import_table, const char *dll_name, uint16_t ordinal,
+		ppelib_import *import);
+
+// Export table
+// Names and forwarders point into the section contents they were found in and stay
+// valid until that section is modified.
+typedef struct ppelib_export {
+	// NULL for lookups by ordinal
+	const char *name;
+	uint32_t ordinal;
+	// 0 for forwarders
+	uint32_t rva;
+	// "DLL.Symbol" or "DLL.#Ordinal" for exports forwarded to another DLL
+	const char *forwarder;
+} ppelib_export;
+
+ppelib_export_table *ppelib_get_export_table(ppelib_handle *handle);
+const char *ppelib_export_table_get_dll_name(ppelib_export_table *export_table);
+uint32_t ppelib_export_table_get_number_of_names(const ppelib_export_table *export_table);
+// Exports in name order, name_index is below ppelib_export_table_get_number_of_names()
+uint8_t ppelib_export_table_get_name(ppelib_export_table *export_table, uint32_t name_index, ppelib_export *export);
+// Binary search over the names. Return 1 and fill export, if not NULL, when found.
+uint8_t ppelib_export_table_find(ppelib_export_table *export_table, const char *name, ppelib_export *export);
+uint8_t ppelib_export_table_find_ordinal(ppelib_export_table *export_table, uint32_t ordinal, ppelib_export *export);
+
+// Resource table
+// Directories are decoded as they are reached, a lookup only decodes the directories
+// on its path. Names and data point into the section contents they were found in
+// and stay valid until that section is modified.
+typedef struct ppelib_resource_data {
+	// NULL if the data isn't inside a section
+	const uint8_t *data;
+	uint32_t rva;
+	uint32_t size;
+	uint32_t codepage;
+} ppelib_resource_data;
+
+typedef struct ppelib_resource_entry {
+	// name_length UTF-16LE code units, NULL for entries identified by id
+	const uint8_t *name;
+	uint16_t name_length;
+	uint32_t id;
+
+	// Entries lead to either a subdirectory or data
+	ppelib_resource_directory *directory;
+	ppelib_resource_data data;
+} ppelib_resource_entry;
+
+// Identifies an entry by name, compared case-insensitively, or by id when name is NULL
+typedef struct ppelib_resource_key {
+	// UTF-8
+	const char *name;
+	uint32_t id;
+} ppelib_resource_key;
+
+ppelib_resource_table *ppelib_get_resource_table(ppelib_handle *handle);
+// NULL for files without resources
+ppelib_resource_directory *ppelib_resource_table_get_root(ppelib_resource_table *resource_table);
+uint32_t ppelib_resource_directory_get_number_of_entries(const ppelib_resource_directory *directory);
+// Named entries come first, then the ones with ids
+uint8_t ppelib_resource_directory_get_entry(ppelib_resource_directory *directory, uint32_t entry_index,
+		ppelib_resource_entry *entry);
+// Return 1 and fill entry or data, if not NULL, when found. Ids are binary searched
+// like the loader does, so they have to be sorted.
+uint8_t ppelib_resource_directory_find(ppelib_resource_directory *directory, const ppelib_resource_key *key,
+		ppelib_resource_entry *entry);
+// The name of entry as NULL terminated UTF-8, unpaired surrogates become U+FFFD.
+// Returns the length of the name without the terminator, the name is only written
+// if buffer is larger than that. Entries with an id have an empty name.
+size_t ppelib_resource_entry_get_name_utf8(const ppelib_resource_entry *entry, char *buffer, size_t size);
+// Converts the names of every entry of directory into batch, in entry order
+uint8_t ppelib_resource_directory_get_names_utf8(ppelib_resource_directory *directory, ppelib_utf8_batch *batch);
+// Walk the type, name and language levels. Without a language the first one is used.
+uint8_t ppelib_resource_table_find(ppelib_resource_table *resource_table, const ppelib_resource_key *type,
+		const ppelib_resource_key *name, const ppelib_resource_key *language, ppelib_resource_data *data);
+void ppelib_resource_table_fprint(FILE *stream, ppelib_resource_table *resource_table);
+void ppelib_resource_table_print(ppelib_resource_table *resource_table);
+
+// UTF-16 conversion
+// Resource names are UTF-16LE. Runs of ASCII are converted with SSE2 or NEON where
+// available.
+// Converts length code units to NULL terminated UTF-8. Returns the length without
+// the terminator, buffer is only written if it is larger than that.
+size_t ppelib_utf16_to_utf8(const uint8_t *utf16, size_t length, char *buffer, size_t size);
+// Converts utf8 to UTF-16LE. Returns the number of code units, buffer is only
+// written if size bytes hold all of them.
+size_t ppelib_utf8_to_utf16(const char *utf8, uint8_t *buffer, size_t size);
+// A batch holds the strings of its last conversion. Its memory is kept for the next
+// one, so converting directory after directory stops allocating once the largest
+// has been seen. Strings stay valid until the batch is used again.
+ppelib_utf8_batch *ppelib_utf8_batch_create();
+void ppelib_utf8_batch_destroy(ppelib_utf8_batch *batch);
+size_t ppelib_utf8_batch_get_size(const ppelib_utf8_batch *batch);
+// NULL for entries identified by id
+const char *ppelib_utf8_batch_get(const ppelib_utf8_batch *batch, size_t string_index);
+
+// Resource builder
+// Collects resources and serializes them into a resource table. Data and names are
+// referenced, not copied, and have to stay valid until the builder is written.
+// Names given as keys are converted to UTF-16 and kept by the builder. Entries are
+// matched the same way lookups match them, adding an existing one replaces it.
+ppelib_resource_builder *ppelib_resource_builder_create();
+// Like ppelib_resource_builder_create() but allocates through context, which has to
+// outlive the builder
+ppelib_resource_builder *ppelib_context_resource_builder_create(ppelib_context *context);
+void ppelib_resource_builder_destroy(ppelib_resource_builder *builder);
+uint8_t ppelib_resource_builder_add(ppelib_resource_builder *builder, const ppelib_resource_key *type,
+		const ppelib_resource_key *name, uint32_t language, const uint8_t *data, uint32_t size, uint32_t codepage);
+// Add every entry of resource_table, its data stays in the sections of its file
+uint8_t ppelib_resource_builder_add_table(ppelib_resource_builder *builder, ppelib_resource_table *resource_table);
+// Size of the serialized table, 0 on error
+size_t ppelib_resource_builder_get_size(ppelib_resource_builder *builder);
+// Serialize the table for placement at rva. Returns the number of bytes written, 0
+// if buffer is too small.
+size_t ppelib_resource_builder_write(ppelib_resource_builder *builder, uint8_t *buffer, size_t size, uint32_t rva);
+// Replace the resource table of handle. The section holding the current table is
+// resized to fit, files without one get a new ".rsrc" section. Tables retrieved from
+// handle before are invalid afterwards.
+uint8_t ppelib_set_resource_table(ppelib_handle *handle, ppelib_resource_builder *builder);
+
+// Certificate table
+// Certificates point into the overlay and stay valid until it is modified, or until
+// the handle is written over the file it was mapped from. Get the table again after.
+typedef struct ppelib_certificate {
+	uint32_t length;
+	uint16_t revision;
+	// WIN_CERT_TYPE_*
+	uint16_t certificate_type;
+	const uint8_t *data;
+	size_t size;
+} ppelib_certificate;
+
+typedef struct ppelib_span {
+	const uint8_t *data;
+	size_t size;
+} ppelib_span;
+
+// The first signer of a PKCS#7 signature. Everything points into the certificate,
+// fields that aren't in the signature are empty.
+typedef struct ppelib_signer {
+	// DER encoded Names, tag and length included. The subject is taken from the
+	// signer's certificate if the signature carries it.
+	ppelib_span subject;
+	ppelib_span issuer;
+	// Contents of the INTEGER, big endian
+	ppelib_span serial;
+	// Contents of the OID, and PPELIB_DIGEST_* for it or 0 for other algorithms
+	ppelib_span digest_algorithm;
+	uint32_t digest;
+	// Contents of the UTCTime or GeneralizedTime, signed by the signer, a
+	// countersignature or an RFC 3161 timestamp
+	ppelib_span signing_time;
+	// The digest ppelib_authenticode_digest() computes for the signed file
+	ppelib_span image_digest;
+	uint32_t image_digest_algorithm;
+} ppelib_signer;
+
+ppelib_certificate_table *ppelib_get_certificate_table(ppelib_handle *handle);
+uint32_t ppelib_certificate_table_get_size(const ppelib_certificate_table *certificate_table);
+uint8_t ppelib_certificate_table_get(const ppelib_certificate_table *certificate_table, uint32_t certificate_index,
+		ppelib_certificate *certificate);
+// Walks the DER encoding in place, nothing is allocated or copied
+uint8_t ppelib_certificate_get_signer(const ppelib_certificate *certificate, ppelib_signer *signer);
+uint32_t ppelib_has_signature(ppelib_handle *handle);
+// Remove the certificate table from the overlay and its data directory entry
+void ppelib_signature_remove(ppelib_handle *handle);
+
+// COFF symbol table
+// Symbols are numbered in table order without their auxiliary records. The table
+// is read from the file on the first ppelib_get_symbol_table(), MinGW keeps it in
+// the overlay so it is gone once the overlay is replaced.
+typedef struct ppelib_symbol {
+	// NULL if the name isn't in the string table
+	const char *name;
+	// Offset into the section for symbols that belong to one
+	uint32_t value;
+	// 1-based, 0 for undefined symbols, 0xFFFF for absolute and 0xFFFE for debug symbols
+	uint16_t section_number;
+	uint16_t type;
+	uint8_t storage_class;
+	uint8_t number_of_aux_symbols;
+	// Index of the symbol's record, the way relocations refer to it
+	uint32_t record_index;
+	// number_of_aux_symbols records of 18 bytes each, NULL without any
+	const uint8_t *aux;
+} ppelib_symbol;
+
+ppelib_symbol_table *ppelib_get_symbol_table(ppelib_handle *handle);
+uint32_t ppelib_symbol_table_get_size(const ppelib_symbol_table *symbol_table);
+uint8_t ppelib_symbol_table_get(ppelib_symbol_table *symbol_table, uint32_t symbol_index, ppelib_symbol *symbol);
+// Return 1 and fill symbol, if not NULL, when found. The first lookup of each
+// kind builds an index over the table.
+// Hashed lookup of the first symbol in table order called name
+uint8_t ppelib_symbol_table_find(ppelib_symbol_table *symbol_table, const char *name, ppelib_symbol *symbol);
+// The symbol of section_number with the highest value at or below value, which is
+// the function holding the address in code sections
+uint8_t ppelib_symbol_table_find_address(ppelib_symbol_table *symbol_table, uint16_t section_number, uint32_t value,
+		ppelib_symbol *symbol);
+// Like ppelib_symbol_table_find_address() for the section holding rva
+uint8_t ppelib_symbol_table_find_rva(ppelib_symbol_table *symbol_table, uint32_t rva, ppelib_symbol *symbol);
+// Indexes of the symbols of section_number with values in [low, high) in address
+// order. Stores at most max of them and returns how many there are.
+size_t ppelib_symbol_table_find_range(ppelib_symbol_table *symbol_table, uint16_t section_number, uint32_t low,
+		uint32_t high, uint32_t *symbol_indexes, size_t max);
+
+// Push parser API
+// Feed a file as it arrives. Every call reports what the parser is waiting for,
+// once it reaches PPELIB_STREAM_DONE the headers are available as a handle that
+// belongs to the stream. Section contents aren't kept, so that handle can be
+// inspected but not written.
+enum ppelib_stream_state {
+	PPELIB_STREAM_MZ_SIGNATURE = 0,
+	PPELIB_STREAM_DOS_HEADER = 1,
+	PPELIB_STREAM_PE_HEADER = 2,
+	PPELIB_STREAM_SECTION_TABLE = 3,
+	PPELIB_STREAM_DONE = 4,
+	PPELIB_STREAM_ERROR = 5,
+};
+
+ppelib_stream *ppelib_stream_create();
+void ppelib_stream_destroy(ppelib_stream *stream);
+enum ppelib_stream_state ppelib_stream_feed(ppelib_stream *stream, const uint8_t *buffer, size_t size);
+// Signal the end of the data. Only matters for files smaller than a page.
+enum ppelib_stream_state ppelib_stream_finish(ppelib_stream *stream);
+// Minimum number of bytes needed before the parser can move on
+size_t ppelib_stream_get_needed(const ppelib_stream *stream);
+ppelib_handle *ppelib_stream_get_handle(ppelib_stream *stream);
 #endif /* PPELIB_H_ */
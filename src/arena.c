@@ -0,0 +1,176 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "platform.h"
+#include "utils.h"
+
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGNMENT 16
+
+struct arena_block {
+	arena_block_t *next;
+	size_t size;
+	size_t used;
+	uint8_t *data;
+};
+
+static const allocator_t *arena_allocator(const arena_t *arena) {
+	return arena->allocator ? arena->allocator : &default_allocator;
+}
+
+static arena_block_t *block_create(const arena_t *arena, size_t size) {
+	const allocator_t *allocator = arena_allocator(arena);
+	arena_block_t *block = allocator->malloc(allocator->userdata, TO_NEAREST(sizeof(arena_block_t), ARENA_ALIGNMENT) + size);
+	if (!block) {
+		return NULL;
+	}
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	block->data = (uint8_t *)block + TO_NEAREST(sizeof(arena_block_t), ARENA_ALIGNMENT);
+
+	return block;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+	if (size > SIZE_MAX / 2) {
+		return NULL;
+	}
+
+	size = TO_NEAREST(MAX(size, 1), ARENA_ALIGNMENT);
+
+	arena_block_t *current = arena->blocks;
+	if (current && current->size - current->used >= size) {
+		void *retval = current->data + current->used;
+		current->used += size;
+
+		return retval;
+	}
+
+	if (size > ARENA_BLOCK_SIZE / 4) {
+		// Big allocations get their own block, behind the current one so it can
+		// keep serving small ones.
+		arena_block_t *block = block_create(arena, size);
+		if (!block) {
+			return NULL;
+		}
+
+		block->used = size;
+		if (current) {
+			block->next = current->next;
+			current->next = block;
+		} else {
+			arena->blocks = block;
+		}
+
+		return block->data;
+	}
+
+	// Blocks grow with the arena so large files don't end up with lots of them
+	size_t block_size = ARENA_BLOCK_SIZE;
+	if (arena->block_size) {
+		block_size = MIN(arena->block_size * 2, (size_t)ARENA_BLOCK_SIZE * 64);
+	}
+
+	arena_block_t *block = block_create(arena, block_size);
+	if (!block) {
+		return NULL;
+	}
+
+	arena->block_size = block_size;
+	block->next = current;
+	block->used = size;
+	arena->blocks = block;
+
+	return block->data;
+}
+
+void *arena_calloc(arena_t *arena, size_t size) {
+	void *retval = arena_alloc(arena, size);
+	if (retval) {
+		memset(retval, 0, size);
+	}
+
+	return retval;
+}
+
+// Grows the last allocation in place, anything else is copied. The old copy stays
+// around until the arena is freed.
+void *arena_realloc(arena_t *arena, void *buffer, size_t old_size, size_t size) {
+	arena_block_t *current = arena->blocks;
+	size_t old_aligned = TO_NEAREST(old_size, ARENA_ALIGNMENT);
+	size_t new_aligned = TO_NEAREST(MAX(size, 1), ARENA_ALIGNMENT);
+
+	if (buffer && current && (uint8_t *)buffer + old_aligned == current->data + current->used &&
+			current->used - old_aligned + new_aligned <= current->size) {
+		current->used = current->used - old_aligned + new_aligned;
+		return buffer;
+	}
+
+	void *retval = arena_alloc(arena, size);
+	if (retval && buffer) {
+		memcpy(retval, buffer, MIN(old_size, size));
+	}
+
+	return retval;
+}
+
+char *arena_strndup(arena_t *arena, const char *string, size_t size) {
+	char *retval = arena_alloc(arena, size + 1);
+	if (!retval) {
+		return NULL;
+	}
+
+	memcpy(retval, string, size);
+	retval[size] = 0;
+
+	return retval;
+}
+
+uint8_t arena_contains(const arena_t *arena, const void *buffer) {
+	if (!buffer) {
+		return 0;
+	}
+
+	for (const arena_block_t *block = arena->blocks; block; block = block->next) {
+		uintptr_t start = (uintptr_t)block->data;
+		if ((uintptr_t)buffer >= start && (uintptr_t)buffer < start + block->size) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void arena_free(arena_t *arena) {
+	const allocator_t *allocator = arena_allocator(arena);
+	arena_block_t *block = arena->blocks;
+	while (block) {
+		arena_block_t *next = block->next;
+		allocator->free(allocator->userdata, block);
+		block = next;
+	}
+
+	arena->blocks = NULL;
+}
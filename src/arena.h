@@ -0,0 +1,44 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_ARENA_H_
+#define PPELIB_ARENA_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "context.h"
+
+typedef struct arena_block arena_block_t;
+
+// Everything parsed out of a file lives as long as its handle. It is carved out
+// of a few large blocks that are all released at once by arena_free().
+typedef struct arena {
+	arena_block_t *blocks;
+	size_t block_size;
+	// Blocks come from here, default_allocator when NULL
+	const allocator_t *allocator;
+} arena_t;
+
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_calloc(arena_t *arena, size_t size);
+void *arena_realloc(arena_t *arena, void *buffer, size_t old_size, size_t size);
+char *arena_strndup(arena_t *arena, const char *string, size_t size);
+uint8_t arena_contains(const arena_t *arena, const void *buffer);
+void arena_free(arena_t *arena);
+
+#endif /* PPELIB_ARENA_H_ */
@@ -0,0 +1,165 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <ppelib/ppelib-constants.h>
+
+#include "authenticode.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "utils.h"
+
+#include "generated/dos_header_private.h"
+#include "generated/header_private.h"
+
+static void excluded_add(authenticode_t *authenticode, size_t start, size_t size) {
+	if (!size) {
+		return;
+	}
+
+	uint8_t i = authenticode->number_of_excluded++;
+	for (; i && authenticode->excluded_start[i - 1] > start; --i) {
+		authenticode->excluded_start[i] = authenticode->excluded_start[i - 1];
+		authenticode->excluded_end[i] = authenticode->excluded_end[i - 1];
+	}
+
+	authenticode->excluded_start[i] = start;
+	authenticode->excluded_end[i] = start + size;
+}
+
+size_t authenticode_init(authenticode_t *authenticode, uint32_t algorithm, const authenticode_ranges_t *ranges) {
+	memset(authenticode, 0, sizeof(authenticode_t));
+
+	authenticode->digest_size = digest_init(&authenticode->digest, algorithm);
+	if (!authenticode->digest_size) {
+		return 0;
+	}
+
+	excluded_add(authenticode, ranges->checksum_offset, 4);
+	if (ranges->directory_offset) {
+		excluded_add(authenticode, ranges->directory_offset, DATA_DIRECTORY_SIZE);
+	}
+	if (ranges->table_size && ranges->table_offset <= SIZE_MAX - ranges->table_size) {
+		excluded_add(authenticode, ranges->table_offset, ranges->table_size);
+	}
+
+	return authenticode->digest_size;
+}
+
+void authenticode_update(authenticode_t *authenticode, const uint8_t *data, size_t size) {
+	size_t start = authenticode->position;
+	size_t end = start + size;
+	size_t cursor = start;
+
+	for (uint8_t i = 0; i < authenticode->number_of_excluded && cursor < end; ++i) {
+		size_t excluded_start = authenticode->excluded_start[i];
+		size_t excluded_end = authenticode->excluded_end[i];
+		if (excluded_end <= cursor) {
+			continue;
+		}
+
+		if (excluded_start >= end) {
+			break;
+		}
+
+		if (excluded_start > cursor) {
+			digest_update(&authenticode->digest, data + (cursor - start), excluded_start - cursor);
+		}
+
+		cursor = MIN(excluded_end, end);
+	}
+
+	if (cursor < end) {
+		digest_update(&authenticode->digest, data + (cursor - start), end - cursor);
+	}
+
+	authenticode->position = end;
+}
+
+void authenticode_final(authenticode_t *authenticode, uint8_t *digest) {
+	digest_final(&authenticode->digest, digest);
+}
+
+uint8_t authenticode_ranges_from_buffer(const uint8_t *buffer, size_t size, authenticode_ranges_t *ranges) {
+	memset(ranges, 0, sizeof(authenticode_ranges_t));
+
+	if (size < DOS_HEADER_SIZE + 2 || read_uint16_t(buffer) != MZ_SIGNATURE) {
+		ppelib_set_error("Not a PE file (MZ signature missing)");
+		return 0;
+	}
+
+	size_t pe_header_offset = read_uint32_t(buffer + 0x3C);
+	size_t optional_header = pe_header_offset + 4 + COFF_HEADER_SIZE;
+	if (pe_header_offset > size - 4 || read_uint32_t(buffer + pe_header_offset) != PE_SIGNATURE) {
+		ppelib_set_error("Not a PE file (PE signature missing)");
+		return 0;
+	}
+
+	if (optional_header > size || size - optional_header < OPTIONAL_HEADER_CHECKSUM + 4) {
+		ppelib_set_error("Optional header outside of file");
+		return 0;
+	}
+
+	ranges->checksum_offset = optional_header + OPTIONAL_HEADER_CHECKSUM;
+
+	size_t number_of_rva_and_sizes = optional_header + OPTIONAL_HEADER_NUMBER_OF_RVA_AND_SIZES;
+	size_t data_directories = optional_header + OPTIONAL_HEADER_DATA_DIRECTORIES;
+	if (read_uint16_t(buffer + optional_header) == PE32PLUS_MAGIC) {
+		number_of_rva_and_sizes = optional_header + OPTIONAL_HEADER_PLUS_NUMBER_OF_RVA_AND_SIZES;
+		data_directories = optional_header + OPTIONAL_HEADER_PLUS_DATA_DIRECTORIES;
+	}
+
+	size_t directory = data_directories + DIR_CERTIFICATE_TABLE * DATA_DIRECTORY_SIZE;
+	if (directory + DATA_DIRECTORY_SIZE > size || read_uint32_t(buffer + number_of_rva_and_sizes) <= DIR_CERTIFICATE_TABLE) {
+		return 1;
+	}
+
+	// The certificate table entry holds a file offset, not an RVA
+	ranges->directory_offset = directory;
+	ranges->table_offset = read_uint32_t(buffer + directory);
+	ranges->table_size = read_uint32_t(buffer + directory + 4);
+	if (!ranges->table_offset) {
+		ranges->table_size = 0;
+	}
+
+	return 1;
+}
+
+EXPORT_SYM size_t ppelib_authenticode_digest_buffer(const uint8_t *buffer, size_t size, uint32_t algorithm,
+		uint8_t *digest) {
+	ppelib_reset_error();
+
+	authenticode_ranges_t ranges;
+	if (!authenticode_ranges_from_buffer(buffer, size, &ranges)) {
+		return 0;
+	}
+
+	authenticode_t authenticode;
+	if (!authenticode_init(&authenticode, algorithm, &ranges)) {
+		ppelib_set_error("Unknown digest algorithm");
+		return 0;
+	}
+
+	authenticode_update(&authenticode, buffer, size);
+	authenticode_final(&authenticode, digest);
+
+	return authenticode.digest_size;
+}
@@ -0,0 +1,65 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_AUTHENTICODE_H_
+#define PPELIB_AUTHENTICODE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "digest.h"
+
+// Offsets into the optional header
+#define OPTIONAL_HEADER_CHECKSUM 64
+#define OPTIONAL_HEADER_NUMBER_OF_RVA_AND_SIZES 92
+#define OPTIONAL_HEADER_DATA_DIRECTORIES 96
+#define OPTIONAL_HEADER_PLUS_NUMBER_OF_RVA_AND_SIZES 108
+#define OPTIONAL_HEADER_PLUS_DATA_DIRECTORIES 112
+
+// The Authenticode image hash covers the file in order, except for the checksum,
+// the certificate table data directory entry and the certificate table itself.
+typedef struct authenticode {
+	digest_t digest;
+	size_t digest_size;
+	// Offset into the file of the next byte passed to authenticode_update()
+	size_t position;
+
+	// Sorted by start
+	size_t excluded_start[3];
+	size_t excluded_end[3];
+	uint8_t number_of_excluded;
+} authenticode_t;
+
+// Where the excluded parts of a file are. directory_offset is 0 for files without a
+// certificate table entry, table_size 0 for files without a certificate table.
+typedef struct authenticode_ranges {
+	size_t checksum_offset;
+	size_t directory_offset;
+	size_t table_offset;
+	size_t table_size;
+} authenticode_ranges_t;
+
+// Returns the size of the digest, 0 for unknown algorithms
+size_t authenticode_init(authenticode_t *authenticode, uint32_t algorithm, const authenticode_ranges_t *ranges);
+// Feed the next size bytes of the file
+void authenticode_update(authenticode_t *authenticode, const uint8_t *data, size_t size);
+void authenticode_final(authenticode_t *authenticode, uint8_t *digest);
+
+// Find the excluded parts of a file in memory, sets an error if it isn't a PE file
+uint8_t authenticode_ranges_from_buffer(const uint8_t *buffer, size_t size, authenticode_ranges_t *ranges);
+
+#endif /* PPELIB_AUTHENTICODE_H_ */
@@ -0,0 +1,200 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "authenticode.h"
+#include "checksum.h"
+#include "cpu.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "utils.h"
+
+// The sum of the words is the sum of their low bytes plus 256 times the sum of their
+// high bytes. Summing bytes into 64 bit lanes never overflows, so the vector loops
+// don't need to fold as they go.
+#if defined PPELIB_LITTLE_ENDIAN && (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PPELIB_CHECKSUM_SSE2 1
+#elif defined PPELIB_LITTLE_ENDIAN && (defined __aarch64__ || defined _M_ARM64)
+#include <arm_neon.h>
+#define PPELIB_CHECKSUM_NEON 1
+#endif
+
+#if defined PPELIB_LITTLE_ENDIAN && defined PPELIB_CPU_X86_TARGETS
+#include <immintrin.h>
+#define PPELIB_CHECKSUM_AVX2 1
+#endif
+
+static uint64_t sum_words_scalar(const uint8_t *data, size_t size) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i + 2 <= size; i += 2) {
+		sum += read_uint16_t(data + i);
+	}
+
+	return sum;
+}
+
+#if defined PPELIB_CHECKSUM_AVX2
+PPELIB_TARGET_AVX2 static uint64_t sum_words_avx2(const uint8_t *data, size_t size, size_t *used) {
+	const __m256i low = _mm256_set1_epi16(0x00FF);
+	__m256i low_sum = _mm256_setzero_si256();
+	__m256i high_sum = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; size - i >= 32; i += 32) {
+		__m256i words = _mm256_loadu_si256((const __m256i *)(data + i));
+		low_sum = _mm256_add_epi64(low_sum, _mm256_sad_epu8(_mm256_and_si256(words, low), _mm256_setzero_si256()));
+		high_sum = _mm256_add_epi64(high_sum, _mm256_sad_epu8(_mm256_srli_epi16(words, 8), _mm256_setzero_si256()));
+	}
+
+	uint64_t lanes[4];
+	_mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(low_sum, _mm256_slli_epi64(high_sum, 8)));
+
+	*used = i;
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+// Sums the little endian 16 bit words of an even number of bytes
+static uint64_t sum_words(const uint8_t *data, size_t size) {
+	uint64_t sum = 0;
+	size_t i = 0;
+
+#if defined PPELIB_CHECKSUM_AVX2
+	if (size >= 256 && cpu_has_avx2()) {
+		sum += sum_words_avx2(data, size, &i);
+	}
+#endif
+
+#if defined PPELIB_CHECKSUM_SSE2
+	const __m128i low = _mm_set1_epi16(0x00FF);
+	__m128i low_sum = _mm_setzero_si128();
+	__m128i high_sum = _mm_setzero_si128();
+	for (; size - i >= 16; i += 16) {
+		__m128i words = _mm_loadu_si128((const __m128i *)(data + i));
+		low_sum = _mm_add_epi64(low_sum, _mm_sad_epu8(_mm_and_si128(words, low), _mm_setzero_si128()));
+		high_sum = _mm_add_epi64(high_sum, _mm_sad_epu8(_mm_srli_epi16(words, 8), _mm_setzero_si128()));
+	}
+
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(low_sum, _mm_slli_epi64(high_sum, 8)));
+	sum += lanes[0] + lanes[1];
+#elif defined PPELIB_CHECKSUM_NEON
+	uint64x2_t sums = vdupq_n_u64(0);
+	for (; size - i >= 16; i += 16) {
+		sums = vpadalq_u32(sums, vpaddlq_u16(vreinterpretq_u16_u8(vld1q_u8(data + i))));
+	}
+	sum += vaddvq_u64(sums);
+#endif
+
+	return sum + sum_words_scalar(data + i, size - i);
+}
+
+static void checksum_add(checksum_t *checksum, const uint8_t *data, size_t size) {
+	if (!size) {
+		return;
+	}
+
+	checksum->position += size;
+
+	// A byte at an odd offset is the high half of its word
+	if ((checksum->position - size) & 1) {
+		checksum->sum += (uint64_t)data[0] << 8;
+		++data;
+		--size;
+	}
+
+	checksum->sum += sum_words(data, size & ~(size_t)1);
+	if (size & 1) {
+		checksum->sum += data[size - 1];
+	}
+}
+
+void checksum_init(checksum_t *checksum, size_t checksum_offset) {
+	memset(checksum, 0, sizeof(checksum_t));
+	checksum->checksum_offset = checksum_offset;
+}
+
+void checksum_update(checksum_t *checksum, const uint8_t *data, size_t size) {
+	size_t start = checksum->position;
+	size_t end = start + size;
+	size_t excluded_start = checksum->checksum_offset;
+	size_t excluded_end = excluded_start + 4;
+
+	if (excluded_start >= end || excluded_end <= start) {
+		checksum_add(checksum, data, size);
+		return;
+	}
+
+	size_t before = excluded_start > start ? excluded_start - start : 0;
+	size_t after = MIN(excluded_end, end) - start;
+
+	checksum_add(checksum, data, before);
+	// The checksum field counts as zeroes
+	checksum->position += after - before;
+	checksum_add(checksum, data + after, size - after);
+}
+
+uint32_t checksum_final(const checksum_t *checksum) {
+	uint64_t sum = checksum->sum;
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	return (uint32_t)(sum + checksum->position);
+}
+
+static uint8_t checksum_buffer(const uint8_t *buffer, size_t size, uint32_t *computed, uint32_t *stored) {
+	authenticode_ranges_t ranges;
+	if (!authenticode_ranges_from_buffer(buffer, size, &ranges)) {
+		return 0;
+	}
+
+	checksum_t checksum;
+	checksum_init(&checksum, ranges.checksum_offset);
+	checksum_update(&checksum, buffer, size);
+
+	*computed = checksum_final(&checksum);
+	*stored = read_uint32_t(buffer + ranges.checksum_offset);
+	return 1;
+}
+
+EXPORT_SYM uint32_t ppelib_checksum_buffer(const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	uint32_t computed = 0;
+	uint32_t stored;
+	checksum_buffer(buffer, size, &computed, &stored);
+
+	return computed;
+}
+
+EXPORT_SYM uint8_t ppelib_checksum_verify_buffer(const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	uint32_t computed;
+	uint32_t stored;
+	if (!checksum_buffer(buffer, size, &computed, &stored)) {
+		return 0;
+	}
+
+	return computed == stored;
+}
@@ -0,0 +1,38 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_CHECKSUM_H_
+#define PPELIB_CHECKSUM_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// The PE checksum is the one's complement sum of the file as 16 bit words, with the
+// checksum field counted as 0, folded to 16 bits and added to the size of the file.
+typedef struct checksum {
+	uint64_t sum;
+	// Offset into the file of the next byte passed to checksum_update()
+	size_t position;
+	size_t checksum_offset;
+} checksum_t;
+
+void checksum_init(checksum_t *checksum, size_t checksum_offset);
+// Feed the next size bytes of the file
+void checksum_update(checksum_t *checksum, const uint8_t *data, size_t size);
+uint32_t checksum_final(const checksum_t *checksum);
+
+#endif /* PPELIB_CHECKSUM_H_ */
@@ -0,0 +1,112 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "platform.h"
+#include "ppe_error.h"
+
+static void *default_malloc(void *userdata, size_t size) {
+	(void)userdata;
+
+	return malloc(size);
+}
+
+static void *default_realloc(void *userdata, void *buffer, size_t size) {
+	(void)userdata;
+
+	return realloc(buffer, size);
+}
+
+static void default_free(void *userdata, void *buffer) {
+	(void)userdata;
+
+	free(buffer);
+}
+
+const allocator_t default_allocator = {
+	default_malloc,
+	default_realloc,
+	default_free,
+	NULL,
+};
+
+const allocator_t *context_allocator(const ppelib_context_t *context) {
+	if (!context) {
+		return &default_allocator;
+	}
+
+	return &context->allocator;
+}
+
+// Errors are set thread-locally while a call runs. Calls on behalf of a context
+// move them over before returning so nothing is left behind on the thread.
+void context_take_error(ppelib_context_t *context) {
+	if (!context) {
+		return;
+	}
+
+	context->error = NULL;
+	if (ppelib_error_peek()) {
+		strncpy(context->error_str, ppelib_error(), sizeof(context->error_str) - 1);
+		context->error_str[sizeof(context->error_str) - 1] = 0;
+		context->error = context->error_str;
+	}
+
+	ppelib_reset_error();
+}
+
+EXPORT_SYM ppelib_context_t *ppelib_context_create(const allocator_t *allocator, uint32_t parse_options) {
+	ppelib_reset_error();
+
+	if (!allocator) {
+		allocator = &default_allocator;
+	}
+
+	if (!allocator->malloc || !allocator->realloc || !allocator->free) {
+		ppelib_set_error("Incomplete allocator");
+		return NULL;
+	}
+
+	ppelib_context_t *context = allocator->malloc(allocator->userdata, sizeof(ppelib_context_t));
+	if (!context) {
+		ppelib_set_error("Failed to allocate context");
+		return NULL;
+	}
+
+	memset(context, 0, sizeof(ppelib_context_t));
+	context->allocator = *allocator;
+	context->parse_options = parse_options;
+
+	return context;
+}
+
+EXPORT_SYM void ppelib_context_destroy(ppelib_context_t *context) {
+	if (!context) {
+		return;
+	}
+
+	context->allocator.free(context->allocator.userdata, context);
+}
+
+EXPORT_SYM const char *ppelib_context_error(const ppelib_context_t *context) {
+	return context->error;
+}
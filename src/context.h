@@ -0,0 +1,47 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_CONTEXT_H_
+#define PPELIB_CONTEXT_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef struct allocator {
+	void *(*malloc)(void *userdata, size_t size);
+	void *(*realloc)(void *userdata, void *buffer, size_t size);
+	void (*free)(void *userdata, void *buffer);
+	void *userdata;
+} allocator_t;
+
+// Handles created from a context allocate through it and report the errors of
+// the calls that parse, load or write data to it instead of the thread-local
+// error. Handles without one use default_allocator and thread-local errors.
+typedef struct ppelib_context {
+	allocator_t allocator;
+	uint32_t parse_options;
+
+	const char *error;
+	char error_str[100];
+} ppelib_context_t;
+
+extern const allocator_t default_allocator;
+
+const allocator_t *context_allocator(const ppelib_context_t *context);
+void context_take_error(ppelib_context_t *context);
+
+#endif /* PPELIB_CONTEXT_H_ */
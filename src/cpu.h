@@ -0,0 +1,34 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_CPU_H_
+#define PPELIB_CPU_H_
+
+#include <inttypes.h>
+
+// Compilers that can build a function for an instruction set the rest of the file
+// isn't built for. Only those functions may use it, after checking the CPU has it.
+#if (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+#define PPELIB_CPU_X86_TARGETS 1
+#define PPELIB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+uint8_t cpu_has_avx2(void);
+// Number of CPUs online, at least 1
+uint32_t cpu_count(void);
+
+#endif /* PPELIB_CPU_H_ */
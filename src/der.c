@@ -0,0 +1,94 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "der.h"
+
+void der_reader_init(der_reader_t *reader, const uint8_t *data, size_t size) {
+	reader->data = data;
+	reader->size = data ? size : 0;
+}
+
+static uint8_t der_peek(const der_reader_t *reader, der_node_t *node) {
+	if (reader->size < 2) {
+		return 0;
+	}
+
+	const uint8_t *data = reader->data;
+	uint8_t tag = data[0];
+	if ((tag & 0x1F) == 0x1F) {
+		return 0;
+	}
+
+	size_t header_size = 2;
+	size_t size = data[1];
+	if (size & 0x80) {
+		size_t length_size = size & 0x7F;
+		if (!length_size || length_size > 4 || reader->size - 2 < length_size) {
+			return 0;
+		}
+
+		size = 0;
+		for (size_t i = 0; i < length_size; ++i) {
+			size = (size << 8) | data[2 + i];
+		}
+		header_size += length_size;
+	}
+
+	if (size > reader->size - header_size) {
+		return 0;
+	}
+
+	node->tag = tag;
+	node->encoding = data;
+	node->encoding_size = header_size + size;
+	node->contents = data + header_size;
+	node->size = size;
+
+	return 1;
+}
+
+uint8_t der_read(der_reader_t *reader, der_node_t *node) {
+	if (!der_peek(reader, node)) {
+		return 0;
+	}
+
+	reader->data += node->encoding_size;
+	reader->size -= node->encoding_size;
+
+	return 1;
+}
+
+uint8_t der_read_tag(der_reader_t *reader, uint8_t tag, der_node_t *node) {
+	der_node_t next;
+	if (!der_peek(reader, &next) || next.tag != tag) {
+		return 0;
+	}
+
+	return der_read(reader, node);
+}
+
+void der_enter(const der_node_t *node, der_reader_t *reader) {
+	der_reader_init(reader, node->contents, node->size);
+}
+
+uint8_t der_oid_equals(const der_node_t *node, const uint8_t *oid, size_t size) {
+	return node->tag == DER_OID && node->size == size && memcmp(node->contents, oid, size) == 0;
+}
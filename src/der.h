@@ -0,0 +1,62 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_DER_H_
+#define PPELIB_DER_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define DER_INTEGER 0x02
+#define DER_OCTET_STRING 0x04
+#define DER_OID 0x06
+#define DER_UTC_TIME 0x17
+#define DER_GENERALIZED_TIME 0x18
+#define DER_SEQUENCE 0x30
+#define DER_SET 0x31
+// Constructed context specific tags, [0] is 0xA0
+#define DER_CONTEXT(n) (0xA0 | (n))
+
+// Walks a DER encoding in place. Nothing is allocated or copied, nodes point into the
+// data the reader was started on.
+typedef struct der_reader {
+	const uint8_t *data;
+	size_t size;
+} der_reader_t;
+
+typedef struct der_node {
+	uint8_t tag;
+	// The whole encoding, tag and length included
+	const uint8_t *encoding;
+	size_t encoding_size;
+	const uint8_t *contents;
+	size_t size;
+} der_node_t;
+
+void der_reader_init(der_reader_t *reader, const uint8_t *data, size_t size);
+// Reads the next node and moves past it. Returns 0 at the end of the data and for
+// anything that isn't DER: indefinite lengths, multi byte tags and lengths running
+// past the end.
+uint8_t der_read(der_reader_t *reader, der_node_t *node);
+// Like der_read() but only moves past a node with the given tag, a node with another
+// tag is left for the next read. That also covers OPTIONAL fields.
+uint8_t der_read_tag(der_reader_t *reader, uint8_t tag, der_node_t *node);
+// A reader over the contents of a constructed node
+void der_enter(const der_node_t *node, der_reader_t *reader);
+uint8_t der_oid_equals(const der_node_t *node, const uint8_t *oid, size_t size);
+
+#endif /* PPELIB_DER_H_ */
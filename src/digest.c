@@ -0,0 +1,208 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "digest.h"
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t read_be32(const uint8_t *buffer) {
+	return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+static void write_be32(uint8_t *buffer, uint32_t value) {
+	buffer[0] = (uint8_t)(value >> 24);
+	buffer[1] = (uint8_t)(value >> 16);
+	buffer[2] = (uint8_t)(value >> 8);
+	buffer[3] = (uint8_t)value;
+}
+
+static void sha1_block(uint32_t *state, const uint8_t *block) {
+	uint32_t w[80];
+	for (int i = 0; i < 16; ++i) {
+		w[i] = read_be32(block + i * 4);
+	}
+	for (int i = 16; i < 80; ++i) {
+		w[i] = ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+	for (int i = 0; i < 80; ++i) {
+		uint32_t f, k;
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5A827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+
+		uint32_t t = ROTL(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROTL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+static void sha256_block(uint32_t *state, const uint8_t *block) {
+	uint32_t w[64];
+	for (int i = 0; i < 16; ++i) {
+		w[i] = read_be32(block + i * 4);
+	}
+	for (int i = 16; i < 64; ++i) {
+		uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for (int i = 0; i < 64; ++i) {
+		uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+		uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+static void digest_block(digest_t *digest, const uint8_t *block) {
+	if (digest->algorithm == DIGEST_SHA1) {
+		sha1_block(digest->state, block);
+	} else {
+		sha256_block(digest->state, block);
+	}
+}
+
+size_t digest_init(digest_t *digest, uint32_t algorithm) {
+	static const uint32_t sha1_initial[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	static const uint32_t sha256_initial[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+		0x1f83d9ab, 0x5be0cd19 };
+
+	memset(digest, 0, sizeof(digest_t));
+	digest->algorithm = algorithm;
+
+	switch (algorithm) {
+	case DIGEST_SHA1:
+		memcpy(digest->state, sha1_initial, sizeof(sha1_initial));
+		return DIGEST_SHA1_SIZE;
+	case DIGEST_SHA256:
+		memcpy(digest->state, sha256_initial, sizeof(sha256_initial));
+		return DIGEST_SHA256_SIZE;
+	default:
+		return 0;
+	}
+}
+
+void digest_update(digest_t *digest, const uint8_t *data, size_t size) {
+	digest->length += size;
+
+	if (digest->block_used) {
+		size_t fill = DIGEST_BLOCK_SIZE - digest->block_used;
+		if (size < fill) {
+			memcpy(digest->block + digest->block_used, data, size);
+			digest->block_used += size;
+			return;
+		}
+
+		memcpy(digest->block + digest->block_used, data, fill);
+		digest_block(digest, digest->block);
+		data += fill;
+		size -= fill;
+		digest->block_used = 0;
+	}
+
+	// Whole blocks straight from the caller's memory
+	for (; size >= DIGEST_BLOCK_SIZE; data += DIGEST_BLOCK_SIZE, size -= DIGEST_BLOCK_SIZE) {
+		digest_block(digest, data);
+	}
+
+	if (size) {
+		memcpy(digest->block, data, size);
+		digest->block_used = size;
+	}
+}
+
+void digest_final(digest_t *digest, uint8_t *out) {
+	uint64_t bits = digest->length * 8;
+
+	digest->block[digest->block_used++] = 0x80;
+	if (digest->block_used > DIGEST_BLOCK_SIZE - 8) {
+		memset(digest->block + digest->block_used, 0, DIGEST_BLOCK_SIZE - digest->block_used);
+		digest_block(digest, digest->block);
+		digest->block_used = 0;
+	}
+
+	memset(digest->block + digest->block_used, 0, DIGEST_BLOCK_SIZE - 8 - digest->block_used);
+	write_be32(digest->block + 56, (uint32_t)(bits >> 32));
+	write_be32(digest->block + 60, (uint32_t)bits);
+	digest_block(digest, digest->block);
+
+	size_t words = digest->algorithm == DIGEST_SHA1 ? 5 : 8;
+	for (size_t i = 0; i < words; ++i) {
+		write_be32(out + i * 4, digest->state[i]);
+	}
+}
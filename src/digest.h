@@ -0,0 +1,50 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_DIGEST_H_
+#define PPELIB_DIGEST_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Same values as enum ppelib_digest_algorithm
+enum digest_algorithm {
+	DIGEST_SHA1 = 1,
+	DIGEST_SHA256 = 2,
+};
+
+#define DIGEST_SHA1_SIZE 20
+#define DIGEST_SHA256_SIZE 32
+#define DIGEST_MAX_SIZE 32
+#define DIGEST_BLOCK_SIZE 64
+
+// SHA-1 and SHA-256 share their block size and padding, only the compression
+// function differs
+typedef struct digest {
+	uint32_t algorithm;
+	uint32_t state[8];
+	uint64_t length;
+	uint8_t block[DIGEST_BLOCK_SIZE];
+	size_t block_used;
+} digest_t;
+
+// Returns the size of the digest, 0 for unknown algorithms
+size_t digest_init(digest_t *digest, uint32_t algorithm);
+void digest_update(digest_t *digest, const uint8_t *data, size_t size);
+void digest_final(digest_t *digest, uint8_t *out);
+
+#endif /* PPELIB_DIGEST_H_ */
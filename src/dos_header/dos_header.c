@@ -24,6 +24,7 @@
 #include "main.h"
 #include "platform.h"
 #include "ppe_error.h"
+#include "scan.h"
 
 #include "generated/dos_header_private.h"
 #include "generated/vlv_signature_private.h"
@@ -58,11 +59,17 @@ EXPORT_SYM void ppelib_dos_header_delete_vlv_signature(dos_header_t *dos_header)
 		return;
 	}
 
+	if (!buffer_make_owned(dos_header->pe, &dos_header->stub, dos_header->stub_size)) {
+		ppelib_set_error("Failed to allocate DOS stub");
+		return;
+	}
+
 	buffer_excise(&dos_header->stub, dos_header->stub_size, dos_header->vlv_signature.start,
 			dos_header->vlv_signature.end);
 
 	dos_header->has_vlv_signature = 0;
 	dos_header->stub_size -= dos_header->vlv_signature.end - dos_header->vlv_signature.start;
+	dos_header->pe->changed = 1;
 
 	align_pe_header_offset(dos_header);
 }
@@ -75,10 +82,16 @@ EXPORT_SYM void ppelib_dos_header_delete_rich_table(dos_header_t *dos_header) {
 		return;
 	}
 
+	if (!buffer_make_owned(dos_header->pe, &dos_header->stub, dos_header->stub_size)) {
+		ppelib_set_error("Failed to allocate DOS stub");
+		return;
+	}
+
 	buffer_excise(&dos_header->stub, dos_header->stub_size, dos_header->rich_table.start, dos_header->rich_table.end);
 
 	dos_header->has_rich_table = 0;
 	dos_header->stub_size -= dos_header->rich_table.end - dos_header->rich_table.start;
+	dos_header->pe->changed = 1;
 
 	align_pe_header_offset(dos_header);
 }
@@ -111,7 +124,7 @@ EXPORT_SYM void ppelib_dos_header_set_message(dos_header_t *dos_header, const ch
 		dos_header->message = oldptr;
 		return;
 	}
-	free(oldptr);
+	buffer_free(dos_header->pe, oldptr);
 
 	update_dos_stub(dos_header);
 	return;
@@ -193,6 +206,10 @@ void dos_strcpy(uint8_t *buffer, const char *string) {
 
 void align_pe_header_offset(dos_header_t *dos_header) {
 	if (TO_NEAREST(dos_header->stub_size, 8) != dos_header->stub_size) {
+		if (!buffer_make_owned(dos_header->pe, &dos_header->stub, dos_header->stub_size)) {
+			return;
+		}
+
 		dos_header->stub = realloc(dos_header->stub, TO_NEAREST(dos_header->stub_size, 8));
 		dos_header->stub_size = TO_NEAREST(dos_header->stub_size, 8);
 	}
@@ -216,6 +233,11 @@ void update_dos_stub(dos_header_t *dos_header) {
 	size_t new_size = sizeof(dos_stub) + strlen(dos_header->message) + sizeof(dos_string_end);
 
 	void *oldptr = dos_header->stub;
+	if (buffer_is_borrowed(dos_header->pe, oldptr)) {
+		// The whole stub gets rewritten, no need to copy the borrowed one first
+		dos_header->stub = NULL;
+	}
+
 	dos_header->stub = realloc(dos_header->stub, new_size);
 	if (!dos_header->stub) {
 		dos_header->stub = oldptr;
@@ -229,6 +251,7 @@ void update_dos_stub(dos_header_t *dos_header) {
 	dos_header->has_rich_table = 0;
 
 	dos_header->stub_size = new_size;
+	dos_header->pe->changed = 1;
 	memset(dos_header->stub, 0, new_size);
 	memcpy(dos_header->stub, dos_stub, sizeof(dos_stub));
 	dos_strcpy(dos_header->stub + sizeof(dos_stub), dos_header->message);
@@ -260,13 +283,21 @@ void update_dos_stub(dos_header_t *dos_header) {
 
 // Don't error for this. If this doesn't work it doesn't work.
 void parse_dos_stub(dos_header_t *dos_header) {
-	if (parse_vlv_signature(dos_header->stub, dos_header->stub_size, &dos_header->vlv_signature) == 0) {
+	arena_t *arena = &dos_header->pe->arena;
+
+	// Both markers are found in one pass over the stub
+	size_t offsets[SCAN_NUMBER_OF_MARKERS];
+	scan_first(dos_header->stub, dos_header->stub_size, SCAN_VLV | SCAN_RICH, offsets);
+
+	if (parse_vlv_signature(dos_header->stub, dos_header->stub_size, offsets[SCAN_VLV_INDEX],
+				&dos_header->vlv_signature, arena) == 0) {
 		dos_header->has_vlv_signature = 1;
 		// VLV signatures and dos messages don't mix
 		return;
 	}
 
-	if (parse_rich_table(dos_header->stub, dos_header->stub_size, &dos_header->rich_table) == 0) {
+	if (parse_rich_table(dos_header->stub, dos_header->stub_size, offsets[SCAN_RICH_INDEX], &dos_header->rich_table,
+				arena) == 0) {
 		dos_header->has_rich_table = 1;
 	}
 
@@ -284,6 +315,10 @@ void parse_dos_stub(dos_header_t *dos_header) {
 		return;
 	}
 
-	dos_header->message = malloc(message_len + 1);
+	dos_header->message = arena_alloc(arena, message_len + 1);
+	if (!dos_header->message) {
+		return;
+	}
+
 	dos_strncpy_print(dos_header->message, dos_header->stub + 0xe, message_len);
 }
@@ -81,25 +81,8 @@ EXPORT_SYM void ppelib_rich_table_print(const rich_table_t *table) {
 	ppelib_rich_table_fprint(stdout, table);
 }
 
-size_t find_rich_signature(uint8_t *buffer, size_t size) {
-	if (size < sizeof(uint32_t)) {
-		goto out;
-	}
-
-	for (size_t i = 0; i < size - 3; ++i) {
-		uint32_t header = read_uint32_t(buffer + i);
-		if (header == RICH_MARKER) {
-			return i;
-		}
-	}
-
-out:
-	return size + 1;
-}
-
-uint8_t parse_rich_table(uint8_t *buffer, size_t size, rich_table_t *rich_table) {
-	size_t footer_offset = find_rich_signature(buffer, size);
-
+uint8_t parse_rich_table(uint8_t *buffer, size_t size, size_t footer_offset, rich_table_t *rich_table,
+		arena_t *arena) {
 	if (footer_offset > size) {
 		return 1;
 	}
@@ -150,7 +133,7 @@ uint8_t parse_rich_table(uint8_t *buffer, size_t size, rich_table_t *rich_table)
 
 	rich_table_size /= 2;
 
-	rich_table->entries = malloc(sizeof(rich_table_entry_t) * rich_table_size);
+	rich_table->entries = arena_alloc(arena, sizeof(rich_table_entry_t) * rich_table_size);
 	if (!rich_table->entries) {
 		return 1;
 	}
@@ -47,29 +47,12 @@ EXPORT_SYM const uint8_t *ppelib_vlv_signature_get_signature(const vlv_signature
 	return vlv_signature->signature;
 }
 
-size_t find_vlv_signature(uint8_t *buffer, size_t size) {
-	if (size < sizeof(uint32_t)) {
-		goto out;
-	}
-
-	for (size_t i = 0; i < size - 3; ++i) {
-		uint32_t header = read_uint32_t(buffer + i);
-		if (header == VLV_SIGNATURE) {
-			return i;
-		}
-	}
-
-out:
-	return size + 1;
-}
-
-uint8_t parse_vlv_signature(uint8_t *buffer, size_t size, vlv_signature_t *vlv_signature) {
+uint8_t parse_vlv_signature(uint8_t *buffer, size_t size, size_t vlv_offset, vlv_signature_t *vlv_signature,
+		arena_t *arena) {
 	if (128 + VLV_SIGNATURE_SIZE > size) {
 		return 1;
 	}
 
-	size_t vlv_offset = find_vlv_signature(buffer, size);
-
 	if (vlv_offset > size) {
 		return 1;
 	}
@@ -85,7 +68,7 @@ uint8_t parse_vlv_signature(uint8_t *buffer, size_t size, vlv_signature_t *vlv_s
 		return 1;
 	}
 
-	vlv_signature->signature = malloc(128);
+	vlv_signature->signature = arena_alloc(arena, 128);
 	if (!vlv_signature->signature) {
 		return 1;
 	}
@@ -0,0 +1,572 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-constants.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+
+#include "certificate_table.h"
+#include "der.h"
+#include "digest.h"
+
+// 1.2.840.113549.1.7.2
+static const uint8_t oid_signed_data[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02 };
+// 1.3.6.1.4.1.311.2.1.4
+static const uint8_t oid_spc_indirect_data[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04 };
+// 1.2.840.113549.1.9.5
+static const uint8_t oid_signing_time[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x05 };
+// 1.2.840.113549.1.9.6
+static const uint8_t oid_counter_signature[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x06 };
+// 1.3.6.1.4.1.311.3.3.1
+static const uint8_t oid_timestamp[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x03, 0x03, 0x01 };
+// 1.2.840.113549.1.9.16.1.4
+static const uint8_t oid_tst_info[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x10, 0x01, 0x04 };
+// 1.3.14.3.2.26
+static const uint8_t oid_sha1[] = { 0x2B, 0x0E, 0x03, 0x02, 0x1A };
+// 2.16.840.1.101.3.4.2.1
+static const uint8_t oid_sha256[] = { 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01 };
+
+#define OID_EQUALS(node, oid) der_oid_equals(node, oid, sizeof(oid))
+
+// The table holds the certificates back to back, each aligned to 8 bytes
+void certificate_table_load(ppelib_file_t *pe) {
+	if (pe->certificate_table_loaded) {
+		return;
+	}
+
+	certificate_table_t *table = &pe->certificate_table;
+	memset(table, 0, sizeof(certificate_table_t));
+	table->pe = pe;
+
+	if (pe->header.number_of_rva_and_sizes <= DIR_CERTIFICATE_TABLE) {
+		pe->certificate_table_loaded = 1;
+		return;
+	}
+
+	const data_directory_t *data_directory = &pe->data_directories[DIR_CERTIFICATE_TABLE];
+	if (!data_directory->size) {
+		pe->certificate_table_loaded = 1;
+		return;
+	}
+
+	size_t offset = data_directory->offset;
+	size_t size = data_directory->size;
+	if (offset > pe->overlay_size || size > pe->overlay_size - offset) {
+		ppelib_set_error("Certificate table outside of file");
+		return;
+	}
+
+	const uint8_t *overlay = overlay_get(pe);
+	if (!overlay) {
+		return;
+	}
+
+	const uint8_t *data = overlay + offset;
+	uint32_t number_of_certificates = 0;
+	for (size_t position = 0; size - position >= CERTIFICATE_HEADER_SIZE;) {
+		uint32_t length = read_uint32_t(data + position);
+		if (length < CERTIFICATE_HEADER_SIZE || length > size - position) {
+			ppelib_set_error("Certificate outside of certificate table");
+			return;
+		}
+
+		++number_of_certificates;
+		position += TO_NEAREST((size_t)length, 8);
+		if (position > size) {
+			break;
+		}
+	}
+
+	table->certificates = arena_calloc(&pe->arena, sizeof(certificate_t) * (number_of_certificates + 1u));
+	if (!table->certificates) {
+		ppelib_set_error("Failed to allocate certificates");
+		return;
+	}
+
+	size_t position = 0;
+	for (uint32_t i = 0; i < number_of_certificates; ++i) {
+		certificate_t *certificate = &table->certificates[i];
+		certificate->length = read_uint32_t(data + position);
+		certificate->revision = read_uint16_t(data + position + 4);
+		certificate->certificate_type = read_uint16_t(data + position + 6);
+		certificate->data = data + position + CERTIFICATE_HEADER_SIZE;
+		certificate->size = certificate->length - CERTIFICATE_HEADER_SIZE;
+
+		position += TO_NEAREST((size_t)certificate->length, 8);
+	}
+	table->size = number_of_certificates;
+
+	pe->certificate_table_loaded = 1;
+}
+
+// The certificates point into the overlay, they are loaded again after it moves
+void certificate_table_reset(ppelib_file_t *pe) {
+	memset(&pe->certificate_table, 0, sizeof(certificate_table_t));
+	pe->certificate_table_loaded = 0;
+}
+
+static void span_set(span_t *span, const uint8_t *data, size_t size) {
+	span->data = data;
+	span->size = size;
+}
+
+static uint32_t digest_from_oid(const der_node_t *oid) {
+	if (OID_EQUALS(oid, oid_sha1)) {
+		return DIGEST_SHA1;
+	}
+
+	if (OID_EQUALS(oid, oid_sha256)) {
+		return DIGEST_SHA256;
+	}
+
+	return 0;
+}
+
+// ContentInfo holding SignedData, the reader is left on the fields of the SignedData
+static uint8_t signed_data_enter(const uint8_t *data, size_t size, der_reader_t *signed_data) {
+	der_reader_t reader;
+	der_reader_init(&reader, data, size);
+
+	der_node_t node;
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node)) {
+		return 0;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_OID, &node) || !OID_EQUALS(&node, oid_signed_data)) {
+		return 0;
+	}
+
+	if (!der_read_tag(&reader, DER_CONTEXT(0), &node)) {
+		return 0;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node)) {
+		return 0;
+	}
+
+	der_enter(&node, signed_data);
+	return 1;
+}
+
+// The value of the first attribute of the given type
+static uint8_t attribute_find(const der_node_t *attributes, const uint8_t *oid, size_t oid_size, der_node_t *value) {
+	der_reader_t reader;
+	der_enter(attributes, &reader);
+
+	der_node_t attribute;
+	while (der_read_tag(&reader, DER_SEQUENCE, &attribute)) {
+		der_reader_t fields;
+		der_enter(&attribute, &fields);
+
+		der_node_t type;
+		der_node_t values;
+		if (!der_read_tag(&fields, DER_OID, &type) || !der_read_tag(&fields, DER_SET, &values)) {
+			return 0;
+		}
+
+		if (der_oid_equals(&type, oid, oid_size)) {
+			der_reader_t values_reader;
+			der_enter(&values, &values_reader);
+			return der_read(&values_reader, value);
+		}
+	}
+
+	return 0;
+}
+
+static uint8_t signing_time_from_attributes(const der_node_t *attributes, span_t *signing_time) {
+	der_node_t value;
+	if (!attribute_find(attributes, oid_signing_time, sizeof(oid_signing_time), &value)) {
+		return 0;
+	}
+
+	if (value.tag != DER_UTC_TIME && value.tag != DER_GENERALIZED_TIME) {
+		return 0;
+	}
+
+	span_set(signing_time, value.contents, value.size);
+	return 1;
+}
+
+typedef struct signer_info {
+	der_node_t issuer;
+	der_node_t serial;
+	der_node_t digest_algorithm;
+	der_node_t signed_attributes;
+	der_node_t unsigned_attributes;
+	uint8_t has_issuer_and_serial;
+	uint8_t has_signed_attributes;
+	uint8_t has_unsigned_attributes;
+} signer_info_t;
+
+static uint8_t signer_info_read(const der_node_t *node, signer_info_t *info) {
+	memset(info, 0, sizeof(signer_info_t));
+
+	der_reader_t reader;
+	der_enter(node, &reader);
+
+	der_node_t field;
+	if (!der_read_tag(&reader, DER_INTEGER, &field)) {
+		return 0;
+	}
+
+	// Signers identified by subject key identifier instead can't be matched to a subject
+	if (der_read_tag(&reader, DER_SEQUENCE, &field)) {
+		der_reader_t sid;
+		der_enter(&field, &sid);
+		info->has_issuer_and_serial = der_read_tag(&sid, DER_SEQUENCE, &info->issuer)
+				&& der_read_tag(&sid, DER_INTEGER, &info->serial);
+	} else if (!der_read(&reader, &field)) {
+		return 0;
+	}
+
+	der_node_t algorithm;
+	if (!der_read_tag(&reader, DER_SEQUENCE, &algorithm)) {
+		return 0;
+	}
+
+	der_reader_t algorithm_reader;
+	der_enter(&algorithm, &algorithm_reader);
+	if (!der_read_tag(&algorithm_reader, DER_OID, &info->digest_algorithm)) {
+		return 0;
+	}
+
+	info->has_signed_attributes = der_read_tag(&reader, DER_CONTEXT(0), &info->signed_attributes);
+
+	der_node_t signature_algorithm;
+	der_node_t signature;
+	if (!der_read_tag(&reader, DER_SEQUENCE, &signature_algorithm)
+			|| !der_read_tag(&reader, DER_OCTET_STRING, &signature)) {
+		return 0;
+	}
+
+	info->has_unsigned_attributes = der_read_tag(&reader, DER_CONTEXT(1), &info->unsigned_attributes);
+	return 1;
+}
+
+// The genTime of the TSTInfo in an RFC 3161 timestamp token
+static uint8_t signing_time_from_timestamp(const der_node_t *token, span_t *signing_time) {
+	der_reader_t signed_data;
+	if (!signed_data_enter(token->encoding, token->encoding_size, &signed_data)) {
+		return 0;
+	}
+
+	der_node_t node;
+	if (!der_read_tag(&signed_data, DER_INTEGER, &node) || !der_read_tag(&signed_data, DER_SET, &node)
+			|| !der_read_tag(&signed_data, DER_SEQUENCE, &node)) {
+		return 0;
+	}
+
+	der_reader_t reader;
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_OID, &node) || !OID_EQUALS(&node, oid_tst_info)
+			|| !der_read_tag(&reader, DER_CONTEXT(0), &node)) {
+		return 0;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_OCTET_STRING, &node)) {
+		return 0;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node)) {
+		return 0;
+	}
+
+	// version, policy, messageImprint, serialNumber, genTime
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_INTEGER, &node) || !der_read_tag(&reader, DER_OID, &node)
+			|| !der_read_tag(&reader, DER_SEQUENCE, &node) || !der_read_tag(&reader, DER_INTEGER, &node)
+			|| !der_read_tag(&reader, DER_GENERALIZED_TIME, &node)) {
+		return 0;
+	}
+
+	span_set(signing_time, node.contents, node.size);
+	return 1;
+}
+
+// Signers rarely sign the time themselves, it usually comes from a countersignature
+static void signing_time_find(const signer_info_t *info, span_t *signing_time) {
+	if (info->has_signed_attributes && signing_time_from_attributes(&info->signed_attributes, signing_time)) {
+		return;
+	}
+
+	if (!info->has_unsigned_attributes) {
+		return;
+	}
+
+	der_node_t value;
+	if (attribute_find(&info->unsigned_attributes, oid_counter_signature, sizeof(oid_counter_signature), &value)) {
+		signer_info_t counter_signer;
+		if (value.tag == DER_SEQUENCE && signer_info_read(&value, &counter_signer)
+				&& counter_signer.has_signed_attributes
+				&& signing_time_from_attributes(&counter_signer.signed_attributes, signing_time)) {
+			return;
+		}
+	}
+
+	if (attribute_find(&info->unsigned_attributes, oid_timestamp, sizeof(oid_timestamp), &value)) {
+		signing_time_from_timestamp(&value, signing_time);
+	}
+}
+
+// SpcIndirectDataContent ends in the DigestInfo of the file
+static void image_digest_find(const der_node_t *content_info, signer_t *signer) {
+	der_reader_t reader;
+	der_enter(content_info, &reader);
+
+	der_node_t node;
+	if (!der_read_tag(&reader, DER_OID, &node) || !OID_EQUALS(&node, oid_spc_indirect_data)
+			|| !der_read_tag(&reader, DER_CONTEXT(0), &node)) {
+		return;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node)) {
+		return;
+	}
+
+	der_enter(&node, &reader);
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node) || !der_read_tag(&reader, DER_SEQUENCE, &node)) {
+		return;
+	}
+
+	der_enter(&node, &reader);
+	der_node_t algorithm;
+	der_node_t digest;
+	if (!der_read_tag(&reader, DER_SEQUENCE, &algorithm) || !der_read_tag(&reader, DER_OCTET_STRING, &digest)) {
+		return;
+	}
+
+	der_reader_t algorithm_reader;
+	der_enter(&algorithm, &algorithm_reader);
+	if (der_read_tag(&algorithm_reader, DER_OID, &node)) {
+		signer->image_digest_algorithm = digest_from_oid(&node);
+	}
+
+	span_set(&signer->image_digest, digest.contents, digest.size);
+}
+
+// The certificate with the signer's issuer and serial number
+static void subject_find(const der_node_t *certificates, const signer_info_t *info, span_t *subject) {
+	der_reader_t reader;
+	der_enter(certificates, &reader);
+
+	der_node_t certificate;
+	while (der_read_tag(&reader, DER_SEQUENCE, &certificate)) {
+		der_reader_t fields;
+		der_enter(&certificate, &fields);
+
+		der_node_t tbs;
+		if (!der_read_tag(&fields, DER_SEQUENCE, &tbs)) {
+			continue;
+		}
+
+		// version, serialNumber, signature, issuer, validity, subject
+		der_node_t version;
+		der_node_t serial;
+		der_node_t algorithm;
+		der_node_t issuer;
+		der_node_t validity;
+		der_node_t name;
+		der_enter(&tbs, &fields);
+		der_read_tag(&fields, DER_CONTEXT(0), &version);
+		if (!der_read_tag(&fields, DER_INTEGER, &serial) || !der_read_tag(&fields, DER_SEQUENCE, &algorithm)
+				|| !der_read_tag(&fields, DER_SEQUENCE, &issuer) || !der_read_tag(&fields, DER_SEQUENCE, &validity)
+				|| !der_read_tag(&fields, DER_SEQUENCE, &name)) {
+			continue;
+		}
+
+		if (serial.size == info->serial.size && memcmp(serial.contents, info->serial.contents, serial.size) == 0
+				&& issuer.encoding_size == info->issuer.encoding_size
+				&& memcmp(issuer.encoding, info->issuer.encoding, issuer.encoding_size) == 0) {
+			span_set(subject, name.encoding, name.encoding_size);
+			return;
+		}
+	}
+}
+
+static uint8_t certificate_signer(const certificate_t *certificate, signer_t *signer) {
+	memset(signer, 0, sizeof(signer_t));
+
+	if (certificate->certificate_type != WIN_CERT_TYPE_PKCS_SIGNED_DATA) {
+		ppelib_set_error("Certificate isn't PKCS#7 signed data");
+		return 0;
+	}
+
+	der_reader_t signed_data;
+	if (!signed_data_enter(certificate->data, certificate->size, &signed_data)) {
+		ppelib_set_error("Malformed signed data");
+		return 0;
+	}
+
+	// version, digestAlgorithms, contentInfo, [0] certificates, [1] crls, signerInfos
+	der_node_t node;
+	der_node_t content_info;
+	der_node_t certificates;
+	der_node_t signer_infos;
+	if (!der_read_tag(&signed_data, DER_INTEGER, &node) || !der_read_tag(&signed_data, DER_SET, &node)
+			|| !der_read_tag(&signed_data, DER_SEQUENCE, &content_info)) {
+		ppelib_set_error("Malformed signed data");
+		return 0;
+	}
+
+	uint8_t has_certificates = der_read_tag(&signed_data, DER_CONTEXT(0), &certificates);
+	der_read_tag(&signed_data, DER_CONTEXT(1), &node);
+	if (!der_read_tag(&signed_data, DER_SET, &signer_infos)) {
+		ppelib_set_error("Malformed signed data");
+		return 0;
+	}
+
+	der_reader_t reader;
+	der_enter(&signer_infos, &reader);
+
+	signer_info_t info;
+	if (!der_read_tag(&reader, DER_SEQUENCE, &node) || !signer_info_read(&node, &info)) {
+		ppelib_set_error("Malformed signer info");
+		return 0;
+	}
+
+	if (info.has_issuer_and_serial) {
+		span_set(&signer->issuer, info.issuer.encoding, info.issuer.encoding_size);
+		span_set(&signer->serial, info.serial.contents, info.serial.size);
+		if (has_certificates) {
+			subject_find(&certificates, &info, &signer->subject);
+		}
+	}
+
+	span_set(&signer->digest_algorithm, info.digest_algorithm.contents, info.digest_algorithm.size);
+	signer->digest = digest_from_oid(&info.digest_algorithm);
+
+	signing_time_find(&info, &signer->signing_time);
+	image_digest_find(&content_info, signer);
+
+	return 1;
+}
+
+EXPORT_SYM certificate_table_t *ppelib_get_certificate_table(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	certificate_table_load(pe);
+	if (ppelib_error_peek()) {
+		context_take_error(pe->context);
+		return NULL;
+	}
+
+	context_take_error(pe->context);
+	return &pe->certificate_table;
+}
+
+EXPORT_SYM uint32_t ppelib_certificate_table_get_size(const certificate_table_t *table) {
+	ppelib_reset_error();
+
+	return table->size;
+}
+
+EXPORT_SYM uint8_t ppelib_certificate_table_get(const certificate_table_t *table, uint32_t certificate_index,
+		certificate_t *certificate) {
+	ppelib_reset_error();
+
+	if (certificate_index >= table->size) {
+		ppelib_set_error("Certificate index out of range");
+		return 0;
+	}
+
+	*certificate = table->certificates[certificate_index];
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_certificate_get_signer(const certificate_t *certificate, signer_t *signer) {
+	ppelib_reset_error();
+
+	return certificate_signer(certificate, signer);
+}
+
+EXPORT_SYM uint32_t ppelib_has_signature(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	if (pe->header.number_of_rva_and_sizes <= DIR_CERTIFICATE_TABLE) {
+		return 0;
+	}
+
+	if (pe->data_directories[DIR_CERTIFICATE_TABLE].size) {
+		return 1;
+	}
+
+	return 0;
+}
+
+EXPORT_SYM void ppelib_signature_remove(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	if (!ppelib_has_signature(pe)) {
+		return;
+	}
+
+	data_directory_t *data_directory = &pe->data_directories[DIR_CERTIFICATE_TABLE];
+	size_t offset = data_directory->offset;
+	size_t size = data_directory->size;
+
+	// A table outside of the file only loses its directory entry
+	if (offset <= pe->overlay_size && size <= pe->overlay_size - offset) {
+		const uint8_t *overlay = overlay_get(pe);
+		if (!overlay) {
+			context_take_error(pe->context);
+			return;
+		}
+
+		uint8_t *new_overlay = NULL;
+		size_t new_size = pe->overlay_size - size;
+		if (new_size) {
+			new_overlay = malloc(new_size);
+			if (!new_overlay) {
+				ppelib_set_error("Failed to allocate new overlay data");
+				context_take_error(pe->context);
+				return;
+			}
+
+			memcpy(new_overlay, overlay, offset);
+			memcpy(new_overlay + offset, overlay + offset + size, new_size - offset);
+		}
+
+		buffer_free(pe, pe->overlay);
+		pe->overlay = new_overlay;
+		pe->overlay_size = new_size;
+		pe->overlay_modified = 1;
+	}
+
+	certificate_table_reset(pe);
+
+	data_directory->offset = 0;
+	data_directory->size = 0;
+	pe->changed = 1;
+
+	ppelib_recalculate(pe);
+	context_take_error(pe->context);
+}
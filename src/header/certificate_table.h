@@ -0,0 +1,62 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_CERTIFICATE_TABLE_H_
+#define PPELIB_CERTIFICATE_TABLE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define CERTIFICATE_HEADER_SIZE 8
+
+typedef struct ppelib_file ppelib_file_t;
+
+// Certificates point into the overlay and stay valid until it is modified
+typedef struct certificate {
+	uint32_t length;
+	uint16_t revision;
+	uint16_t certificate_type;
+	const uint8_t *data;
+	size_t size;
+} certificate_t;
+
+typedef struct certificate_table {
+	certificate_t *certificates;
+	uint32_t size;
+
+	ppelib_file_t *pe;
+} certificate_table_t;
+
+// Same layout as ppelib_span
+typedef struct span {
+	const uint8_t *data;
+	size_t size;
+} span_t;
+
+// Same layout as ppelib_signer
+typedef struct signer {
+	span_t subject;
+	span_t issuer;
+	span_t serial;
+	span_t digest_algorithm;
+	uint32_t digest;
+	span_t signing_time;
+	span_t image_digest;
+	uint32_t image_digest_algorithm;
+} signer_t;
+
+#endif /* PPELIB_CERTIFICATE_TABLE_H_ */
@@ -0,0 +1,284 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+
+#include "generated/export_directory_table_private.h"
+#include "generated/section_private.h"
+
+#include "export_table.h"
+
+// Contents of size bytes at rva, NULL if they aren't all in one section
+static const uint8_t *export_rva_pointer(ppelib_file_t *pe, uint32_t rva, size_t size, size_t *available) {
+	section_t *section = section_find_by_virtual_address(pe, rva);
+	if (!section || !section_get_contents(section)) {
+		return NULL;
+	}
+
+	size_t offset = rva - section->virtual_address;
+	if (offset > section->contents_size || size > section->contents_size - offset) {
+		return NULL;
+	}
+
+	if (available) {
+		*available = section->contents_size - offset;
+	}
+
+	return section->contents + offset;
+}
+
+static const char *export_rva_string(ppelib_file_t *pe, uint32_t rva) {
+	size_t available;
+	const char *string = (const char *)export_rva_pointer(pe, rva, 1, &available);
+	if (!string || strnlen(string, available) == available) {
+		return NULL;
+	}
+
+	return string;
+}
+
+static const uint8_t *export_table_get(const export_table_t *export_table, uint32_t rva, uint32_t entries,
+		size_t entry_size) {
+	return export_rva_pointer(export_table->pe, rva, (size_t)entries * entry_size, NULL);
+}
+
+static const char *export_name(const export_table_t *export_table, const uint8_t *name_pointers, uint32_t index) {
+	return export_rva_string(export_table->pe, read_uint32_t(name_pointers + (size_t)index * 4));
+}
+
+// Returns why the table couldn't be loaded, NULL if it could
+static const char *export_table_parse(ppelib_file_t *pe) {
+	export_table_t *export_table = &pe->export_table;
+	memset(export_table, 0, sizeof(export_table_t));
+	export_table->pe = pe;
+
+	if (pe->header.number_of_rva_and_sizes <= DIR_EXPORT_TABLE) {
+		return NULL;
+	}
+
+	const data_directory_t *data_directory = &pe->data_directories[DIR_EXPORT_TABLE];
+	if (!data_directory->section || !data_directory->size) {
+		return NULL;
+	}
+
+	export_table->rva = data_directory->section->virtual_address + (uint32_t)data_directory->offset;
+	export_table->size = (uint32_t)data_directory->size;
+
+	const uint8_t *directory = export_rva_pointer(pe, export_table->rva, EXPORT_DIRECTORY_TABLE_SIZE, NULL);
+	if (!directory) {
+		return ppelib_error_peek() ? "Failed to read export directory" : "Export directory outside of section";
+	}
+
+	export_directory_table_decode(directory, &export_table->directory);
+	const export_directory_table_t *dir = &export_table->directory;
+
+	// Empty tables have their RVAs set to 0, which no section holds
+	if (dir->address_table_entries
+			&& !export_table_get(export_table, dir->export_address_table_rva, dir->address_table_entries, 4)) {
+		return "Export address table outside of section";
+	}
+
+	const uint8_t *name_pointers = NULL;
+	if (dir->number_of_name_pointers) {
+		name_pointers = export_table_get(export_table, dir->name_pointer_rv_a, dir->number_of_name_pointers, 4);
+		if (!name_pointers) {
+			return "Export name pointer table outside of section";
+		}
+
+		if (!export_table_get(export_table, dir->ordinal_table_rv_a, dir->number_of_name_pointers, 2)) {
+			return "Export ordinal table outside of section";
+		}
+	}
+
+	// The loader binary searches this table too, but nothing stops a file from
+	// getting it wrong.
+	export_table->names_sorted = 1;
+	const char *previous = NULL;
+	for (uint32_t i = 0; i < dir->number_of_name_pointers; ++i) {
+		const char *name = export_name(export_table, name_pointers, i);
+		if (!name) {
+			return "Export name outside of section";
+		}
+
+		if (previous && strcmp(previous, name) > 0) {
+			export_table->names_sorted = 0;
+		}
+		previous = name;
+	}
+
+	return NULL;
+}
+
+// A table that failed to load isn't parsed again, later calls get the same error
+void export_table_load(ppelib_file_t *pe) {
+	if (!pe->export_table_loaded) {
+		pe->export_table_error = export_table_parse(pe);
+		pe->export_table_loaded = 1;
+	}
+
+	if (pe->export_table_error) {
+		ppelib_set_error(pe->export_table_error);
+	}
+}
+
+static uint8_t export_from_index(export_table_t *export_table, uint32_t index, const char *name,
+		export_lookup_t *export) {
+	const export_directory_table_t *dir = &export_table->directory;
+	if (index >= dir->address_table_entries) {
+		return 0;
+	}
+
+	const uint8_t *addresses = export_table_get(export_table, dir->export_address_table_rva, dir->address_table_entries, 4);
+	if (!addresses) {
+		return 0;
+	}
+
+	uint32_t rva = read_uint32_t(addresses + (size_t)index * 4);
+	if (!rva) {
+		// Gaps in the ordinals
+		return 0;
+	}
+
+	if (export) {
+		export->name = name;
+		export->ordinal = dir->ordinal_base + index;
+		export->rva = rva;
+		export->forwarder = NULL;
+
+		if (rva - export_table->rva < export_table->size) {
+			export->rva = 0;
+			export->forwarder = export_rva_string(export_table->pe, rva);
+		}
+	}
+
+	return 1;
+}
+
+static uint8_t export_from_name_index(export_table_t *export_table, uint32_t name_index, export_lookup_t *export) {
+	const export_directory_table_t *dir = &export_table->directory;
+	if (name_index >= dir->number_of_name_pointers) {
+		return 0;
+	}
+
+	const uint8_t *name_pointers = export_table_get(export_table, dir->name_pointer_rv_a, dir->number_of_name_pointers, 4);
+	const uint8_t *ordinals = export_table_get(export_table, dir->ordinal_table_rv_a, dir->number_of_name_pointers, 2);
+	if (!name_pointers || !ordinals) {
+		return 0;
+	}
+
+	const char *name = export_name(export_table, name_pointers, name_index);
+	uint16_t index = read_uint16_t(ordinals + (size_t)name_index * 2);
+
+	return export_from_index(export_table, index, name, export);
+}
+
+EXPORT_SYM const char *ppelib_export_table_get_dll_name(export_table_t *export_table) {
+	ppelib_reset_error();
+
+	if (!export_table->directory.name_rva) {
+		return NULL;
+	}
+
+	return export_rva_string(export_table->pe, export_table->directory.name_rva);
+}
+
+EXPORT_SYM uint32_t ppelib_export_table_get_number_of_names(const export_table_t *export_table) {
+	ppelib_reset_error();
+
+	return export_table->directory.number_of_name_pointers;
+}
+
+EXPORT_SYM uint8_t ppelib_export_table_get_name(export_table_t *export_table, uint32_t name_index,
+		export_lookup_t *export) {
+	ppelib_reset_error();
+
+	if (name_index >= export_table->directory.number_of_name_pointers) {
+		ppelib_set_error("Export name index out of range");
+		return 0;
+	}
+
+	return export_from_name_index(export_table, name_index, export);
+}
+
+EXPORT_SYM uint8_t ppelib_export_table_find(export_table_t *export_table, const char *name, export_lookup_t *export) {
+	ppelib_reset_error();
+
+	const export_directory_table_t *dir = &export_table->directory;
+	if (!name || !dir->number_of_name_pointers) {
+		return 0;
+	}
+
+	const uint8_t *name_pointers = export_table_get(export_table, dir->name_pointer_rv_a, dir->number_of_name_pointers, 4);
+	if (!name_pointers) {
+		return 0;
+	}
+
+	if (!export_table->names_sorted) {
+		for (uint32_t i = 0; i < dir->number_of_name_pointers; ++i) {
+			const char *export_name_i = export_name(export_table, name_pointers, i);
+			if (export_name_i && strcmp(export_name_i, name) == 0) {
+				return export_from_name_index(export_table, i, export);
+			}
+		}
+
+		return 0;
+	}
+
+	uint32_t low = 0;
+	uint32_t high = dir->number_of_name_pointers;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		const char *middle_name = export_name(export_table, name_pointers, middle);
+		if (!middle_name) {
+			return 0;
+		}
+
+		int compare = strcmp(middle_name, name);
+		if (!compare) {
+			return export_from_name_index(export_table, middle, export);
+		}
+
+		if (compare < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return 0;
+}
+
+EXPORT_SYM uint8_t ppelib_export_table_find_ordinal(export_table_t *export_table, uint32_t ordinal,
+		export_lookup_t *export) {
+	ppelib_reset_error();
+
+	const export_directory_table_t *dir = &export_table->directory;
+	if (ordinal < dir->ordinal_base) {
+		return 0;
+	}
+
+	// Looking the name up would mean scanning the ordinal table, so it is left NULL
+	return export_from_index(export_table, ordinal - dir->ordinal_base, NULL, export);
+}
@@ -0,0 +1,46 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_EXPORT_TABLE_H_
+#define PPELIB_EXPORT_TABLE_H_
+
+#include "generated/export_directory_table_private.h"
+
+// The export table isn't copied out of the file. Its tables are looked up through
+// the sections on every use, so names point into section contents and stay valid
+// until the section holding them is modified.
+typedef struct export_table {
+	export_directory_table_t directory;
+
+	// RVA range of the export directory, exports pointing inside are forwarders
+	uint32_t rva;
+	uint32_t size;
+
+	// Binary search needs the name pointer table in strcmp() order
+	uint8_t names_sorted;
+
+	ppelib_file_t *pe;
+} export_table_t;
+
+typedef struct export_lookup {
+	const char *name;
+	uint32_t ordinal;
+	uint32_t rva;
+	const char *forwarder;
+} export_lookup_t;
+
+#endif /* PPELIB_EXPORT_TABLE_H_ */
@@ -25,15 +25,65 @@
 #include "main.h"
 #include "platform.h"
 #include "ppe_error.h"
+#include "ppelib_internal.h"
 
+#include "export_table.h"
 #include "import_table.h"
+#include "resource_table.h"
+#include "symbol_table.h"
+
+EXPORT_SYM export_table_t *ppelib_get_export_table(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	export_table_load(pe);
+	if (ppelib_error_peek()) {
+		context_take_error(pe->context);
+		return NULL;
+	}
+
+	context_take_error(pe->context);
+	return &pe->export_table;
+}
 
 EXPORT_SYM import_table_t *ppelib_get_import_table(ppelib_file_t *pe) {
 	ppelib_reset_error();
 
+	import_table_load(pe);
+	if (ppelib_error_peek()) {
+		context_take_error(pe->context);
+		return NULL;
+	}
+
+	context_take_error(pe->context);
 	return &pe->import_table;
 }
 
+EXPORT_SYM resource_table_t *ppelib_get_resource_table(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	resource_table_load(pe);
+	if (ppelib_error_peek()) {
+		context_take_error(pe->context);
+		return NULL;
+	}
+
+	context_take_error(pe->context);
+	return &pe->resource_table;
+}
+
+EXPORT_SYM symbol_table_t *ppelib_get_symbol_table(ppelib_file_t *pe) {
+	ppelib_reset_error();
+
+	symbol_table_load(pe);
+	if (ppelib_error_peek()) {
+		context_take_error(pe->context);
+		return NULL;
+	}
+
+	context_take_error(pe->context);
+	return &pe->symbol_table;
+}
+
 EXPORT_SYM header_t *ppelib_header_get(ppelib_file_t *pe) {
 	ppelib_reset_error();
 
@@ -125,4 +175,5 @@ EXPORT_SYM void ppelib_set_header(ppelib_file_t *pe, header_t *header) {
 	}
 
 	memcpy(&pe->header, header, sizeof(header_t));
+	pe->changed = 1;
 }
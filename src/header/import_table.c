@@ -49,42 +49,169 @@ EXPORT_SYM void ppelib_import_table_print(import_table_t *import_table) {
 	ppelib_import_table_fprint(stdout, import_table);
 }
 
-void import_table_entry_free(import_table_entry_t *entry) {
-	for (size_t i = 0; i < entry->size; ++i) {
-		free(entry->names[i].name);
+// Lazily parsed files don't touch the import table until it is first asked for.
+void import_table_load(ppelib_file_t *pe) {
+	if (pe->import_table_loaded) {
+		return;
 	}
 
-	free(entry->dll_name);
-	free(entry->names);
-}
+	if (pe->header.number_of_rva_and_sizes > DIR_IMPORT_TABLE) {
+		section_t *section = pe->data_directories[DIR_IMPORT_TABLE].section;
+		size_t offset = pe->data_directories[DIR_IMPORT_TABLE].offset;
 
-void import_table_free(import_table_t *import_table) {
-	for (size_t i = 0; i < import_table->size; ++i) {
-		import_table_entry_free(&import_table->entries[i]);
+		if (section) {
+			parse_import_table(section, offset, &pe->import_table, pe->header.magic);
+			if (ppelib_error_peek()) {
+				// Whatever was parsed stays in the arena until ppelib_destroy()
+				memset(&pe->import_table, 0, sizeof(import_table_t));
+				return;
+			}
+		}
 	}
 
-	free(import_table->entries);
+	pe->import_table.pe = pe;
+	pe->import_table_loaded = 1;
 }
 
-void parse_import_table(const section_t *section, size_t offset, import_table_t *import_table, uint16_t magic) {
-	if (section->contents_size == IMPORT_DIRECTORY_TABLE_SIZE) {
-		// Empty table
-		return;
+// The table is walked twice. The first pass validates it and counts what it holds,
+// the second fills the entries, names and strings allocated in one go in between.
+typedef struct import_slab {
+	import_table_entry_t *entries;
+	import_table_name_t *names;
+	char *strings;
+} import_slab_t;
+
+typedef struct import_counts {
+	size_t entries;
+	size_t names;
+	size_t strings;
+} import_counts_t;
+
+static char *slab_string(import_slab_t *slab, const uint8_t *string, size_t size) {
+	char *retval = slab->strings;
+	memcpy(retval, string, size);
+	retval[size] = 0;
+	slab->strings += size + 1;
+
+	return retval;
+}
+
+// Walks the lookup table and names of one descriptor. Returns 0 if any of it is
+// outside of the section, with the error set.
+static uint8_t walk_import_descriptor(section_t *section, const import_directory_table_t *import_directory_table,
+		size_t il_stride, import_counts_t *counts, import_slab_t *slab) {
+	size_t dll_name_offset = section_rva_to_offset(section, import_directory_table->name_rva);
+	if (ppelib_error_peek()) {
+		return 0;
 	}
 
-	if (magic != PE32_MAGIC && magic != PE32PLUS_MAGIC) {
-		ppelib_set_error("Unknown magic value");
-		return;
+	size_t ilt_offset = section_rva_to_offset(section, import_directory_table->import_address_table_rva);
+	if (ppelib_error_peek()) {
+		return 0;
+	}
+
+	import_table_entry_t *entry = NULL;
+	if (slab) {
+		entry = slab->entries++;
+		entry->names = slab->names;
+		entry->forwarder_chain = import_directory_table->forwarder_chain;
+		entry->date_time_stamp = import_directory_table->time_date_stamp;
+		entry->import_address_table_rva = import_directory_table->import_address_table_rva;
 	}
 
+	while (1) {
+		if (ilt_offset + il_stride > section->contents_size) {
+			ppelib_set_error("Import Lookup Table outside of section");
+			return 0;
+		}
+
+		uint64_t il;
+		uint8_t is_ordinal;
+		if (il_stride == 4) {
+			il = read_uint32_t(section->contents + ilt_offset);
+			is_ordinal = CHECK_BIT(il, HIGH_BIT32) != 0;
+		} else {
+			il = read_uint64_t(section->contents + ilt_offset);
+			is_ordinal = CHECK_BIT(il, HIGH_BIT64) != 0;
+		}
+
+		if (!il) {
+			break;
+		}
+
+		++counts->names;
+		import_table_name_t *sym_name = NULL;
+		if (slab) {
+			++entry->size;
+			sym_name = slab->names++;
+		}
+
+		if (is_ordinal) {
+			if (sym_name) {
+				sym_name->ordinal = (uint16_t)il;
+			}
+		} else {
+			size_t hint_offset = section_rva_to_offset(section, (uint32_t)il);
+			if (ppelib_error_peek()) {
+				return 0;
+			}
+
+			if (hint_offset + 2 > section->contents_size) {
+				ppelib_set_error("Symbol hint outside of section");
+				return 0;
+			}
+
+			size_t sym_name_offset = hint_offset + 2;
+			size_t sym_name_max_size = section->contents_size - sym_name_offset;
+			size_t sym_name_size = strnlen((const char *)section->contents + sym_name_offset, sym_name_max_size);
+			if (sym_name_size == sym_name_max_size) {
+				ppelib_set_error("Symbol name outside of section");
+				return 0;
+			}
+
+			counts->strings += sym_name_size + 1;
+			if (sym_name) {
+				sym_name->hint = read_uint16_t(section->contents + hint_offset);
+				sym_name->name = slab_string(slab, section->contents + sym_name_offset, sym_name_size);
+			}
+		}
+		ilt_offset += il_stride;
+	}
+
+	size_t dll_name_max_size = section->contents_size - dll_name_offset;
+	size_t dll_name_size = strnlen((const char *)section->contents + dll_name_offset, dll_name_max_size);
+	if (dll_name_size == dll_name_max_size) {
+		ppelib_set_error("DLL name outside of section");
+		return 0;
+	}
+
+	++counts->entries;
+	counts->strings += dll_name_size + 1;
+	if (entry) {
+		entry->dll_name = slab_string(slab, section->contents + dll_name_offset, dll_name_size);
+	}
+
+	return 1;
+}
+
+// The list ends at the null descriptor or at the first descriptor that doesn't hold
+// together, the ones before it are kept. The second pass stops after the
+// max_entries descriptors the first one counted.
+static void walk_import_table(section_t *section, size_t offset, uint16_t magic, size_t max_entries,
+		import_counts_t *counts, import_slab_t *slab) {
 	size_t scan_offset = offset;
-	import_table->entries = NULL;
 
-	while (section->contents_size - scan_offset >= IMPORT_DIRECTORY_TABLE_SIZE) {
+	size_t il_stride = 4;
+	if (magic == PE32PLUS_MAGIC) {
+		il_stride = 8;
+	}
+
+	while (counts->entries < max_entries && section->contents_size - scan_offset >= IMPORT_DIRECTORY_TABLE_SIZE) {
 		import_directory_table_t import_directory_table;
 
 		ppelib_import_directory_table_deserialize(section->contents, section->contents_size, scan_offset, &import_directory_table);
 		if (ppelib_error_peek()) {
+			ppelib_reset_error();
 			return;
 		}
 
@@ -92,106 +219,212 @@ void parse_import_table(const section_t *section, size_t offset, import_table_t
 			break; // null buffer
 		}
 
-		size_t dll_name_offset = section_rva_to_offset(section, import_directory_table.name_rva);
-		if (ppelib_error_peek()) {
+		import_counts_t counted = *counts;
+		if (!walk_import_descriptor(section, &import_directory_table, il_stride, counts, slab)) {
+			*counts = counted;
+			ppelib_reset_error();
 			return;
 		}
 
-		++import_table->size;
-		size_t new_size = sizeof(import_table_entry_t) * import_table->size;
+		scan_offset += IMPORT_DIRECTORY_TABLE_SIZE;
+	}
+}
 
-		import_table->entries = realloc(import_table->entries, new_size);
-		if (!import_table->entries) {
-			ppelib_set_error("Allocating import table directory failed");
-			return;
-		}
+void parse_import_table(section_t *section, size_t offset, import_table_t *import_table, uint16_t magic) {
+	if (section->contents_size == IMPORT_DIRECTORY_TABLE_SIZE) {
+		// Empty table
+		return;
+	}
 
-		import_table_entry_t *entry = &import_table->entries[import_table->size - 1];
-		memset(entry, 0, sizeof(import_table_entry_t));
+	if (magic != PE32_MAGIC && magic != PE32PLUS_MAGIC) {
+		ppelib_set_error("Unknown magic value");
+		return;
+	}
 
-		size_t ilt_offset = section_rva_to_offset(section, import_directory_table.import_address_table_rva);
+	if (!section_get_contents(section)) {
+		return;
+	}
 
-		size_t il_stride = 4;
-		if (magic == PE32PLUS_MAGIC) {
-			il_stride = 8;
-		}
+	import_counts_t counts;
+	memset(&counts, 0, sizeof(import_counts_t));
+	walk_import_table(section, offset, magic, SIZE_MAX, &counts, NULL);
+	if (!counts.entries) {
+		return;
+	}
 
-		while (1) {
-			if (ilt_offset + il_stride > section->contents_size) {
-				ppelib_set_error("Import Lookup Table outside of section");
-				return;
-			}
+	// Descriptors can share lookup tables so the names aren't bounded by the section size
+	if (counts.names > SIZE_MAX / sizeof(import_table_name_t)) {
+		ppelib_set_error("Import table too large");
+		return;
+	}
 
-			uint64_t il;
-			if (il_stride == 4) {
-				il = read_uint32_t(section->contents + ilt_offset);
-			} else {
-				il = read_uint64_t(section->contents + ilt_offset);
-			}
+	arena_t *arena = &section->pe->arena;
+	import_slab_t slab;
+	slab.entries = arena_calloc(arena, sizeof(import_table_entry_t) * counts.entries);
+	slab.names = arena_calloc(arena, sizeof(import_table_name_t) * MAX(counts.names, 1));
+	slab.strings = arena_alloc(arena, counts.strings);
+	if (!slab.entries || !slab.names || !slab.strings) {
+		ppelib_set_error("Allocating import table failed");
+		return;
+	}
 
-			if (!il) {
-				break;
-			}
+	import_table->entries = slab.entries;
+	import_table->size = counts.entries;
+	import_table->thunk_size = magic == PE32PLUS_MAGIC ? 8 : 4;
 
-			++entry->size;
-			entry->names = realloc(entry->names, sizeof(import_table_name_t) * entry->size);
-			if (!entry->names) {
-				ppelib_set_error("Failed to allocate import entry name");
-				goto out;
-			}
-			import_table_name_t *sym_name = &entry->names[entry->size - 1];
-			memset(sym_name, 0, sizeof(import_table_name_t));
-
-			uint8_t is_ordinal = 0;
-			if (il_stride == 4) {
-				if (CHECK_BIT(il, HIGH_BIT32)) {
-					sym_name->ordinal = (uint16_t)il;
-					is_ordinal = 1;
-				}
-			} else {
-				if (CHECK_BIT(il, HIGH_BIT64)) {
-					sym_name->ordinal = (uint16_t)il;
-					is_ordinal = 1;
-				}
+	size_t number_of_entries = counts.entries;
+	memset(&counts, 0, sizeof(import_counts_t));
+	walk_import_table(section, offset, magic, number_of_entries, &counts, &slab);
+}
+
+// DLL names compare case-insensitively, Windows' loader doesn't care either
+static char ascii_lower(char c) {
+	if (c >= 'A' && c <= 'Z') {
+		return (char)(c - 'A' + 'a');
+	}
+
+	return c;
+}
+
+static uint8_t dll_name_equal(const char *a, const char *b) {
+	while (*a && ascii_lower(*a) == ascii_lower(*b)) {
+		++a;
+		++b;
+	}
+
+	return ascii_lower(*a) == ascii_lower(*b);
+}
+
+// FNV-1a over the lowercased DLL name followed by either the symbol name or the ordinal
+static uint32_t import_hash(const char *dll_name, const char *name, uint16_t ordinal) {
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for (const char *c = dll_name; *c; ++c) {
+		hash = fnv1a_byte(hash, (uint8_t)ascii_lower(*c));
+	}
+
+	if (name) {
+		return fnv1a_string(fnv1a_byte(hash, 1), name);
+	}
+
+	hash = fnv1a_byte(hash, 2);
+	hash = fnv1a_byte(hash, (uint8_t)ordinal);
+	return fnv1a_byte(hash, (uint8_t)(ordinal >> 8));
+}
+
+static uint8_t import_index_build(import_table_t *import_table) {
+	if (import_table->index) {
+		return 1;
+	}
+
+	size_t number_of_names = 0;
+	for (size_t i = 0; i < import_table->size; ++i) {
+		number_of_names += import_table->entries[i].size;
+	}
+
+	if (number_of_names > SIZE_MAX / 2 / sizeof(import_index_slot_t) || import_table->size > UINT32_MAX - 1) {
+		ppelib_set_error("Import table too large to index");
+		return 0;
+	}
+
+	size_t capacity = hash_index_capacity(number_of_names);
+
+	import_index_slot_t *index = arena_calloc(&import_table->pe->arena, sizeof(import_index_slot_t) * capacity);
+	if (!index) {
+		ppelib_set_error("Failed to allocate import index");
+		return 0;
+	}
+
+	for (size_t i = 0; i < import_table->size; ++i) {
+		const import_table_entry_t *entry = &import_table->entries[i];
+
+		for (size_t l = 0; l < entry->size; ++l) {
+			const import_table_name_t *name = &entry->names[l];
+			uint32_t hash = import_hash(entry->dll_name, name->name, name->ordinal);
+
+			// A name imported twice is found as its first import
+			size_t slot = hash_index_first(hash, capacity);
+			while (index[slot].entry) {
+				slot = hash_index_next(slot, capacity);
 			}
 
-			if (!is_ordinal) {
-				size_t hint_offset = section_rva_to_offset(section, (uint32_t)il);
-				if (hint_offset + 2 > section->contents_size) {
-					ppelib_set_error("Symbol hint outside of section");
-					goto out;
-				}
-				sym_name->hint = read_uint16_t(section->contents + hint_offset);
+			index[slot].hash = hash;
+			index[slot].entry = (uint32_t)(i + 1);
+			index[slot].name = l;
+		}
+	}
+
+	import_table->index = index;
+	import_table->index_capacity = capacity;
+	return 1;
+}
+
+static uint8_t import_table_find(import_table_t *import_table, const char *dll_name, const char *name,
+		uint16_t ordinal, import_lookup_t *import) {
+	if (!dll_name) {
+		ppelib_set_error("No DLL name given");
+		return 0;
+	}
+
+	if (!import_table->size || !import_index_build(import_table)) {
+		return 0;
+	}
+
+	uint32_t hash = import_hash(dll_name, name, ordinal);
+	size_t capacity = import_table->index_capacity;
+
+	for (size_t slot = hash_index_first(hash, capacity); import_table->index[slot].entry;
+			slot = hash_index_next(slot, capacity)) {
+		const import_index_slot_t *index_slot = &import_table->index[slot];
+		if (index_slot->hash != hash) {
+			continue;
+		}
 
-				size_t sym_name_offset = hint_offset + 2;
-				size_t sym_name_max_size = section->contents_size - sym_name_offset;
-				size_t sym_name_size = strnlen((const char *)section->contents + sym_name_offset, sym_name_max_size);
-				if (sym_name_size == sym_name_max_size) {
-					ppelib_set_error("Symbol name outside of section");
-					goto out;
-				}
+		const import_table_entry_t *entry = &import_table->entries[index_slot->entry - 1];
+		const import_table_name_t *entry_name = &entry->names[index_slot->name];
 
-				sym_name->name = strdup((const char *)section->contents + sym_name_offset);
+		if (name) {
+			if (!entry_name->name || strcmp(entry_name->name, name) != 0) {
+				continue;
 			}
-			ilt_offset += il_stride;
+		} else if (entry_name->name || entry_name->ordinal != ordinal) {
+			continue;
 		}
 
-		size_t dll_name_max_size = section->contents_size - dll_name_offset;
-		size_t dll_name_size = strnlen((const char *)section->contents + dll_name_offset, dll_name_max_size);
-		if (dll_name_size == dll_name_max_size) {
-			ppelib_set_error("DLL name outside of section");
-			goto out;
+		if (!dll_name_equal(entry->dll_name, dll_name)) {
+			continue;
 		}
 
-		entry->dll_name = strdup((const char *)section->contents + dll_name_offset);
+		if (import) {
+			import->dll_name = entry->dll_name;
+			import->name = entry_name->name;
+			import->hint = entry_name->hint;
+			import->ordinal = entry_name->ordinal;
+			import->import_address_table_rva = entry->import_address_table_rva
+					+ (uint32_t)(index_slot->name * import_table->thunk_size);
+		}
 
-		scan_offset += IMPORT_DIRECTORY_TABLE_SIZE;
+		return 1;
+	}
+
+	return 0;
+}
+
+EXPORT_SYM uint8_t ppelib_import_table_find(import_table_t *import_table, const char *dll_name, const char *name,
+		import_lookup_t *import) {
+	ppelib_reset_error();
+
+	if (!name) {
+		ppelib_set_error("No symbol name given");
+		return 0;
 	}
 
-	return;
-out:
-	--import_table->size;
-	import_table_entry_free(&import_table->entries[import_table->size]);
-	import_table->entries = realloc(import_table->entries, sizeof(import_table_entry_t) * import_table->size);
-	return;
+	return import_table_find(import_table, dll_name, name, 0, import);
+}
+
+EXPORT_SYM uint8_t ppelib_import_table_find_ordinal(import_table_t *import_table, const char *dll_name,
+		uint16_t ordinal, import_lookup_t *import) {
+	ppelib_reset_error();
+
+	return import_table_find(import_table, dll_name, NULL, ordinal, import);
 }
@@ -32,14 +32,38 @@ typedef struct import_table_entry {
 
 	uint32_t forwarder_chain;
 	uint32_t date_time_stamp;
+	uint32_t import_address_table_rva;
 
 	import_table_name_t *names;
 } import_table_entry_t;
 
+typedef struct import_index_slot {
+	uint32_t hash;
+	// 0 marks an empty slot, otherwise the entry index + 1
+	uint32_t entry;
+	size_t name;
+} import_index_slot_t;
+
 typedef struct import_table {
 	size_t size;
 
 	import_table_entry_t *entries;
+	// Size of the IAT slots
+	uint8_t thunk_size;
+
+	ppelib_file_t *pe;
+
+	// Built on the first ppelib_import_table_find*() call
+	import_index_slot_t *index;
+	size_t index_capacity;
 } import_table_t;
 
+typedef struct import_lookup {
+	const char *dll_name;
+	const char *name;
+	uint16_t hint;
+	uint16_t ordinal;
+	uint32_t import_address_table_rva;
+} import_lookup_t;
+
 #endif /* PPELIB_IMPORT_TABLE_H_ */
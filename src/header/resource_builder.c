@@ -0,0 +1,693 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+#include "unicode.h"
+
+#include "generated/section_private.h"
+
+#include "resource_table.h"
+
+static uint32_t hash_uint32(uint32_t hash, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		hash = fnv1a_byte(hash, (uint8_t)(value >> (i * 8)));
+	}
+
+	return hash;
+}
+
+// Names are hashed and compared the way the loader finds them, ASCII letters
+// without case
+static uint32_t node_hash(const resource_node_t *parent, const uint8_t *name, uint16_t name_length, uint32_t id) {
+	uint32_t hash = hash_uint32(FNV_OFFSET_BASIS, parent->index);
+	if (!name) {
+		return hash_uint32(fnv1a_byte(hash, 0), id);
+	}
+
+	for (uint16_t i = 0; i < name_length; ++i) {
+		uint32_t c = ascii_upper(read_uint16_t(name + (size_t)i * 2));
+		hash = fnv1a_byte(hash, (uint8_t)c);
+		hash = fnv1a_byte(hash, (uint8_t)(c >> 8));
+	}
+
+	return hash;
+}
+
+static int name_compare(const uint8_t *a, uint16_t a_length, const uint8_t *b, uint16_t b_length) {
+	for (uint16_t i = 0; i < a_length && i < b_length; ++i) {
+		uint32_t ca = ascii_upper(read_uint16_t(a + (size_t)i * 2));
+		uint32_t cb = ascii_upper(read_uint16_t(b + (size_t)i * 2));
+		if (ca != cb) {
+			return ca < cb ? -1 : 1;
+		}
+	}
+
+	return a_length == b_length ? 0 : (a_length < b_length ? -1 : 1);
+}
+
+static uint8_t node_matches(const resource_node_t *node, const resource_node_t *parent, const uint8_t *name,
+		uint16_t name_length, uint32_t id) {
+	if (node->parent != parent || !node->name != !name) {
+		return 0;
+	}
+
+	if (!name) {
+		return node->id == id;
+	}
+
+	return !name_compare(node->name, node->name_length, name, name_length);
+}
+
+static void node_index_insert(resource_node_slot_t *index, size_t capacity, uint32_t hash, resource_node_t *node) {
+	size_t i = hash_index_first(hash, capacity);
+	while (index[i].node) {
+		i = hash_index_next(i, capacity);
+	}
+
+	index[i].hash = hash;
+	index[i].node = node;
+}
+
+// Keeps the index at most half full. The old table stays in the arena, which costs
+// no more than the final one.
+static uint8_t node_index_grow(resource_builder_t *builder) {
+	if (((size_t)builder->number_of_nodes + 1) * 2 <= builder->index_capacity) {
+		return 1;
+	}
+
+	size_t capacity = MAX(builder->index_capacity * 2, 64);
+	resource_node_slot_t *index = arena_calloc(&builder->arena, sizeof(resource_node_slot_t) * capacity);
+	if (!index) {
+		ppelib_set_error("Failed to allocate resource index");
+		return 0;
+	}
+
+	for (size_t i = 0; i < builder->index_capacity; ++i) {
+		if (builder->index[i].node) {
+			node_index_insert(index, capacity, builder->index[i].hash, builder->index[i].node);
+		}
+	}
+
+	builder->index = index;
+	builder->index_capacity = capacity;
+	return 1;
+}
+
+// Finds the child of parent with name or id, or adds it
+static resource_node_t *node_child(resource_builder_t *builder, resource_node_t *parent, const uint8_t *name,
+		uint16_t name_length, uint32_t id, uint8_t is_directory) {
+	if (!parent->is_directory) {
+		ppelib_set_error("Resource entry holds data");
+		return NULL;
+	}
+
+	uint32_t hash = node_hash(parent, name, name_length, id);
+	if (builder->index_capacity) {
+		size_t capacity = builder->index_capacity;
+		for (size_t i = hash_index_first(hash, capacity); builder->index[i].node; i = hash_index_next(i, capacity)) {
+			resource_node_t *node = builder->index[i].node;
+			if (builder->index[i].hash == hash && node_matches(node, parent, name, name_length, id)) {
+				if (node->is_directory != is_directory) {
+					ppelib_set_error(node->is_directory ? "Resource entry is a directory" : "Resource entry holds data");
+					return NULL;
+				}
+
+				return node;
+			}
+		}
+	}
+
+	if (builder->number_of_nodes == UINT32_MAX || !node_index_grow(builder)) {
+		if (!ppelib_error_peek()) {
+			ppelib_set_error("Too many resource entries");
+		}
+		return NULL;
+	}
+
+	resource_node_t *node = arena_calloc(&builder->arena, sizeof(resource_node_t));
+	if (!node) {
+		ppelib_set_error("Failed to allocate resource entry");
+		return NULL;
+	}
+
+	node->name = name;
+	node->name_length = name_length;
+	node->id = id;
+	node->parent = parent;
+	node->index = builder->number_of_nodes++;
+	node->is_directory = is_directory;
+
+	if (parent->last_child) {
+		parent->last_child->next_sibling = node;
+	} else {
+		parent->first_child = node;
+	}
+	parent->last_child = node;
+	parent->number_of_children++;
+
+	if (name) {
+		parent->number_of_name_entries++;
+		builder->number_of_names++;
+	}
+
+	node_index_insert(builder->index, builder->index_capacity, hash, node);
+	builder->laid_out = 0;
+	return node;
+}
+
+static resource_node_t *node_child_key(resource_builder_t *builder, resource_node_t *parent, const resource_key_t *key,
+		uint8_t is_directory) {
+	if (!key->name) {
+		return node_child(builder, parent, NULL, 0, key->id, is_directory);
+	}
+
+	size_t length = utf8_utf16_length(key->name);
+	if (!length || length > UINT16_MAX) {
+		ppelib_set_error(length ? "Resource name too long" : "Resource name empty");
+		return NULL;
+	}
+
+	uint8_t *name = arena_alloc(&builder->arena, length * 2);
+	if (!name) {
+		ppelib_set_error("Failed to allocate resource name");
+		return NULL;
+	}
+
+	utf8_to_utf16(key->name, name);
+	return node_child(builder, parent, name, (uint16_t)length, 0, is_directory);
+}
+
+static resource_builder_t *resource_builder_create(const allocator_t *allocator) {
+	resource_builder_t *builder = allocator->malloc(allocator->userdata, sizeof(resource_builder_t));
+	if (!builder) {
+		ppelib_set_error("Failed to allocate resource builder");
+		return NULL;
+	}
+
+	memset(builder, 0, sizeof(resource_builder_t));
+	builder->arena.allocator = allocator;
+
+	builder->root = arena_calloc(&builder->arena, sizeof(resource_node_t));
+	if (!builder->root) {
+		ppelib_set_error("Failed to allocate resource builder");
+		allocator->free(allocator->userdata, builder);
+		return NULL;
+	}
+
+	builder->root->is_directory = 1;
+	builder->number_of_nodes = 1;
+	return builder;
+}
+
+EXPORT_SYM resource_builder_t *ppelib_resource_builder_create() {
+	ppelib_reset_error();
+
+	return resource_builder_create(&default_allocator);
+}
+
+EXPORT_SYM resource_builder_t *ppelib_context_resource_builder_create(ppelib_context_t *context) {
+	ppelib_reset_error();
+
+	resource_builder_t *builder = resource_builder_create(context_allocator(context));
+	context_take_error(context);
+
+	return builder;
+}
+
+EXPORT_SYM void ppelib_resource_builder_destroy(resource_builder_t *builder) {
+	if (!builder) {
+		return;
+	}
+
+	const allocator_t *allocator = builder->arena.allocator;
+	arena_free(&builder->arena);
+	allocator->free(allocator->userdata, builder);
+}
+
+EXPORT_SYM uint8_t ppelib_resource_builder_add(resource_builder_t *builder, const resource_key_t *type,
+		const resource_key_t *name, uint32_t language, const uint8_t *data, uint32_t size, uint32_t codepage) {
+	ppelib_reset_error();
+
+	if (!type || !name || (!data && size)) {
+		ppelib_set_error("Invalid resource");
+		return 0;
+	}
+
+	resource_node_t *node = node_child_key(builder, builder->root, type, 1);
+	if (node) {
+		node = node_child_key(builder, node, name, 1);
+	}
+	if (node) {
+		node = node_child(builder, node, NULL, 0, language, 0);
+	}
+	if (!node) {
+		return 0;
+	}
+
+	node->data = data;
+	node->size = size;
+	node->codepage = codepage;
+	builder->laid_out = 0;
+	return 1;
+}
+
+static uint8_t builder_add_directory(resource_builder_t *builder, resource_node_t *node,
+		resource_directory_t *directory) {
+	node->characteristics = directory->characteristics;
+	node->time_date_stamp = directory->time_date_stamp;
+	node->major_version = directory->major_version;
+	node->minor_version = directory->minor_version;
+
+	uint32_t number_of_entries = (uint32_t)directory->number_of_name_entries + directory->number_of_id_entries;
+	for (uint32_t i = 0; i < number_of_entries; ++i) {
+		resource_entry_t entry;
+		if (!resource_entry_read(directory, i, &entry)) {
+			return 0;
+		}
+
+		if (entry.name && !entry.name_length) {
+			ppelib_set_error("Resource name empty");
+			return 0;
+		}
+
+		resource_node_t *child = node_child(builder, node, entry.name, entry.name_length, entry.id,
+				entry.directory != NULL);
+		if (!child) {
+			return 0;
+		}
+
+		if (entry.directory) {
+			if (!builder_add_directory(builder, child, entry.directory)) {
+				return 0;
+			}
+			continue;
+		}
+
+		if (!entry.data.data && entry.data.size) {
+			ppelib_set_error("Resource data outside of section");
+			return 0;
+		}
+
+		child->data = entry.data.data;
+		child->size = entry.data.size;
+		child->codepage = entry.data.codepage;
+	}
+
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_resource_builder_add_table(resource_builder_t *builder, resource_table_t *table) {
+	ppelib_reset_error();
+
+	if (!table->root) {
+		return 1;
+	}
+
+	builder->laid_out = 0;
+	uint8_t retval = builder_add_directory(builder, builder->root, table->root);
+	context_take_error(table->pe->context);
+
+	return retval;
+}
+
+static int node_compare(const void *a, const void *b) {
+	const resource_node_t *node_a = *(resource_node_t *const *)a;
+	const resource_node_t *node_b = *(resource_node_t *const *)b;
+
+	// Named entries come first
+	if (!node_a->name != !node_b->name) {
+		return node_a->name ? -1 : 1;
+	}
+
+	if (node_a->name) {
+		return name_compare(node_a->name, node_a->name_length, node_b->name, node_b->name_length);
+	}
+
+	return node_a->id == node_b->id ? 0 : (node_a->id < node_b->id ? -1 : 1);
+}
+
+// Names are stored once however many entries use them
+static uint32_t string_intern(resource_builder_t *builder, const uint8_t *name, uint16_t name_length) {
+	uint32_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < (size_t)name_length * 2; ++i) {
+		hash = fnv1a_byte(hash, name[i]);
+	}
+
+	size_t capacity = builder->strings_index_capacity;
+	size_t i = hash_index_first(hash, capacity);
+	for (; builder->strings_index[i].string; i = hash_index_next(i, capacity)) {
+		const resource_string_t *string = &builder->strings[builder->strings_index[i].string - 1];
+		if (builder->strings_index[i].hash == hash && string->name_length == name_length
+				&& !memcmp(string->name, name, (size_t)name_length * 2)) {
+			return string->offset;
+		}
+	}
+
+	resource_string_t *string = &builder->strings[builder->number_of_strings++];
+	string->name = name;
+	string->name_length = name_length;
+	string->offset = (uint32_t)builder->strings_size;
+
+	builder->strings_index[i].hash = hash;
+	builder->strings_index[i].string = builder->number_of_strings;
+	builder->strings_size += 2 + (size_t)name_length * 2;
+
+	return string->offset;
+}
+
+// Post-order, every directory knows the size of everything below it once its
+// children are done.
+static uint8_t layout_directory(resource_builder_t *builder, resource_node_t *node) {
+	if (node->number_of_name_entries > UINT16_MAX || node->number_of_children - node->number_of_name_entries > UINT16_MAX) {
+		ppelib_set_error("Too many resource entries in directory");
+		return 0;
+	}
+
+	node->sorted_children = arena_alloc(&builder->arena, sizeof(resource_node_t *) * MAX(node->number_of_children, 1));
+	if (!node->sorted_children) {
+		ppelib_set_error("Failed to allocate resource layout");
+		return 0;
+	}
+
+	uint32_t i = 0;
+	for (resource_node_t *child = node->first_child; child; child = child->next_sibling) {
+		node->sorted_children[i++] = child;
+	}
+	qsort(node->sorted_children, node->number_of_children, sizeof(resource_node_t *), node_compare);
+
+	node->directories_size = RESOURCE_DIRECTORY_SIZE + (size_t)node->number_of_children * RESOURCE_ENTRY_SIZE;
+	node->number_of_data_entries = 0;
+	node->data_size = 0;
+
+	for (i = 0; i < node->number_of_children; ++i) {
+		resource_node_t *child = node->sorted_children[i];
+		if (child->name) {
+			child->name_offset = string_intern(builder, child->name, child->name_length);
+		}
+
+		if (child->is_directory) {
+			if (!layout_directory(builder, child)) {
+				return 0;
+			}
+
+			node->directories_size += child->directories_size;
+			node->number_of_data_entries += child->number_of_data_entries;
+			node->data_size += child->data_size;
+		} else {
+			node->number_of_data_entries++;
+			node->data_size += TO_NEAREST((size_t)child->size, 8);
+		}
+
+		if (node->directories_size > UINT32_MAX || node->data_size > UINT32_MAX) {
+			ppelib_set_error("Resource table too large");
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Directories in depth first order, then the names, the data entries and the data
+static uint8_t builder_layout(resource_builder_t *builder) {
+	if (builder->laid_out) {
+		return 1;
+	}
+
+	size_t capacity = hash_index_capacity(builder->number_of_names);
+
+	builder->strings = arena_alloc(&builder->arena, sizeof(resource_string_t) * MAX(builder->number_of_names, 1));
+	builder->strings_index = arena_calloc(&builder->arena, sizeof(resource_string_slot_t) * capacity);
+	if (!builder->strings || !builder->strings_index) {
+		ppelib_set_error("Failed to allocate resource layout");
+		return 0;
+	}
+
+	builder->strings_index_capacity = capacity;
+	builder->number_of_strings = 0;
+	builder->strings_size = 0;
+
+	resource_node_t *root = builder->root;
+	if (!layout_directory(builder, root)) {
+		return 0;
+	}
+
+	builder->data_entries_offset = TO_NEAREST(root->directories_size + builder->strings_size, 4);
+	builder->data_offset = TO_NEAREST(builder->data_entries_offset + root->number_of_data_entries * RESOURCE_DATA_ENTRY_SIZE,
+			8);
+	builder->size = builder->data_offset + root->data_size;
+	if (builder->size > UINT32_MAX) {
+		ppelib_set_error("Resource table too large");
+		return 0;
+	}
+
+	builder->laid_out = 1;
+	return 1;
+}
+
+typedef struct write_state {
+	uint8_t *buffer;
+	uint32_t rva;
+	size_t data_entry_offset;
+	size_t data_offset;
+} write_state_t;
+
+// Pre-order, subdirectories go behind their parent in the order of its entries
+static void write_directory(const resource_builder_t *builder, const resource_node_t *node, size_t offset,
+		write_state_t *state) {
+	uint8_t *buffer = state->buffer;
+
+	write_uint32_t(buffer + offset + 0, node->characteristics);
+	write_uint32_t(buffer + offset + 4, node->time_date_stamp);
+	write_uint16_t(buffer + offset + 8, node->major_version);
+	write_uint16_t(buffer + offset + 10, node->minor_version);
+	write_uint16_t(buffer + offset + 12, (uint16_t)node->number_of_name_entries);
+	write_uint16_t(buffer + offset + 14, (uint16_t)(node->number_of_children - node->number_of_name_entries));
+
+	size_t entry = offset + RESOURCE_DIRECTORY_SIZE;
+	size_t next_directory = entry + (size_t)node->number_of_children * RESOURCE_ENTRY_SIZE;
+
+	for (uint32_t i = 0; i < node->number_of_children; ++i, entry += RESOURCE_ENTRY_SIZE) {
+		const resource_node_t *child = node->sorted_children[i];
+
+		uint32_t name_offset_or_id = child->id;
+		if (child->name) {
+			name_offset_or_id = (uint32_t)(builder->root->directories_size + child->name_offset) | HIGH_BIT32;
+		}
+		write_uint32_t(buffer + entry + 0, name_offset_or_id);
+
+		if (child->is_directory) {
+			write_uint32_t(buffer + entry + 4, (uint32_t)next_directory | HIGH_BIT32);
+			write_directory(builder, child, next_directory, state);
+			next_directory += child->directories_size;
+			continue;
+		}
+
+		uint8_t *data_entry = buffer + state->data_entry_offset;
+		write_uint32_t(buffer + entry + 4, (uint32_t)state->data_entry_offset);
+		write_uint32_t(data_entry + 0, state->rva + (uint32_t)state->data_offset);
+		write_uint32_t(data_entry + 4, child->size);
+		write_uint32_t(data_entry + 8, child->codepage);
+		write_uint32_t(data_entry + 12, 0);
+		state->data_entry_offset += RESOURCE_DATA_ENTRY_SIZE;
+
+		if (child->size) {
+			memcpy(buffer + state->data_offset, child->data, child->size);
+		}
+
+		size_t padded = TO_NEAREST((size_t)child->size, 8);
+		memset(buffer + state->data_offset + child->size, 0, padded - child->size);
+		state->data_offset += padded;
+	}
+}
+
+static void builder_write(const resource_builder_t *builder, uint8_t *buffer, uint32_t rva) {
+	const resource_node_t *root = builder->root;
+
+	write_state_t state = { buffer, rva, builder->data_entries_offset, builder->data_offset };
+	write_directory(builder, root, 0, &state);
+
+	size_t strings_offset = root->directories_size;
+	for (uint32_t i = 0; i < builder->number_of_strings; ++i) {
+		const resource_string_t *string = &builder->strings[i];
+		write_uint16_t(buffer + strings_offset + string->offset, string->name_length);
+		memcpy(buffer + strings_offset + string->offset + 2, string->name, (size_t)string->name_length * 2);
+	}
+
+	size_t strings_end = strings_offset + builder->strings_size;
+	memset(buffer + strings_end, 0, builder->data_entries_offset - strings_end);
+
+	size_t data_entries_end = builder->data_entries_offset + root->number_of_data_entries * RESOURCE_DATA_ENTRY_SIZE;
+	memset(buffer + data_entries_end, 0, builder->data_offset - data_entries_end);
+}
+
+EXPORT_SYM size_t ppelib_resource_builder_get_size(resource_builder_t *builder) {
+	ppelib_reset_error();
+
+	if (!builder_layout(builder)) {
+		return 0;
+	}
+
+	return builder->size;
+}
+
+EXPORT_SYM size_t ppelib_resource_builder_write(resource_builder_t *builder, uint8_t *buffer, size_t size,
+		uint32_t rva) {
+	ppelib_reset_error();
+
+	if (!builder_layout(builder)) {
+		return 0;
+	}
+
+	if (builder->size > size) {
+		ppelib_set_error("Target buffer too small.");
+		return 0;
+	}
+
+	builder_write(builder, buffer, rva);
+	return builder->size;
+}
+
+static uint8_t pointer_within(const void *pointer, const uint8_t *buffer, size_t size) {
+	return pointer && (uintptr_t)pointer >= (uintptr_t)buffer && (uintptr_t)pointer < (uintptr_t)buffer + size;
+}
+
+// Whether any name or data of the builder points into contents, usually because it
+// was added from the table being replaced
+static uint8_t builder_references(const resource_builder_t *builder, const uint8_t *contents, size_t size) {
+	if (!contents) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < builder->index_capacity; ++i) {
+		const resource_node_t *node = builder->index[i].node;
+		if (node && (pointer_within(node->name, contents, size) || pointer_within(node->data, contents, size))) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static uint8_t set_resource_table(ppelib_file_t *pe, resource_builder_t *builder) {
+	if (!builder_layout(builder)) {
+		return 0;
+	}
+
+	if (pe->header.number_of_rva_and_sizes <= DIR_RESOURCE_TABLE) {
+		ppelib_set_error("No resource table data directory");
+		return 0;
+	}
+
+	// Settle the section addresses first. Resizing the table's section only moves the
+	// ones behind it, so the address the table is written for stays put.
+	ppelib_recalculate(pe);
+
+	data_directory_t *data_directory = &pe->data_directories[DIR_RESOURCE_TABLE];
+	section_t *section = data_directory->section;
+	size_t offset = 0;
+	size_t old_size = 0;
+	size_t size = builder->size;
+
+	if (section) {
+		offset = MIN(data_directory->offset, section->contents_size);
+		old_size = MIN(data_directory->size, section->contents_size - offset);
+	} else {
+		char name[9] = ".rsrc";
+		ppelib_section_create(pe, name, (uint32_t)size, (uint32_t)size,
+				IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ, NULL);
+		if (ppelib_error_peek()) {
+			return 0;
+		}
+
+		// Places the new section, the data entries need its address
+		ppelib_recalculate(pe);
+		section = &pe->sections[pe->header.number_of_sections - 1];
+		old_size = size;
+	}
+
+	// A builder pointing into the section is written aside first, resizing the section
+	// moves or overwrites what it points to. Otherwise it is written in place.
+	uint32_t rva = section->virtual_address + (uint32_t)offset;
+	const allocator_t *allocator = context_allocator(pe->context);
+	uint8_t *buffer = NULL;
+	if (builder_references(builder, section->contents, section->contents_size)) {
+		buffer = allocator->malloc(allocator->userdata, MAX(size, 1));
+		if (!buffer) {
+			ppelib_set_error("Failed to allocate resource table");
+			return 0;
+		}
+
+		builder_write(builder, buffer, rva);
+	}
+
+	uint16_t section_index = ppelib_section_find_index(pe, section);
+	if (!ppelib_error_peek()) {
+		if (old_size > size) {
+			ppelib_section_excise(pe, section_index, offset + size, offset + old_size);
+		} else if (old_size < size) {
+			ppelib_section_insert_capacity(pe, section_index, size - old_size, offset + old_size);
+		} else if (!section_make_owned(section)) {
+			ppelib_set_error("Failed to allocate new section contents");
+		}
+	}
+
+	if (ppelib_error_peek()) {
+		if (buffer) {
+			allocator->free(allocator->userdata, buffer);
+		}
+		return 0;
+	}
+
+	if (buffer) {
+		memcpy(section->contents + offset, buffer, size);
+		allocator->free(allocator->userdata, buffer);
+	} else {
+		builder_write(builder, section->contents + offset, rva);
+	}
+
+	section->virtual_size = MAX(section->virtual_size, (uint32_t)section->contents_size);
+	section->modified = 1;
+	section->contents_modified = 1;
+
+	data_directory->section = section;
+	data_directory->offset = offset;
+	data_directory->size = size;
+
+	// Offsets into the old table are gone, it is parsed again when next asked for
+	pe->resource_table_loaded = 0;
+
+	ppelib_recalculate(pe);
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_set_resource_table(ppelib_file_t *pe, resource_builder_t *builder) {
+	ppelib_reset_error();
+
+	uint8_t retval = set_resource_table(pe, builder);
+	context_take_error(pe->context);
+
+	return retval;
+}
@@ -0,0 +1,533 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+#include "unicode.h"
+
+#include "generated/section_private.h"
+
+#include "resource_table.h"
+
+// Type, name and language directories, the language entries hold the data
+#define RESOURCE_MAX_DEPTH 2
+
+// Start of the table in its section's contents, NULL if it isn't in one
+static const uint8_t *resource_table_contents(const resource_table_t *table, size_t *available) {
+	section_t *section = section_find_by_virtual_address(table->pe, table->rva);
+	if (!section || !section_get_contents(section)) {
+		return NULL;
+	}
+
+	size_t offset = table->rva - section->virtual_address;
+	if (offset > section->contents_size) {
+		return NULL;
+	}
+
+	*available = section->contents_size - offset;
+	return section->contents + offset;
+}
+
+static uint32_t directory_hash(uint32_t offset) {
+	uint32_t hash = FNV_OFFSET_BASIS;
+	for (uint32_t i = 0; i < 4; ++i) {
+		hash = fnv1a_byte(hash, (uint8_t)(offset >> (i * 8)));
+	}
+
+	return hash;
+}
+
+static resource_directory_t *directory_index_find(const resource_table_t *table, uint32_t offset) {
+	if (!table->directories_capacity) {
+		return NULL;
+	}
+
+	size_t capacity = table->directories_capacity;
+	for (size_t i = hash_index_first(directory_hash(offset), capacity); table->directories[i];
+			i = hash_index_next(i, capacity)) {
+		if (table->directories[i]->offset == offset) {
+			return table->directories[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void directory_index_insert(resource_directory_t **index, size_t capacity, resource_directory_t *directory) {
+	size_t i = hash_index_first(directory_hash(directory->offset), capacity);
+	while (index[i]) {
+		i = hash_index_next(i, capacity);
+	}
+
+	index[i] = directory;
+}
+
+// Keeps the index at most half full. The old table stays in the arena, which costs
+// no more than the final one.
+static uint8_t directory_index_add(resource_table_t *table, resource_directory_t *directory) {
+	if ((table->number_of_directories + 1) * 2 > table->directories_capacity) {
+		size_t capacity = MAX(table->directories_capacity * 2, 16);
+		resource_directory_t **index = arena_calloc(&table->pe->arena, sizeof(resource_directory_t *) * capacity);
+		if (!index) {
+			ppelib_set_error("Failed to allocate resource directory index");
+			return 0;
+		}
+
+		for (size_t i = 0; i < table->directories_capacity; ++i) {
+			if (table->directories[i]) {
+				directory_index_insert(index, capacity, table->directories[i]);
+			}
+		}
+
+		table->directories = index;
+		table->directories_capacity = capacity;
+	}
+
+	directory_index_insert(table->directories, table->directories_capacity, directory);
+	table->number_of_directories++;
+	return 1;
+}
+
+// Every directory is decoded once, entries reaching it again get the same one. It
+// has to be reached on the same level every time. Directories on the path to an
+// entry are on lower levels, so entries pointing back up are rejected too.
+static resource_directory_t *resource_directory_decode(resource_table_t *table, uint32_t offset, uint8_t depth) {
+	resource_directory_t *directory = directory_index_find(table, offset);
+	if (directory) {
+		if (directory->depth != depth) {
+			ppelib_set_error("Resource directory loops back or is reached on more than one level");
+			return NULL;
+		}
+
+		return directory;
+	}
+
+	if (depth > RESOURCE_MAX_DEPTH) {
+		ppelib_set_error("Resource directory nested too deep");
+		return NULL;
+	}
+
+	size_t available;
+	const uint8_t *contents = resource_table_contents(table, &available);
+	if (!contents) {
+		if (!ppelib_error_peek()) {
+			ppelib_set_error("Resource table outside of section");
+		}
+		return NULL;
+	}
+
+	if (offset > available || available - offset < RESOURCE_DIRECTORY_SIZE) {
+		ppelib_set_error("Resource directory outside of section");
+		return NULL;
+	}
+
+	const uint8_t *buffer = contents + offset;
+	uint16_t number_of_name_entries = read_uint16_t(buffer + 12);
+	uint16_t number_of_id_entries = read_uint16_t(buffer + 14);
+	size_t entries_size = ((size_t)number_of_name_entries + number_of_id_entries) * RESOURCE_ENTRY_SIZE;
+	if (available - offset - RESOURCE_DIRECTORY_SIZE < entries_size) {
+		ppelib_set_error("Resource directory entries outside of section");
+		return NULL;
+	}
+
+	directory = arena_calloc(&table->pe->arena, sizeof(resource_directory_t));
+	if (!directory) {
+		ppelib_set_error("Failed to allocate resource directory");
+		return NULL;
+	}
+
+	directory->characteristics = read_uint32_t(buffer + 0);
+	directory->time_date_stamp = read_uint32_t(buffer + 4);
+	directory->major_version = read_uint16_t(buffer + 8);
+	directory->minor_version = read_uint16_t(buffer + 10);
+	directory->number_of_name_entries = number_of_name_entries;
+	directory->number_of_id_entries = number_of_id_entries;
+	directory->offset = offset;
+	directory->depth = depth;
+	directory->table = table;
+
+	if (!directory_index_add(table, directory)) {
+		return NULL;
+	}
+
+	return directory;
+}
+
+// Lazily parsed files don't touch the resource table until it is first asked for.
+// Even then only the root directory is decoded.
+void resource_table_load(ppelib_file_t *pe) {
+	if (pe->resource_table_loaded) {
+		return;
+	}
+
+	resource_table_t *table = &pe->resource_table;
+	memset(table, 0, sizeof(resource_table_t));
+	table->pe = pe;
+
+	if (pe->header.number_of_rva_and_sizes <= DIR_RESOURCE_TABLE) {
+		pe->resource_table_loaded = 1;
+		return;
+	}
+
+	const data_directory_t *data_directory = &pe->data_directories[DIR_RESOURCE_TABLE];
+	if (!data_directory->section || !data_directory->size) {
+		pe->resource_table_loaded = 1;
+		return;
+	}
+
+	table->rva = data_directory->section->virtual_address + (uint32_t)data_directory->offset;
+	table->root = resource_directory_decode(table, 0, 0);
+	if (!table->root) {
+		return;
+	}
+
+	pe->resource_table_loaded = 1;
+}
+
+static uint32_t resource_directory_size(const resource_directory_t *directory) {
+	return (uint32_t)directory->number_of_name_entries + directory->number_of_id_entries;
+}
+
+// Names are a 16 bit length followed by that many UTF-16LE code units
+static uint8_t resource_name_read(const uint8_t *contents, size_t available, uint32_t offset, resource_entry_t *entry) {
+	if (offset > available || available - offset < 2) {
+		ppelib_set_error("Resource name outside of section");
+		return 0;
+	}
+
+	uint16_t length = read_uint16_t(contents + offset);
+	if (available - offset - 2 < (size_t)length * 2) {
+		ppelib_set_error("Resource name outside of section");
+		return 0;
+	}
+
+	entry->name = contents + offset + 2;
+	entry->name_length = length;
+	return 1;
+}
+
+static uint8_t resource_data_read(resource_table_t *table, const uint8_t *contents, size_t available, uint32_t offset,
+		resource_data_t *data) {
+	if (offset > available || available - offset < RESOURCE_DATA_ENTRY_SIZE) {
+		ppelib_set_error("Resource data entry outside of section");
+		return 0;
+	}
+
+	data->rva = read_uint32_t(contents + offset + 0);
+	data->size = read_uint32_t(contents + offset + 4);
+	data->codepage = read_uint32_t(contents + offset + 8);
+	data->data = NULL;
+
+	// Usually right behind the directories, but any section will do
+	section_t *section = section_find_by_virtual_address(table->pe, data->rva);
+	if (!section || !section_get_contents(section)) {
+		return 1;
+	}
+
+	size_t data_offset = data->rva - section->virtual_address;
+	if (data_offset <= section->contents_size && data->size <= section->contents_size - data_offset) {
+		data->data = section->contents + data_offset;
+	}
+
+	return 1;
+}
+
+uint8_t resource_entry_read(resource_directory_t *directory, uint32_t index, resource_entry_t *entry) {
+	resource_table_t *table = directory->table;
+
+	size_t available;
+	const uint8_t *contents = resource_table_contents(table, &available);
+	if (!contents) {
+		ppelib_set_error("Resource table outside of section");
+		return 0;
+	}
+
+	// Checked when the directory was decoded, unless the section shrank since
+	size_t entry_offset = directory->offset + RESOURCE_DIRECTORY_SIZE + (size_t)index * RESOURCE_ENTRY_SIZE;
+	if (entry_offset > available || available - entry_offset < RESOURCE_ENTRY_SIZE) {
+		ppelib_set_error("Resource directory entries outside of section");
+		return 0;
+	}
+
+	uint32_t name_offset_or_id = read_uint32_t(contents + entry_offset + 0);
+	uint32_t offset = read_uint32_t(contents + entry_offset + 4);
+
+	memset(entry, 0, sizeof(resource_entry_t));
+	if (CHECK_BIT(name_offset_or_id, HIGH_BIT32)) {
+		if (!resource_name_read(contents, available, name_offset_or_id & ~HIGH_BIT32, entry)) {
+			return 0;
+		}
+	} else {
+		entry->id = name_offset_or_id;
+	}
+
+	if (!CHECK_BIT(offset, HIGH_BIT32)) {
+		return resource_data_read(table, contents, available, offset, &entry->data);
+	}
+
+	if (!directory->subdirectories) {
+		directory->subdirectories = arena_calloc(&table->pe->arena,
+				sizeof(resource_directory_t *) * resource_directory_size(directory));
+		if (!directory->subdirectories) {
+			ppelib_set_error("Failed to allocate resource directory");
+			return 0;
+		}
+	}
+
+	if (!directory->subdirectories[index]) {
+		directory->subdirectories[index] = resource_directory_decode(table, offset & ~HIGH_BIT32,
+				(uint8_t)(directory->depth + 1));
+		if (!directory->subdirectories[index]) {
+			return 0;
+		}
+	}
+
+	entry->directory = directory->subdirectories[index];
+	return 1;
+}
+
+// Resource compilers store names uppercased and FindResource() uppercases the name
+// it is given, so names compare case-insensitively.
+static uint8_t resource_name_equal(const uint8_t *name, uint16_t length, const char *key) {
+	const uint8_t *k = (const uint8_t *)key;
+	size_t position = 0;
+
+	while (*k && position < length) {
+		if (ascii_upper(utf8_next(&k)) != ascii_upper(utf16_next(name, length, &position))) {
+			return 0;
+		}
+	}
+
+	return !*k && position == length;
+}
+
+static uint8_t resource_directory_find(resource_directory_t *directory, const resource_key_t *key,
+		resource_entry_t *entry) {
+	if (key->name) {
+		for (uint32_t i = 0; i < directory->number_of_name_entries; ++i) {
+			if (!resource_entry_read(directory, i, entry)) {
+				return 0;
+			}
+
+			if (resource_name_equal(entry->name, entry->name_length, key->name)) {
+				return 1;
+			}
+		}
+
+		return 0;
+	}
+
+	// The loader binary searches the ids, they have to be sorted
+	uint32_t low = directory->number_of_name_entries;
+	uint32_t high = resource_directory_size(directory);
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (!resource_entry_read(directory, middle, entry)) {
+			return 0;
+		}
+
+		if (entry->id == key->id) {
+			return 1;
+		}
+
+		if (entry->id < key->id) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return 0;
+}
+
+EXPORT_SYM resource_directory_t *ppelib_resource_table_get_root(resource_table_t *table) {
+	ppelib_reset_error();
+
+	return table->root;
+}
+
+EXPORT_SYM uint32_t ppelib_resource_directory_get_number_of_entries(const resource_directory_t *directory) {
+	ppelib_reset_error();
+
+	return resource_directory_size(directory);
+}
+
+EXPORT_SYM uint8_t ppelib_resource_directory_get_entry(resource_directory_t *directory, uint32_t index,
+		resource_entry_t *entry) {
+	ppelib_reset_error();
+
+	if (index >= resource_directory_size(directory)) {
+		ppelib_set_error("Resource entry index out of range");
+		return 0;
+	}
+
+	return resource_entry_read(directory, index, entry);
+}
+
+EXPORT_SYM uint8_t ppelib_resource_directory_find(resource_directory_t *directory, const resource_key_t *key,
+		resource_entry_t *entry) {
+	ppelib_reset_error();
+
+	resource_entry_t found;
+	if (!resource_directory_find(directory, key, &found)) {
+		return 0;
+	}
+
+	if (entry) {
+		*entry = found;
+	}
+
+	return 1;
+}
+
+EXPORT_SYM size_t ppelib_resource_entry_get_name_utf8(const resource_entry_t *entry, char *buffer, size_t size) {
+	ppelib_reset_error();
+
+	if (!entry->name) {
+		if (buffer && size) {
+			buffer[0] = 0;
+		}
+		return 0;
+	}
+
+	size_t needed = utf16_utf8_length(entry->name, entry->name_length);
+	if (buffer && needed < size) {
+		utf16_to_utf8(entry->name, entry->name_length, buffer);
+		buffer[needed] = 0;
+	}
+
+	return needed;
+}
+
+EXPORT_SYM uint8_t ppelib_resource_directory_get_names_utf8(resource_directory_t *directory, utf8_batch_t *batch) {
+	ppelib_reset_error();
+
+	utf8_batch_reset(batch);
+	for (uint32_t i = 0; i < resource_directory_size(directory); ++i) {
+		resource_entry_t entry;
+		if (!resource_entry_read(directory, i, &entry) || !utf8_batch_add(batch, entry.name, entry.name_length)) {
+			utf8_batch_reset(batch);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_resource_table_find(resource_table_t *table, const resource_key_t *type,
+		const resource_key_t *name, const resource_key_t *language, resource_data_t *data) {
+	ppelib_reset_error();
+
+	if (!table->root || !type || !name) {
+		return 0;
+	}
+
+	resource_entry_t entry;
+	if (!resource_directory_find(table->root, type, &entry) || !entry.directory) {
+		return 0;
+	}
+
+	if (!resource_directory_find(entry.directory, name, &entry) || !entry.directory) {
+		return 0;
+	}
+
+	// Any language will do without one
+	if (language) {
+		if (!resource_directory_find(entry.directory, language, &entry)) {
+			return 0;
+		}
+	} else if (!resource_directory_size(entry.directory) || !resource_entry_read(entry.directory, 0, &entry)) {
+		return 0;
+	}
+
+	if (entry.directory) {
+		return 0;
+	}
+
+	if (data) {
+		*data = entry.data;
+	}
+
+	return 1;
+}
+
+static void resource_name_fprint(FILE *stream, const resource_entry_t *entry) {
+	size_t position = 0;
+	while (position < entry->name_length) {
+		uint32_t code_point = utf16_next(entry->name, entry->name_length, &position);
+		if (code_point < 0x20 || code_point == 0x7F || (code_point >= 0xD800 && code_point < 0xE000)) {
+			code_point = '?';
+		}
+
+		char buffer[4];
+		fwrite(buffer, 1, utf8_encode(code_point, buffer), stream);
+	}
+}
+
+static void resource_directory_fprint(FILE *stream, resource_directory_t *directory) {
+	uint32_t indent = (uint32_t)directory->depth * 2u + 2u;
+
+	for (uint32_t i = 0; i < resource_directory_size(directory); ++i) {
+		resource_entry_t entry;
+		if (!resource_entry_read(directory, i, &entry)) {
+			fprintf(stream, "%*s<%s>\n", indent, "", ppelib_error());
+			return;
+		}
+
+		fprintf(stream, "%*s%s: ", indent, "", entry.directory ? "Dir" : "Data");
+		if (entry.name) {
+			fprintf(stream, "Name(");
+			resource_name_fprint(stream, &entry);
+			fprintf(stream, ")");
+		} else if (!directory->depth) {
+			fprintf(stream, "Type(0x%08X: (%s))", entry.id, map_lookup(entry.id, ppelib_resource_types_map));
+		} else {
+			fprintf(stream, "Id(0x%08X)", entry.id);
+		}
+
+		if (entry.directory) {
+			fprintf(stream, " entries(%u)\n", resource_directory_size(entry.directory));
+			resource_directory_fprint(stream, entry.directory);
+		} else {
+			fprintf(stream, " Size(%u) Codepage(0x%08X (%s))\n", entry.data.size, entry.data.codepage,
+					map_lookup(entry.data.codepage, ppelib_charsets_types_map));
+		}
+	}
+}
+
+EXPORT_SYM void ppelib_resource_table_fprint(FILE *stream, resource_table_t *table) {
+	ppelib_reset_error();
+
+	if (!table->root) {
+		return;
+	}
+
+	fprintf(stream, "Resource table: entries(%u)\n", resource_directory_size(table->root));
+	resource_directory_fprint(stream, table->root);
+}
+
+EXPORT_SYM void ppelib_resource_table_print(resource_table_t *table) {
+	ppelib_resource_table_fprint(stdout, table);
+}
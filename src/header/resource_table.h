@@ -0,0 +1,164 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_RESOURCE_TABLE_PRIVATE_H_
+#define PPELIB_RESOURCE_TABLE_PRIVATE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#define RESOURCE_DIRECTORY_SIZE 16
+#define RESOURCE_ENTRY_SIZE 8
+#define RESOURCE_DATA_ENTRY_SIZE 16
+
+typedef struct ppelib_file ppelib_file_t;
+typedef struct resource_table resource_table_t;
+
+// A directory is decoded the first time it is reached. Its entries are read from
+// the section on every use, only the subdirectories reached through them are kept.
+// The depth is the level it was first reached on, 0 for the root.
+typedef struct resource_directory {
+	uint32_t characteristics;
+	uint32_t time_date_stamp;
+	uint16_t major_version;
+	uint16_t minor_version;
+	uint16_t number_of_name_entries;
+	uint16_t number_of_id_entries;
+
+	// Offset into the resource table
+	uint32_t offset;
+	uint8_t depth;
+
+	// One per entry, allocated on the first subdirectory reached
+	struct resource_directory **subdirectories;
+
+	resource_table_t *table;
+} resource_directory_t;
+
+// The table isn't copied out of the file. Offsets are relative to its start and
+// resolved through the section holding it on every use.
+typedef struct resource_table {
+	uint32_t rva;
+
+	// NULL for files without resources
+	resource_directory_t *root;
+
+	// Every directory decoded so far by offset, entries pointing at the same
+	// directory share it
+	resource_directory_t **directories;
+	size_t number_of_directories;
+	size_t directories_capacity;
+
+	ppelib_file_t *pe;
+} resource_table_t;
+
+typedef struct resource_data {
+	const uint8_t *data;
+	uint32_t rva;
+	uint32_t size;
+	uint32_t codepage;
+} resource_data_t;
+
+typedef struct resource_entry {
+	const uint8_t *name;
+	uint16_t name_length;
+	uint32_t id;
+
+	resource_directory_t *directory;
+	resource_data_t data;
+} resource_entry_t;
+
+typedef struct resource_key {
+	const char *name;
+	uint32_t id;
+} resource_key_t;
+
+// Builder nodes are directories unless they were given data
+typedef struct resource_node {
+	// name_length UTF-16LE code units, NULL for nodes identified by id
+	const uint8_t *name;
+	uint16_t name_length;
+	uint32_t id;
+
+	struct resource_node *parent;
+	struct resource_node *next_sibling;
+	uint32_t index;
+
+	uint8_t is_directory;
+	uint32_t characteristics;
+	uint32_t time_date_stamp;
+	uint16_t major_version;
+	uint16_t minor_version;
+	struct resource_node *first_child;
+	struct resource_node *last_child;
+	uint32_t number_of_children;
+	uint32_t number_of_name_entries;
+
+	const uint8_t *data;
+	uint32_t size;
+	uint32_t codepage;
+
+	// Memoized by the layout pass. Sizes cover the node and everything below it.
+	struct resource_node **sorted_children;
+	size_t directories_size;
+	size_t number_of_data_entries;
+	size_t data_size;
+	uint32_t name_offset;
+} resource_node_t;
+
+typedef struct resource_node_slot {
+	uint32_t hash;
+	resource_node_t *node;
+} resource_node_slot_t;
+
+typedef struct resource_string {
+	const uint8_t *name;
+	uint16_t name_length;
+	uint32_t offset;
+} resource_string_t;
+
+typedef struct resource_string_slot {
+	uint32_t hash;
+	// 0 marks an empty slot, otherwise the string index + 1
+	uint32_t string;
+} resource_string_slot_t;
+
+typedef struct resource_builder {
+	arena_t arena;
+	resource_node_t *root;
+	uint32_t number_of_nodes;
+	uint32_t number_of_names;
+
+	// Every node but the root, by parent and name or id
+	resource_node_slot_t *index;
+	size_t index_capacity;
+
+	// Filled by the layout pass, which runs again after anything is added
+	uint8_t laid_out;
+	resource_string_t *strings;
+	uint32_t number_of_strings;
+	resource_string_slot_t *strings_index;
+	size_t strings_index_capacity;
+	size_t strings_size;
+	size_t data_entries_offset;
+	size_t data_offset;
+	size_t size;
+} resource_builder_t;
+
+#endif /* PPELIB_RESOURCE_TABLE_PRIVATE_H_ */
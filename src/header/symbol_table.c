@@ -0,0 +1,433 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+
+#include "generated/coff_symbol_private.h"
+#include "generated/section_private.h"
+
+#include "symbol_table.h"
+
+// Executables only carry a symbol table when the linker was told to keep it,
+// which MinGW does by default. It follows the section data, so it is normally
+// part of the overlay.
+static const uint8_t *symbol_table_data(ppelib_file_t *pe, size_t offset, size_t size) {
+	if (offset >= pe->overlay_offset && pe->overlay_size) {
+		size_t overlay_offset = offset - pe->overlay_offset;
+		if (pe->overlay_modified || overlay_offset > pe->overlay_size || size > pe->overlay_size - overlay_offset) {
+			return NULL;
+		}
+
+		uint8_t *overlay = overlay_get(pe);
+		return overlay ? overlay + overlay_offset : NULL;
+	}
+
+	section_t *section = section_find_by_physical_address(pe, offset);
+	if (!section || !section_get_contents(section)) {
+		return NULL;
+	}
+
+	size_t section_offset = offset - section->pointer_to_raw_data;
+	if (section_offset > section->contents_size || size > section->contents_size - section_offset) {
+		return NULL;
+	}
+
+	return section->contents + section_offset;
+}
+
+typedef struct symbol_counts {
+	uint32_t symbols;
+	size_t aux;
+	size_t short_names;
+} symbol_counts_t;
+
+static uint8_t symbol_aux_count(const uint8_t *record, uint32_t record_index, uint32_t number_of_records) {
+	// Files cut short keep what fits
+	uint8_t number_of_aux_symbols = read_uint8_t(record + 17);
+	return (uint8_t)MIN(number_of_aux_symbols, number_of_records - record_index - 1);
+}
+
+static void symbol_table_count(const uint8_t *records, uint32_t number_of_records, symbol_counts_t *counts) {
+	memset(counts, 0, sizeof(symbol_counts_t));
+
+	for (uint32_t i = 0; i < number_of_records; ++i) {
+		const uint8_t *record = records + (size_t)i * COFF_SYMBOL_SIZE;
+		uint8_t number_of_aux_symbols = symbol_aux_count(record, i, number_of_records);
+
+		if (read_uint32_t(record)) {
+			counts->short_names += strnlen((const char *)record, 8) + 1;
+		}
+
+		++counts->symbols;
+		counts->aux += number_of_aux_symbols;
+		i += number_of_aux_symbols;
+	}
+}
+
+static uint32_t symbol_name_offset(symbol_table_t *symbol_table, const uint8_t *record, size_t *short_names_size) {
+	if (read_uint32_t(record)) {
+		size_t size = strnlen((const char *)record, 8);
+		memcpy(symbol_table->short_names + *short_names_size, record, size);
+		symbol_table->short_names[*short_names_size + size] = 0;
+
+		uint32_t retval = (uint32_t)*short_names_size | HIGH_BIT32;
+		*short_names_size += size + 1;
+		return retval;
+	}
+
+	// Offsets with the high bit set would pass for short names, no string table
+	// we accept is that large.
+	const string_table_t *string_table = &symbol_table->pe->string_table;
+	uint32_t offset = read_uint32_t(record + 4);
+	if (offset < 4 || offset > string_table->highest_offset || offset & HIGH_BIT32) {
+		return 0;
+	}
+
+	return offset;
+}
+
+void symbol_table_load(ppelib_file_t *pe) {
+	if (pe->symbol_table_loaded) {
+		return;
+	}
+
+	symbol_table_t *symbol_table = &pe->symbol_table;
+	memset(symbol_table, 0, sizeof(symbol_table_t));
+	symbol_table->pe = pe;
+
+	uint32_t number_of_records = pe->header.number_of_symbols;
+	if (!pe->header.pointer_to_symbol_table || !number_of_records) {
+		pe->symbol_table_loaded = 1;
+		return;
+	}
+
+	size_t records_size = (size_t)number_of_records * COFF_SYMBOL_SIZE;
+	if (records_size / COFF_SYMBOL_SIZE != number_of_records) {
+		ppelib_set_error("Symbol table too large");
+		return;
+	}
+
+	const uint8_t *records = symbol_table_data(pe, pe->header.pointer_to_symbol_table, records_size);
+	if (!records) {
+		if (!ppelib_error_peek()) {
+			ppelib_set_error("Symbol table outside of file");
+		}
+		return;
+	}
+
+	// The records are walked twice, once to size the columns and once to fill them
+	symbol_counts_t counts;
+	symbol_table_count(records, number_of_records, &counts);
+
+	if (counts.short_names >= HIGH_BIT32) {
+		ppelib_set_error("Symbol table too large");
+		return;
+	}
+
+	size_t column_size = sizeof(uint32_t) * 4 + sizeof(uint16_t) * 2 + sizeof(uint8_t) * 2;
+	uint8_t *slab = arena_alloc(&pe->arena,
+			column_size * counts.symbols + counts.aux * COFF_SYMBOL_SIZE + counts.short_names);
+	if (!slab) {
+		ppelib_set_error("Failed to allocate symbol table");
+		return;
+	}
+
+	// Largest alignment first so every column stays aligned
+	symbol_table->values = (uint32_t *)slab;
+	symbol_table->record_indexes = symbol_table->values + counts.symbols;
+	symbol_table->names = symbol_table->record_indexes + counts.symbols;
+	symbol_table->section_numbers = (uint16_t *)(symbol_table->names + counts.symbols);
+	symbol_table->types = symbol_table->section_numbers + counts.symbols;
+	symbol_table->storage_classes = (uint8_t *)(symbol_table->types + counts.symbols);
+	symbol_table->number_of_aux_symbols = symbol_table->storage_classes + counts.symbols;
+	symbol_table->aux = symbol_table->number_of_aux_symbols + counts.symbols;
+	symbol_table->short_names = (char *)symbol_table->aux + counts.aux * COFF_SYMBOL_SIZE;
+
+	uint32_t symbol = 0;
+	size_t short_names_size = 0;
+	uint8_t *aux = symbol_table->aux;
+	for (uint32_t i = 0; i < number_of_records; ++i) {
+		const uint8_t *record = records + (size_t)i * COFF_SYMBOL_SIZE;
+		uint8_t number_of_aux_symbols = symbol_aux_count(record, i, number_of_records);
+
+		symbol_table->values[symbol] = read_uint32_t(record + 8);
+		symbol_table->section_numbers[symbol] = read_uint16_t(record + 12);
+		symbol_table->types[symbol] = read_uint16_t(record + 14);
+		symbol_table->storage_classes[symbol] = read_uint8_t(record + 16);
+		symbol_table->number_of_aux_symbols[symbol] = number_of_aux_symbols;
+		symbol_table->record_indexes[symbol] = i;
+		symbol_table->names[symbol] = symbol_name_offset(symbol_table, record, &short_names_size);
+
+		memcpy(aux, record + COFF_SYMBOL_SIZE, (size_t)number_of_aux_symbols * COFF_SYMBOL_SIZE);
+		aux += (size_t)number_of_aux_symbols * COFF_SYMBOL_SIZE;
+
+		++symbol;
+		i += number_of_aux_symbols;
+	}
+
+	symbol_table->size = counts.symbols;
+	pe->symbol_table_loaded = 1;
+}
+
+// Long names are looked up on every use, the string table moves when the handle
+// lets go of its source.
+static const char *symbol_name(const symbol_table_t *symbol_table, uint32_t symbol) {
+	uint32_t name = symbol_table->names[symbol];
+	if (!name) {
+		return NULL;
+	}
+
+	if (name & HIGH_BIT32) {
+		return symbol_table->short_names + (name & ~HIGH_BIT32);
+	}
+
+	return symbol_table->pe->string_table.strings + name;
+}
+
+static void symbol_get(const symbol_table_t *symbol_table, uint32_t symbol, symbol_lookup_t *lookup) {
+	if (!lookup) {
+		return;
+	}
+
+	uint32_t record_index = symbol_table->record_indexes[symbol];
+
+	lookup->name = symbol_name(symbol_table, symbol);
+	lookup->value = symbol_table->values[symbol];
+	lookup->section_number = symbol_table->section_numbers[symbol];
+	lookup->type = symbol_table->types[symbol];
+	lookup->storage_class = symbol_table->storage_classes[symbol];
+	lookup->number_of_aux_symbols = symbol_table->number_of_aux_symbols[symbol];
+	lookup->record_index = record_index;
+	lookup->aux = NULL;
+	if (lookup->number_of_aux_symbols) {
+		lookup->aux = symbol_table->aux + (size_t)(record_index - symbol) * COFF_SYMBOL_SIZE;
+	}
+}
+
+EXPORT_SYM uint32_t ppelib_symbol_table_get_size(const symbol_table_t *symbol_table) {
+	ppelib_reset_error();
+
+	return symbol_table->size;
+}
+
+EXPORT_SYM uint8_t ppelib_symbol_table_get(symbol_table_t *symbol_table, uint32_t symbol_index,
+		symbol_lookup_t *symbol) {
+	ppelib_reset_error();
+
+	if (symbol_index >= symbol_table->size) {
+		ppelib_set_error("Symbol index out of range");
+		return 0;
+	}
+
+	symbol_get(symbol_table, symbol_index, symbol);
+	return 1;
+}
+
+static uint8_t symbol_index_build(symbol_table_t *symbol_table) {
+	if (symbol_table->index) {
+		return 1;
+	}
+
+	size_t capacity = hash_index_capacity(symbol_table->size);
+
+	symbol_index_slot_t *index = arena_calloc(&symbol_table->pe->arena, sizeof(symbol_index_slot_t) * capacity);
+	if (!index) {
+		ppelib_set_error("Failed to allocate symbol index");
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < symbol_table->size; ++i) {
+		const char *name = symbol_name(symbol_table, i);
+		if (!name) {
+			continue;
+		}
+
+		// Lookups return the first symbol of a name, it is inserted first
+		uint32_t hash = fnv1a_string(FNV_OFFSET_BASIS, name);
+		size_t slot = hash_index_first(hash, capacity);
+		while (index[slot].symbol) {
+			slot = hash_index_next(slot, capacity);
+		}
+
+		index[slot].hash = hash;
+		index[slot].symbol = i + 1;
+	}
+
+	symbol_table->index = index;
+	symbol_table->index_capacity = capacity;
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_symbol_table_find(symbol_table_t *symbol_table, const char *name, symbol_lookup_t *symbol) {
+	ppelib_reset_error();
+
+	if (!name) {
+		ppelib_set_error("No symbol name given");
+		return 0;
+	}
+
+	if (!symbol_table->size || !symbol_index_build(symbol_table)) {
+		return 0;
+	}
+
+	uint32_t hash = fnv1a_string(FNV_OFFSET_BASIS, name);
+	size_t capacity = symbol_table->index_capacity;
+
+	for (size_t slot = hash_index_first(hash, capacity); symbol_table->index[slot].symbol;
+			slot = hash_index_next(slot, capacity)) {
+		const symbol_index_slot_t *index_slot = &symbol_table->index[slot];
+		if (index_slot->hash != hash || strcmp(symbol_name(symbol_table, index_slot->symbol - 1), name) != 0) {
+			continue;
+		}
+
+		symbol_get(symbol_table, index_slot->symbol - 1, symbol);
+		return 1;
+	}
+
+	return 0;
+}
+
+static uint64_t symbol_address_key(uint16_t section_number, uint32_t value) {
+	return ((uint64_t)section_number << 32) | value;
+}
+
+static int symbol_address_compare(const void *a, const void *b) {
+	const symbol_address_t *sa = a;
+	const symbol_address_t *sb = b;
+
+	if (sa->key != sb->key) {
+		return sa->key < sb->key ? -1 : 1;
+	}
+
+	return sa->symbol < sb->symbol ? -1 : sa->symbol > sb->symbol;
+}
+
+static uint8_t symbol_by_address_build(symbol_table_t *symbol_table) {
+	if (symbol_table->by_address) {
+		return 1;
+	}
+
+	symbol_address_t *by_address = arena_alloc(&symbol_table->pe->arena,
+			sizeof(symbol_address_t) * MAX(symbol_table->size, 1));
+	if (!by_address) {
+		ppelib_set_error("Failed to allocate symbol index");
+		return 0;
+	}
+
+	// Undefined, absolute and debug symbols have no address
+	size_t size = 0;
+	for (uint32_t i = 0; i < symbol_table->size; ++i) {
+		uint16_t section_number = symbol_table->section_numbers[i];
+		if (!section_number || section_number >= 0x8000) {
+			continue;
+		}
+
+		by_address[size].key = symbol_address_key(section_number, symbol_table->values[i]);
+		by_address[size].symbol = i;
+		++size;
+	}
+
+	qsort(by_address, size, sizeof(symbol_address_t), symbol_address_compare);
+
+	symbol_table->by_address = by_address;
+	symbol_table->by_address_size = size;
+	return 1;
+}
+
+// Number of symbols sorted before key
+static size_t symbol_by_address_lower_bound(const symbol_table_t *symbol_table, uint64_t key) {
+	size_t low = 0;
+	size_t high = symbol_table->by_address_size;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (symbol_table->by_address[middle].key < key) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+EXPORT_SYM uint8_t ppelib_symbol_table_find_address(symbol_table_t *symbol_table, uint16_t section_number,
+		uint32_t value, symbol_lookup_t *symbol) {
+	ppelib_reset_error();
+
+	if (!symbol_table->size || !symbol_by_address_build(symbol_table)) {
+		return 0;
+	}
+
+	// Last symbol at or below value, the first one in table order when several share it
+	uint64_t key = symbol_address_key(section_number, value);
+	size_t position = symbol_by_address_lower_bound(symbol_table, key);
+	if (position == symbol_table->by_address_size || symbol_table->by_address[position].key != key) {
+		if (!position) {
+			return 0;
+		}
+
+		key = symbol_table->by_address[position - 1].key;
+		if (key >> 32 != section_number) {
+			return 0;
+		}
+
+		position = symbol_by_address_lower_bound(symbol_table, key);
+	}
+
+	symbol_get(symbol_table, symbol_table->by_address[position].symbol, symbol);
+	return 1;
+}
+
+EXPORT_SYM uint8_t ppelib_symbol_table_find_rva(symbol_table_t *symbol_table, uint32_t rva, symbol_lookup_t *symbol) {
+	ppelib_reset_error();
+
+	ppelib_file_t *pe = symbol_table->pe;
+	const section_t *section = section_find_by_virtual_address(pe, rva);
+	if (!section) {
+		return 0;
+	}
+
+	uint16_t section_number = (uint16_t)(section - pe->sections + 1);
+	return ppelib_symbol_table_find_address(symbol_table, section_number, rva - section->virtual_address, symbol);
+}
+
+EXPORT_SYM size_t ppelib_symbol_table_find_range(symbol_table_t *symbol_table, uint16_t section_number, uint32_t low,
+		uint32_t high, uint32_t *symbol_indexes, size_t max) {
+	ppelib_reset_error();
+
+	if (!symbol_table->size || low >= high || !symbol_by_address_build(symbol_table)) {
+		return 0;
+	}
+
+	size_t first = symbol_by_address_lower_bound(symbol_table, symbol_address_key(section_number, low));
+	size_t last = symbol_by_address_lower_bound(symbol_table, symbol_address_key(section_number, high));
+
+	for (size_t i = first; i < last && i - first < max; ++i) {
+		symbol_indexes[i - first] = symbol_table->by_address[i].symbol;
+	}
+
+	return last - first;
+}
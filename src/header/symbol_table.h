@@ -0,0 +1,82 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_SYMBOL_TABLE_H_
+#define PPELIB_SYMBOL_TABLE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "generated/coff_symbol_private.h"
+
+typedef struct symbol_index_slot {
+	uint32_t hash;
+	// 0 marks an empty slot, otherwise the symbol index + 1
+	uint32_t symbol;
+} symbol_index_slot_t;
+
+typedef struct symbol_address {
+	// Section number in the high half, value in the low half
+	uint64_t key;
+	uint32_t symbol;
+} symbol_address_t;
+
+// The COFF symbol table is decoded into one array per field so lookups only
+// touch the fields they compare. Symbols are numbered without their auxiliary
+// records, those are kept in aux in table order.
+typedef struct symbol_table {
+	uint32_t size;
+
+	uint32_t *values;
+	uint16_t *section_numbers;
+	uint16_t *types;
+	uint8_t *storage_classes;
+	uint8_t *number_of_aux_symbols;
+	// Index of the symbol's record, auxiliary records count too. The auxiliary
+	// records before symbol i are record_indexes[i] - i.
+	uint32_t *record_indexes;
+	// String table offsets, or offsets into short_names with HIGH_BIT32 set for
+	// names that fit in the record. 0 if the name can't be resolved.
+	uint32_t *names;
+
+	char *short_names;
+	uint8_t *aux;
+
+	// Built on the first ppelib_symbol_table_find()
+	symbol_index_slot_t *index;
+	size_t index_capacity;
+
+	// Symbols that belong to a section, sorted by section number and value. Built
+	// on the first lookup by address.
+	symbol_address_t *by_address;
+	size_t by_address_size;
+
+	ppelib_file_t *pe;
+} symbol_table_t;
+
+typedef struct symbol_lookup {
+	const char *name;
+	uint32_t value;
+	uint16_t section_number;
+	uint16_t type;
+	uint8_t storage_class;
+	uint8_t number_of_aux_symbols;
+	uint32_t record_index;
+	const uint8_t *aux;
+} symbol_lookup_t;
+
+#endif /* PPELIB_SYMBOL_TABLE_H_ */
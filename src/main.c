@@ -25,13 +25,20 @@
 
 #include "generated/coff_symbol_private.h"
 
+#include "authenticode.h"
+#include "checksum.h"
+#include "cpu.h"
 #include "main.h"
+#include "page_hash.h"
 #include "ppelib_internal.h"
 
 EXPORT_SYM uint8_t *ppelib_get_overlay_data(const ppelib_file_t *pe) {
 	ppelib_reset_error();
 
-	return pe->overlay;
+	uint8_t *overlay = overlay_get((ppelib_file_t *)pe);
+	context_take_error(pe->context);
+
+	return overlay;
 }
 
 EXPORT_SYM size_t ppelib_get_overlay_size(const ppelib_file_t *pe) {
@@ -62,87 +69,320 @@ EXPORT_SYM void ppelib_set_overlay_data(ppelib_file_t *pe, const uint8_t *buffer
 		}
 
 		memcpy(pe->overlay, buffer, size);
-		pe->overlay_size = 0;
+		pe->overlay_size = size;
 	}
 
-	free(oldptr);
+	buffer_free(pe, oldptr);
+	pe->overlay_modified = 1;
+	certificate_table_reset(pe);
 }
 
-EXPORT_SYM ppelib_file_t *ppelib_create() {
-	ppelib_reset_error();
+uint8_t *overlay_get(ppelib_file_t *pe) {
+	if (pe->overlay || !pe->overlay_size) {
+		return pe->overlay;
+	}
+
+	uint8_t *overlay = arena_alloc(&pe->arena, pe->overlay_size);
+	if (!overlay) {
+		ppelib_set_error("Failed to allocate overlay data");
+		return NULL;
+	}
+
+	if (!reader_read(&pe->reader, pe->overlay_offset, overlay, pe->overlay_size)) {
+		return NULL;
+	}
+
+	pe->overlay = overlay;
+	return pe->overlay;
+}
+
+static uint8_t buffer_is_source(const ppelib_file_t *pe, const void *buffer) {
+	if (!buffer || !pe->borrowed) {
+		return 0;
+	}
+
+	uintptr_t start = (uintptr_t)pe->borrowed;
+	uintptr_t end = start + pe->borrowed_size;
+
+	return (uintptr_t)buffer >= start && (uintptr_t)buffer < end;
+}
+
+// Buffers pointing into the source or the arena don't belong to anyone in
+// particular. They can't be resized or freed on their own.
+uint8_t buffer_is_borrowed(const ppelib_file_t *pe, const void *buffer) {
+	return buffer_is_source(pe, buffer) || arena_contains(&pe->arena, buffer);
+}
+
+// Give the caller a private copy of a buffer that may point into borrowed memory.
+// Returns 0 if allocating the copy failed, in which case *buffer is untouched.
+uint8_t buffer_make_owned(const ppelib_file_t *pe, uint8_t **buffer, size_t size) {
+	if (!buffer_is_borrowed(pe, *buffer)) {
+		return 1;
+	}
+
+	if (!size) {
+		*buffer = NULL;
+		return 1;
+	}
+
+	uint8_t *copy = malloc(size);
+	if (!copy) {
+		return 0;
+	}
+
+	memcpy(copy, *buffer, size);
+	*buffer = copy;
+
+	return 1;
+}
+
+void buffer_free(const ppelib_file_t *pe, void *buffer) {
+	if (buffer_is_borrowed(pe, buffer)) {
+		return;
+	}
+
+	free(buffer);
+}
+
+// Move a buffer pointing into the source into the arena
+static uint8_t buffer_detach(ppelib_file_t *pe, uint8_t **buffer, size_t size) {
+	if (!buffer_is_source(pe, *buffer)) {
+		return 1;
+	}
+
+	uint8_t *copy = arena_alloc(&pe->arena, size);
+	if (!copy) {
+		return 0;
+	}
+
+	memcpy(copy, *buffer, size);
+	*buffer = copy;
+
+	return 1;
+}
+
+// Copy what follows the section data out of the source, or read it if it wasn't
+// yet. That part of the file is rewritten when the section data grows.
+static uint8_t detach_trailing_data(ppelib_file_t *pe) {
+	if (!overlay_get(pe) && pe->overlay_size) {
+		return 0;
+	}
+
+	const uint8_t *overlay = pe->overlay;
+	if (!buffer_detach(pe, &pe->overlay, pe->overlay_size)) {
+		ppelib_set_error("Failed to allocate overlay data");
+		return 0;
+	}
+	if (pe->overlay != overlay) {
+		certificate_table_reset(pe);
+	}
+
+	if (!buffer_detach(pe, (uint8_t **)&pe->string_table.strings, pe->string_table.size)) {
+		ppelib_set_error("Couldn't allocate string table");
+		return 0;
+	}
+
+	return 1;
+}
+
+// Copy everything still pointing into borrowed memory, or not read from the
+// source yet, so the source can be released.
+static void release_source(ppelib_file_t *pe) {
+	if (!pe->borrowed && !pe->reader.read) {
+		return;
+	}
+
+	const allocator_t *allocator = context_allocator(pe->context);
+
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (!section_get_contents(section) && section->contents_size) {
+			return;
+		}
+
+		if (!buffer_detach(pe, &section->contents, section->contents_size)) {
+			ppelib_set_error("Failed to allocate section data");
+			return;
+		}
+	}
+
+	if (!detach_trailing_data(pe)) {
+		return;
+	}
+
+	if (!buffer_detach(pe, &pe->dos_header.stub, pe->dos_header.stub_size)) {
+		ppelib_set_error("Couldn't allocate DOS stub");
+		return;
+	}
+
+	mapped_file_close(&pe->mapped_file);
+	allocator->free(allocator->userdata, pe->zeropage);
+
+	pe->zeropage = NULL;
+	pe->borrowed = NULL;
+	pe->borrowed_size = 0;
+	memset(&pe->reader, 0, sizeof(reader_t));
+}
+
+static ppelib_file_t *pe_create(ppelib_context_t *context) {
+	const allocator_t *allocator = context_allocator(context);
 
-	ppelib_file_t *pe = calloc(sizeof(ppelib_file_t), 1);
+	ppelib_file_t *pe = allocator->malloc(allocator->userdata, sizeof(ppelib_file_t));
 	if (!pe) {
 		ppelib_set_error("Failed to allocate PE structure");
+		return NULL;
 	}
 
+	memset(pe, 0, sizeof(ppelib_file_t));
+	pe->context = context;
+	pe->arena.allocator = context_allocator(context);
+
 	return pe;
 }
 
+EXPORT_SYM ppelib_file_t *ppelib_create() {
+	ppelib_reset_error();
+
+	return pe_create(NULL);
+}
+
 EXPORT_SYM void ppelib_destroy(ppelib_file_t *pe) {
 	if (!pe) {
 		return;
 	}
 
+	// Everything from parsing lives in the arena, only what was changed since
+	// has its own allocation.
 	if (pe->sections) {
 		for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-			free(pe->sections[i]->contents);
-			free(pe->sections[i]);
+			buffer_free(pe, pe->sections[i].contents);
 		}
 	}
 
-	free(pe->dos_header.stub);
-	free(pe->dos_header.message);
-	free(pe->dos_header.vlv_signature.signature);
-	free(pe->dos_header.rich_table.entries);
-	free(pe->data_directories);
-	free(pe->sections);
-	free(pe->overlay);
+	buffer_free(pe, pe->dos_header.stub);
+	buffer_free(pe, pe->dos_header.message);
+	buffer_free(pe, pe->sections);
+	buffer_free(pe, pe->overlay);
+	section_index_invalidate(pe);
+
+	const allocator_t *allocator = context_allocator(pe->context);
 
-	string_table_free(&pe->string_table);
-	import_table_free(&pe->import_table);
+	mapped_file_close(&pe->mapped_file);
+	allocator->free(allocator->userdata, pe->zeropage);
 
-	free(pe);
+	arena_free(&pe->arena);
+	allocator->free(allocator->userdata, pe);
 	pe = NULL;
 }
 
-EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer(const uint8_t *buffer, size_t size) {
-	ppelib_reset_error();
+// Sources that can't be borrowed from are parsed from a copy of their headers.
+// The copy grows as we find out how large the headers actually are.
+static uint8_t window_extend(const allocator_t *allocator, const reader_t *reader, uint8_t **window,
+		size_t *window_size, size_t size) {
+	if (size <= *window_size) {
+		return 1;
+	}
+
+	uint8_t *new_window = allocator->realloc(allocator->userdata, *window, size);
+	if (!new_window) {
+		ppelib_set_error("Failed to allocate header data");
+		return 0;
+	}
 
-	uint8_t *zeropage = NULL;
-	const uint8_t *oldptr = NULL;
-	size_t orig_size = size;
+	*window = new_window;
+	if (!reader_read(reader, *window_size, new_window + *window_size, size - *window_size)) {
+		return 0;
+	}
+
+	*window_size = size;
+	return 1;
+}
+
+// The string table lives past the section data, so it usually isn't in the header copy.
+// It is read straight into the arena and parsed in place.
+static void read_string_table(const reader_t *reader, size_t size, size_t offset, string_table_t *string_table,
+		arena_t *arena) {
+	if (offset + 4 > size) {
+		ppelib_set_error("Failed to read string table\n");
+		return;
+	}
+
+	uint8_t size_buffer[4];
+	if (!reader_read(reader, offset, size_buffer, 4)) {
+		return;
+	}
+
+	size_t string_table_size = MIN(read_uint32_t(size_buffer), size - offset);
+	uint8_t *buffer = arena_alloc(arena, string_table_size);
+	if (!buffer) {
+		ppelib_set_error("Failed to allocate string table\n");
+		return;
+	}
+
+	if (reader_read(reader, offset, buffer, string_table_size)) {
+		parse_string_table(buffer, string_table_size, 0, string_table, arena, 0);
+	}
+}
 
-	if (size < 2) {
+// With PARSE_BORROW the handle references a contiguous source instead of copying
+// section contents and the overlay out of it. The caller must keep the source
+// alive and unmodified for the lifetime of the handle. PARSE_LAZY additionally
+// leaves section contents and the import table alone until they are first used.
+//
+// Other sources only have their headers read up front. Everything else is read
+// through the source when it is needed, so it has to stay valid as well.
+//
+// PARSE_HEADERS parses a source that holds nothing but the headers. Section
+// contents, the import table and the overlay aren't available at all.
+ppelib_file_t *create_from_reader(ppelib_context_t *context, const reader_t *reader, uint32_t flags) {
+	const allocator_t *allocator = context_allocator(context);
+	uint8_t *window = NULL;
+	size_t window_size = 0;
+	size_t orig_size = reader->size;
+	size_t size = MAX(orig_size, 0x1000);
+	uint8_t headers_only = CHECK_BIT(flags, PARSE_HEADERS) != 0;
+	uint8_t borrow = reader->buffer && !headers_only && (CHECK_BIT(flags, PARSE_BORROW) || CHECK_BIT(flags, PARSE_LAZY));
+	const uint8_t *buffer = reader->buffer;
+
+	if (orig_size < 2) {
 		ppelib_set_error("Not a PE file (too small for MZ signature)");
 		return NULL;
 	}
 
-	uint16_t mz_signature = read_uint16_t(buffer);
-	if (mz_signature != MZ_SIGNATURE) {
-		ppelib_set_error("Not a PE file (MZ signature missing)");
+	ppelib_file_t *pe = pe_create(context);
+	if (!pe) {
 		return NULL;
 	}
 
-	ppelib_file_t *pe = ppelib_create();
-	if (ppelib_error_peek()) {
-		return NULL;
+	if (buffer && orig_size >= 0x1000) {
+		window_size = size;
+	} else if (!window_extend(allocator, reader, &window, &window_size, 0x1000)) {
+		// Tiny files are parsed from a padded copy
+		goto out;
 	}
 
-	if (size < 0x1000) {
-		zeropage = calloc(0x1000, 1);
-		if (!zeropage) {
-			ppelib_set_error("Failed to allocate zeropage");
-			goto out;
-		}
+	if (window) {
+		buffer = window;
+	}
+
+	uint16_t mz_signature = read_uint16_t(buffer);
+	if (mz_signature != MZ_SIGNATURE) {
+		ppelib_set_error("Not a PE file (MZ signature missing)");
+		goto out;
+	}
+
+	if (borrow) {
+		pe->borrowed = buffer;
+		pe->borrowed_size = size;
 
-		memcpy(zeropage, buffer, size);
-		oldptr = buffer;
-		size = 0x1000;
-		buffer = zeropage;
+		// The padded copy of a tiny file has to live as long as we do.
+		pe->zeropage = window;
+		window = NULL;
+	} else if (!reader->buffer && !headers_only) {
+		pe->reader = *reader;
 	}
 
-	size_t dos_header_size = ppelib_dos_header_deserialize(buffer, size, 2, &pe->dos_header);
+	size_t dos_header_size = ppelib_dos_header_deserialize(buffer, window_size, 2, &pe->dos_header);
 	if (ppelib_error_peek()) {
 		goto out;
 	}
@@ -154,15 +394,33 @@ EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer(const uint8_t *buffer, size_
 		goto out;
 	}
 
+	size_t header_offset = pe->dos_header.pe_header_offset + 4;
+
+	if (!window_extend(allocator, reader, &window, &window_size, MIN(size, header_offset + COFF_HEADER_SIZE + PEPLUS_OPTIONAL_HEADER_SIZE))) {
+		goto out;
+	}
+
+	if (window) {
+		buffer = window;
+	}
+
 	if (pe->dos_header.pe_header_offset >= dos_header_size) {
 		size_t dos_stub_size = pe->dos_header.pe_header_offset - dos_header_size;
-		pe->dos_header.stub = malloc(dos_stub_size);
-		if (!pe->dos_header.stub) {
-			ppelib_set_error("Couldn't allocate DOS stub");
-			goto out;
+
+		if (borrow) {
+			if (dos_stub_size) {
+				pe->dos_header.stub = (uint8_t *)buffer + 2 + dos_header_size;
+			}
+		} else {
+			pe->dos_header.stub = arena_alloc(&pe->arena, dos_stub_size);
+			if (!pe->dos_header.stub) {
+				ppelib_set_error("Couldn't allocate DOS stub");
+				goto out;
+			}
+
+			memcpy(pe->dos_header.stub, buffer + 2 + dos_header_size, dos_stub_size);
 		}
 
-		memcpy(pe->dos_header.stub, buffer + 2 + dos_header_size, dos_stub_size);
 		pe->dos_header.stub_size = dos_stub_size;
 		parse_dos_stub(&pe->dos_header);
 	}
@@ -173,20 +431,22 @@ EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer(const uint8_t *buffer, size_
 		goto out;
 	}
 
-	size_t header_offset = pe->dos_header.pe_header_offset + 4;
-
-	size_t header_size = ppelib_header_deserialize(buffer, size, header_offset, &pe->header);
+	size_t header_size = ppelib_header_deserialize(buffer, window_size, header_offset, &pe->header);
 	if (ppelib_error_peek()) {
 		goto out;
 	}
 
 	pe->header.pe = pe;
 
-	if (pe->header.pointer_to_symbol_table) {
+	if (pe->header.pointer_to_symbol_table && !headers_only) {
 		size_t symbol_offset = pe->header.pointer_to_symbol_table;
 
 		size_t string_table_offset = symbol_offset + pe->header.number_of_symbols * 18;
-		parse_string_table(buffer, size, string_table_offset, &pe->string_table);
+		if (reader->buffer) {
+			parse_string_table(buffer, size, string_table_offset, &pe->string_table, &pe->arena, !borrow);
+		} else {
+			read_string_table(reader, size, string_table_offset, &pe->string_table, &pe->arena);
+		}
 		ppelib_reset_error();
 	}
 
@@ -215,345 +475,1279 @@ EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer(const uint8_t *buffer, size_
 		goto out;
 	}
 
-	pe->sections = calloc(sizeof(void *) * pe->header.number_of_sections, 1);
+	size_t end_of_headers = MAX(header_offset + header_size + data_directories_size, pe->start_of_section_data);
+	if (!window_extend(allocator, reader, &window, &window_size, MIN(size, end_of_headers))) {
+		goto out;
+	}
+
+	if (window) {
+		buffer = window;
+	}
+
+	pe->sections = arena_calloc(&pe->arena, sizeof(section_t) * pe->header.number_of_sections);
 	if (!pe->sections) {
-		ppelib_set_error("Failed to allocate sections array");
+		ppelib_set_error("Failed to allocate sections");
 		goto out;
 	}
+	pe->sections_capacity = pe->header.number_of_sections;
+
+	size_t offset = section_offset;
+	size_t total_contents_size = 0;
+	pe->start_of_section_va = 0;
+	pe->end_of_section_data = pe->start_of_section_data;
+	char first_section = 1;
 
 	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		pe->sections[i] = calloc(sizeof(section_t), 1);
-		if (!pe->sections[i]) {
-			for (uint16_t s = 0; s < i; ++s) {
-				free(pe->sections[s]);
+		size_t section_size = ppelib_section_deserialize(buffer, window_size, offset, &pe->sections[i]);
+		if (ppelib_error_peek()) {
+			goto out;
+		}
+
+		section_t *section = &pe->sections[i];
+		section->pe = pe;
+
+		if (i == 0) {
+			pe->start_of_section_va = section->virtual_address;
+		} else {
+			pe->start_of_section_va = MIN(pe->start_of_section_va, section->virtual_address);
+		}
+
+		if (section->size_of_raw_data > section->size_of_raw_data + section->virtual_size) {
+			ppelib_set_error("Section data size out of range");
+			goto out;
+		}
+
+		size_t data_size = MIN(section->virtual_size, section->size_of_raw_data);
+
+		if (!headers_only &&
+				(section->pointer_to_raw_data + data_size > size || section->pointer_to_raw_data > size || data_size > size)) {
+			ppelib_set_error("Section data outside of file");
+			goto out;
+		}
+
+		section->source_offset = section->pointer_to_raw_data;
+		if (section->pointer_to_raw_data < orig_size) {
+			section->source_size = MIN(section->size_of_raw_data, orig_size - section->pointer_to_raw_data);
+		}
+
+		if (borrow && !CHECK_BIT(flags, PARSE_LAZY) && data_size) {
+			section->contents = (uint8_t *)buffer + section->pointer_to_raw_data;
+		}
+
+		section->contents_size = data_size;
+		if (total_contents_size + data_size < total_contents_size) {
+			ppelib_set_error("Section data size out of range");
+			goto out;
+		}
+		total_contents_size += data_size;
+
+		if (section->pointer_to_raw_data) {
+			if (first_section) {
+				first_section = 0;
+				pe->start_of_section_data = section->pointer_to_raw_data;
+			} else {
+				pe->start_of_section_data = MIN(pe->start_of_section_data, section->pointer_to_raw_data);
+			}
+		}
+
+		pe->end_of_section_data = MAX(pe->end_of_section_data,
+				section->pointer_to_raw_data + section->size_of_raw_data);
+
+		offset += section_size;
+	}
+
+	if (!borrow && !CHECK_BIT(flags, PARSE_LAZY) && !headers_only) {
+		// All section contents are copied into a single allocation
+		uint8_t *contents = arena_alloc(&pe->arena, total_contents_size);
+		if (!contents) {
+			ppelib_set_error("Failed to allocate section data");
+			goto out;
+		}
+
+		for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+			section_t *section = &pe->sections[i];
+			if (!section->contents_size) {
+				continue;
+			}
+
+			if (!reader_read(reader, section->pointer_to_raw_data, contents, section->contents_size)) {
+				goto out;
 			}
-			memset(pe->sections, 0, sizeof(void *) * pe->header.number_of_sections);
-			ppelib_set_error("Failed to allocate sections");
+
+			section->contents = contents;
+			contents += section->contents_size;
+		}
+	}
+
+	pe->entrypoint_section = section_find_by_virtual_address(pe, pe->header.address_of_entry_point);
+
+	if (pe->entrypoint_section) {
+		pe->entrypoint_offset = pe->header.address_of_entry_point - pe->entrypoint_section->virtual_address;
+	}
+
+	pe->data_directories = arena_calloc(&pe->arena, sizeof(data_directory_t) * pe->header.number_of_rva_and_sizes);
+	if (!pe->data_directories) {
+		ppelib_set_error("Failed to allocate data directories");
+		goto out;
+	}
+
+	// Data directories don't have a dedicated deserialize function
+	offset = header_offset + header_size;
+	for (uint32_t i = 0; i < pe->header.number_of_rva_and_sizes; ++i) {
+		uint32_t dir_va = read_uint32_t(buffer + offset + 0);
+		uint32_t dir_size = read_uint32_t(buffer + offset + 4);
+
+		section_t *section = section_find_by_virtual_address(pe, dir_va);
+		if (i != DIR_CERTIFICATE_TABLE && section) {
+			pe->data_directories[i].section = section;
+			pe->data_directories[i].offset = dir_va - section->virtual_address;
+		} else if (dir_size) {
+			// Certificate tables' addresses aren't virtual. Despite the name.
+			pe->data_directories[i].offset = dir_va - pe->end_of_section_data;
+		}
+		pe->data_directories[i].size = dir_size;
+		pe->data_directories[i].id = i;
+
+		offset += DATA_DIRECTORY_SIZE;
+	}
+
+	if (!CHECK_BIT(flags, PARSE_LAZY) && !headers_only) {
+		import_table_load(pe);
+		if (ppelib_error_peek()) {
 			goto out;
 		}
 	}
 
-	size_t offset = section_offset;
-	pe->start_of_section_va = 0;
-	pe->end_of_section_data = pe->start_of_section_data;
-	char first_section = 1;
+	pe->end_of_section_data = MAX(pe->end_of_section_data, header_offset + header_size);
+	pe->overlay_offset = pe->end_of_section_data;
+	pe->source_size = orig_size;
+
+	if (orig_size > pe->end_of_section_data && !headers_only) {
+		pe->overlay_size = orig_size - pe->end_of_section_data;
+
+		if (borrow) {
+			pe->overlay = (uint8_t *)buffer + pe->end_of_section_data;
+		} else if (reader->buffer) {
+			pe->overlay = arena_alloc(&pe->arena, pe->overlay_size);
+			if (!pe->overlay) {
+				ppelib_set_error("Failed to allocate overlay data");
+				goto out;
+			}
+
+			memcpy(pe->overlay, reader->buffer + pe->end_of_section_data, pe->overlay_size);
+		}
+		// Otherwise the overlay is read from the source when it is needed
+	}
+
+out:
+	allocator->free(allocator->userdata, window);
+	if (ppelib_error_peek()) {
+		ppelib_destroy(pe);
+		return NULL;
+	}
+	return pe;
+}
+
+static ppelib_file_t *create_from_buffer(ppelib_context_t *context, const uint8_t *buffer, size_t size, uint32_t flags) {
+	reader_t reader;
+	memset(&reader, 0, sizeof(reader_t));
+	reader.buffer = buffer;
+	reader.size = size;
+
+	return create_from_reader(context, &reader, flags);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer(const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	return create_from_buffer(NULL, buffer, size, 0);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer_borrowed(const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	return create_from_buffer(NULL, buffer, size, PARSE_BORROW);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_buffer_lazy(const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	return create_from_buffer(NULL, buffer, size, PARSE_LAZY);
+}
+
+static ppelib_file_t *create_from_file_mapped(ppelib_context_t *context, const char *filename, uint32_t flags) {
+	mapped_file_t mapped_file;
+	mapped_file_open(filename, &mapped_file);
+	if (ppelib_error_peek()) {
+		return NULL;
+	}
+
+	ppelib_file_t *pe = create_from_buffer(context, mapped_file.buffer, mapped_file.size, flags);
+	if (!pe || !(flags & (PARSE_BORROW | PARSE_LAZY))) {
+		// A copy doesn't need the mapping any more
+		mapped_file_close(&mapped_file);
+		return pe;
+	}
+
+	pe->mapped_file = mapped_file;
+	return pe;
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_file_mapped(const char *filename) {
+	ppelib_reset_error();
+
+	return create_from_file_mapped(NULL, filename, PARSE_BORROW);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_file_lazy(const char *filename) {
+	ppelib_reset_error();
+
+	return create_from_file_mapped(NULL, filename, PARSE_LAZY);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_reader(ppelib_read_func read, void *userdata, size_t size) {
+	ppelib_reset_error();
+
+	if (!read) {
+		ppelib_set_error("Can't read from a NULL function");
+		return NULL;
+	}
+
+	reader_t reader;
+	memset(&reader, 0, sizeof(reader_t));
+	reader.read = read;
+	reader.userdata = userdata;
+	reader.size = size;
+
+	return create_from_reader(NULL, &reader, PARSE_LAZY);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_fd(int fd) {
+	ppelib_reset_error();
+
+	reader_t reader;
+	reader_open_fd(fd, &reader);
+	if (ppelib_error_peek()) {
+		return NULL;
+	}
+
+	return create_from_reader(NULL, &reader, PARSE_LAZY);
+}
+
+static uint32_t context_parse_flags(const ppelib_context_t *context) {
+	return context->parse_options & (PARSE_BORROW | PARSE_LAZY);
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_context_create_from_buffer(ppelib_context_t *context, const uint8_t *buffer,
+		size_t size) {
+	ppelib_reset_error();
+
+	ppelib_file_t *pe = create_from_buffer(context, buffer, size, context_parse_flags(context));
+	context_take_error(context);
+
+	return pe;
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_context_create_from_file(ppelib_context_t *context, const char *filename) {
+	ppelib_reset_error();
+
+	ppelib_file_t *pe = create_from_file_mapped(context, filename, context_parse_flags(context));
+	context_take_error(context);
+
+	return pe;
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_context_create_from_reader(ppelib_context_t *context, ppelib_read_func read,
+		void *userdata, size_t size) {
+	ppelib_reset_error();
+
+	ppelib_file_t *pe = NULL;
+	if (!read) {
+		ppelib_set_error("Can't read from a NULL function");
+	} else {
+		reader_t reader;
+		memset(&reader, 0, sizeof(reader_t));
+		reader.read = read;
+		reader.userdata = userdata;
+		reader.size = size;
+
+		pe = create_from_reader(context, &reader, PARSE_LAZY);
+	}
+
+	context_take_error(context);
+	return pe;
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_create_from_file(const char *filename) {
+	ppelib_reset_error();
+	size_t file_size;
+	uint8_t *file_contents;
+
+	FILE *f = fopen(filename, "rb");
+
+	if (!f) {
+		ppelib_set_error("Failed to open file");
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	long ftell_size = ftell(f);
+	rewind(f);
+
+	if (ftell_size < 0) {
+		fclose(f);
+		ppelib_set_error("Unable to read file length");
+		return NULL;
+	}
+
+	file_size = (size_t)ftell_size;
+
+	if (!file_size) {
+		fclose(f);
+		ppelib_set_error("Empty file");
+		return NULL;
+	}
+
+	file_contents = malloc(file_size);
+	if (!file_size) {
+		fclose(f);
+		ppelib_set_error("Failed to allocate file data");
+		return NULL;
+	}
+
+	size_t retsize = fread(file_contents, 1, file_size, f);
+	if (retsize != file_size) {
+		fclose(f);
+		ppelib_set_error("Failed to read file data");
+		return NULL;
+	}
+
+	fclose(f);
+
+	ppelib_file_t *retval = ppelib_create_from_buffer(file_contents, file_size);
+	free(file_contents);
+
+	return retval;
+}
+
+typedef struct write_layout {
+	size_t header_size;
+	size_t pe_header_offset;
+	size_t section_header_offset;
+	size_t end_of_headers;
+	size_t end_of_section_data;
+	size_t size;
+} write_layout_t;
+
+static void write_layout(const ppelib_file_t *pe, write_layout_t *layout) {
+	size_t size = 0;
+
+	size_t header_size = ppelib_header_serialize(&pe->header, NULL, 0);
+	size_t data_tables_size = pe->header.number_of_rva_and_sizes * DATA_DIRECTORY_SIZE;
+	size_t section_header_size = pe->header.number_of_sections * SECTION_SIZE;
+
+	size_t section_size = 0;
+
+	size_t pe_header_offset = pe->dos_header.pe_header_offset + 4;
+	size_t section_header_offset = pe_header_offset + COFF_HEADER_SIZE + pe->header.size_of_optional_header;
+
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+
+		size_t this_section_size = section->pointer_to_raw_data;
+		this_section_size += MAX(section->size_of_raw_data, section->contents_size);
+		section_size = MAX(section_size, this_section_size);
+	}
+
+	size_t end_of_headers = 2 + DOS_HEADER_SIZE + pe->dos_header.stub_size;
+	end_of_headers = MAX(end_of_headers, pe_header_offset + header_size + data_tables_size);
+	end_of_headers = MAX(end_of_headers, section_header_offset + section_header_size);
+
+	size += 2;
+	size += pe->dos_header.pe_header_offset;
+	size += 4;
+	size += pe->header.size_of_optional_header;
+	size += section_header_size;
+
+	// Some of this stuff may overlap so we need to ensure we have at least as much space
+	// as the furthest out write
+	size = MAX(size, section_size);
+	size = MAX(size, end_of_headers);
+
+	layout->header_size = header_size;
+	layout->pe_header_offset = pe_header_offset;
+	layout->section_header_offset = section_header_offset;
+	layout->end_of_headers = end_of_headers;
+	layout->end_of_section_data = size;
+	layout->size = size + pe->overlay_size;
+}
+
+// Directories outside of the sections, the certificate table, are stored relative
+// to the end of the section data
+static uint32_t data_directory_address(const data_directory_t *dir, const write_layout_t *layout) {
+	if (dir->section) {
+		return (uint32_t)(dir->section->virtual_address + dir->offset);
+	}
+
+	if (dir->size) {
+		return (uint32_t)(layout->end_of_section_data + dir->offset);
+	}
+
+	return 0;
+}
+
+static size_t write_checksum_offset(const write_layout_t *layout) {
+	return layout->pe_header_offset + COFF_HEADER_SIZE + OPTIONAL_HEADER_CHECKSUM;
+}
+
+static void write_authenticode_ranges(const ppelib_file_t *pe, const write_layout_t *layout,
+		authenticode_ranges_t *ranges) {
+	memset(ranges, 0, sizeof(authenticode_ranges_t));
+	ranges->checksum_offset = write_checksum_offset(layout);
+
+	if (pe->header.number_of_rva_and_sizes > DIR_CERTIFICATE_TABLE) {
+		const data_directory_t *dir = &pe->data_directories[DIR_CERTIFICATE_TABLE];
+		ranges->directory_offset = layout->pe_header_offset + layout->header_size
+				+ DIR_CERTIFICATE_TABLE * DATA_DIRECTORY_SIZE;
+		ranges->table_offset = data_directory_address(dir, layout);
+		ranges->table_size = ranges->table_offset ? dir->size : 0;
+	}
+}
+
+// Serialize the headers, and optionally the section contents, into a zeroed
+// buffer. Without contents the buffer only needs to be end_of_headers long.
+static uint8_t write_image(ppelib_file_t *pe, const write_layout_t *layout, uint8_t *buffer, uint8_t with_contents) {
+	write_uint16_t(buffer, MZ_SIGNATURE);
+	ppelib_dos_header_serialize(&pe->dos_header, buffer, 2);
+	if (pe->dos_header.stub_size) {
+		memcpy(buffer + 2 + DOS_HEADER_SIZE, pe->dos_header.stub, pe->dos_header.stub_size);
+	}
+	write_uint32_t(buffer + pe->dos_header.pe_header_offset, PE_SIGNATURE);
+	ppelib_header_serialize(&pe->header, buffer, layout->pe_header_offset);
+
+	size_t offset = layout->pe_header_offset + layout->header_size;
+	for (uint32_t i = 0; i < pe->header.number_of_rva_and_sizes; ++i) {
+		data_directory_t *dir = &pe->data_directories[i];
+
+		write_uint32_t(buffer + offset + 0, data_directory_address(dir, layout));
+		write_uint32_t(buffer + offset + 4, (uint32_t)dir->size);
+
+		offset += DATA_DIRECTORY_SIZE;
+	}
+
+	offset = layout->section_header_offset;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		ppelib_section_serialize(section, buffer, offset);
+
+		if (with_contents && section->contents_size) {
+			const uint8_t *contents = section_get_contents(section);
+			if (!contents) {
+				return 0;
+			}
+
+			memcpy(buffer + section->pointer_to_raw_data, contents, section->contents_size);
+		}
+
+		offset += SECTION_SIZE;
+	}
+
+	return 1;
+}
+
+static size_t write_to_buffer(ppelib_file_t *pe, uint8_t *buffer, size_t buf_size, write_options_t *options) {
+	write_layout_t layout;
+	write_layout(pe, &layout);
+
+	if (!buffer) {
+		return layout.size;
+	}
+
+	if (layout.size > buf_size) {
+		ppelib_set_error("Target buffer too small.");
+		return 0;
+	}
+
+	memset(buffer, 0, layout.size);
+
+	if (!write_image(pe, &layout, buffer, 1)) {
+		return 0;
+	}
+
+	if (pe->overlay) {
+		memcpy(buffer + layout.end_of_section_data, pe->overlay, pe->overlay_size);
+	} else if (pe->overlay_size) {
+		// Overlays can be huge, don't keep a copy around just to write it out
+		if (!reader_read(&pe->reader, pe->overlay_offset, buffer + layout.end_of_section_data, pe->overlay_size)) {
+			return 0;
+		}
+	}
+
+	if (options && options->digest_algorithm) {
+		authenticode_ranges_t ranges;
+		authenticode_t authenticode;
+		write_authenticode_ranges(pe, &layout, &ranges);
+		authenticode_init(&authenticode, options->digest_algorithm, &ranges);
+		authenticode_update(&authenticode, buffer, layout.size);
+		authenticode_final(&authenticode, options->digest);
+	}
+
+	if (options && options->update_checksum) {
+		checksum_t checksum;
+		checksum_init(&checksum, write_checksum_offset(&layout));
+		checksum_update(&checksum, buffer, layout.size);
+		options->checksum = checksum_final(&checksum);
+		write_uint32_t(buffer + write_checksum_offset(&layout), options->checksum);
+	}
+
+	return layout.size;
+}
+
+static uint8_t write_options_check(const write_options_t *options) {
+	digest_t digest;
+	if (options && options->digest_algorithm && !digest_init(&digest, options->digest_algorithm)) {
+		ppelib_set_error("Unknown digest algorithm");
+		return 0;
+	}
+
+	return 1;
+}
+
+EXPORT_SYM size_t ppelib_write_to_buffer(ppelib_file_t *pe, uint8_t *buffer, size_t buf_size) {
+	ppelib_reset_error();
+
+	size_t retval = write_to_buffer(pe, buffer, buf_size, NULL);
+	context_take_error(pe->context);
+
+	return retval;
+}
+
+EXPORT_SYM size_t ppelib_write_to_buffer_with_options(ppelib_file_t *pe, uint8_t *buffer, size_t buf_size,
+		write_options_t *options) {
+	ppelib_reset_error();
+
+	size_t retval = 0;
+	if (write_options_check(options)) {
+		retval = write_to_buffer(pe, buffer, buf_size, options);
+	}
+	context_take_error(pe->context);
+
+	return retval;
+}
+
+static const uint8_t zero_block[4096];
+
+// Where a file is written to. The Authenticode digest and the checksum of what is
+// written are computed along the way, without a FILE that is all that happens.
+typedef struct write_sink {
+	FILE *f;
+	authenticode_t *authenticode;
+	checksum_t *checksum;
+} write_sink_t;
+
+static uint8_t stream_data(write_sink_t *sink, const uint8_t *data, size_t size) {
+	if (size && sink->f && fwrite(data, 1, size, sink->f) != size) {
+		ppelib_set_error("Failed to write data");
+		return 0;
+	}
+
+	if (sink->authenticode) {
+		authenticode_update(sink->authenticode, data, size);
+	}
+
+	if (sink->checksum) {
+		checksum_update(sink->checksum, data, size);
+	}
+
+	return 1;
+}
+
+static uint8_t stream_zeroes(write_sink_t *sink, size_t size) {
+	while (size) {
+		size_t block = MIN(size, sizeof(zero_block));
+		if (!stream_data(sink, zero_block, block)) {
+			return 0;
+		}
+
+		size -= block;
+	}
+
+	return 1;
+}
+
+// Copy data we haven't read yet straight from the source without keeping it around
+static uint8_t stream_source(const ppelib_file_t *pe, write_sink_t *sink, size_t offset, size_t size) {
+	uint8_t block[16384];
+
+	while (size) {
+		size_t this_block = MIN(size, sizeof(block));
+		if (!reader_read(&pe->reader, offset, block, this_block) || !stream_data(sink, block, this_block)) {
+			return 0;
+		}
+
+		offset += this_block;
+		size -= this_block;
+	}
+
+	return 1;
+}
+
+static uint8_t stream_section(const ppelib_file_t *pe, section_t *section, write_sink_t *sink) {
+	if (section->contents) {
+		return stream_data(sink, section->contents, section->contents_size);
+	}
+
+	if (pe->reader.read) {
+		return stream_source(pe, sink, section->source_offset, section->contents_size);
+	}
+
+	return section_get_contents(section) && stream_data(sink, section->contents, section->contents_size);
+}
+
+// Write the file out piece by piece, straight from wherever the data lives. This
+// only works if headers and section contents come one after another without
+// overlapping, returns 0 without setting an error if they don't.
+static size_t write_to_stream(ppelib_file_t *pe, const write_layout_t *layout, write_sink_t *sink) {
+	size_t position = layout->end_of_headers;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (!section->contents_size) {
+			continue;
+		}
+
+		if (section->pointer_to_raw_data < position) {
+			return 0;
+		}
+
+		position = section->pointer_to_raw_data + section->contents_size;
+	}
+
+	const allocator_t *allocator = context_allocator(pe->context);
+	uint8_t *headers = allocator->malloc(allocator->userdata, layout->end_of_headers);
+	if (!headers) {
+		ppelib_set_error("Failed to allocate buffer");
+		return 0;
+	}
+
+	memset(headers, 0, layout->end_of_headers);
+	write_image(pe, layout, headers, 0);
+	uint8_t ok = stream_data(sink, headers, layout->end_of_headers);
+	allocator->free(allocator->userdata, headers);
+
+	if (!ok) {
+		return 0;
+	}
+
+	position = layout->end_of_headers;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (!section->contents_size) {
+			continue;
+		}
+
+		if (!stream_zeroes(sink, section->pointer_to_raw_data - position)) {
+			return 0;
+		}
+
+		if (!stream_section(pe, section, sink)) {
+			return 0;
+		}
+
+		position = section->pointer_to_raw_data + section->contents_size;
+	}
+
+	if (!stream_zeroes(sink, layout->end_of_section_data - position)) {
+		return 0;
+	}
+
+	if (pe->overlay) {
+		ok = stream_data(sink, pe->overlay, pe->overlay_size);
+	} else {
+		ok = stream_source(pe, sink, pe->overlay_offset, pe->overlay_size);
+	}
+
+	if (!ok) {
+		return 0;
+	}
+
+	return layout->size;
+}
+
+static size_t write_to_sink(ppelib_file_t *pe, const write_layout_t *layout, write_sink_t *sink) {
+	size_t written = write_to_stream(pe, layout, sink);
+	if (written || ppelib_error_peek()) {
+		return written;
+	}
+
+	// Overlapping layouts need the whole image assembled in memory
+	const allocator_t *allocator = context_allocator(pe->context);
+	uint8_t *buffer = allocator->malloc(allocator->userdata, layout->size);
+	if (!buffer) {
+		ppelib_set_error("Failed to allocate buffer");
+		return 0;
+	}
+
+	write_to_buffer(pe, buffer, layout->size, NULL);
+	if (!ppelib_error_peek() && stream_data(sink, buffer, layout->size)) {
+		written = layout->size;
+	}
+
+	allocator->free(allocator->userdata, buffer);
+	return written;
+}
+
+static uint8_t write_authenticode_init(const ppelib_file_t *pe, const write_layout_t *layout,
+		authenticode_t *authenticode, uint32_t algorithm) {
+	authenticode_ranges_t ranges;
+	write_authenticode_ranges(pe, layout, &ranges);
+
+	if (!authenticode_init(authenticode, algorithm, &ranges)) {
+		ppelib_set_error("Unknown digest algorithm");
+		return 0;
+	}
+
+	return 1;
+}
+
+static uint8_t file_seek(FILE *f, size_t offset) {
+#if defined _WIN32
+	int ret = _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+	int ret = fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+
+	if (ret != 0) {
+		ppelib_set_error("Failed to seek in file");
+		return 0;
+	}
+
+	return 1;
+}
+
+static size_t write_to_file(ppelib_file_t *pe, const char *filename, write_options_t *options) {
+	// Overwriting the file we're reading from would pull the data out from under us
+	if (mapped_file_is_same_file(&pe->mapped_file, filename) || reader_is_same_file(&pe->reader, filename)) {
+		release_source(pe);
+		if (ppelib_error_peek()) {
+			return 0;
+		}
+	}
+
+	write_layout_t layout;
+	write_layout(pe, &layout);
+
+	// The digest is computed while the file is written, there is no second pass over it
+	authenticode_t authenticode;
+	checksum_t checksum;
+	write_sink_t sink = { NULL, NULL, NULL };
+	if (options && options->digest_algorithm) {
+		if (!write_authenticode_init(pe, &layout, &authenticode, options->digest_algorithm)) {
+			return 0;
+		}
+		sink.authenticode = &authenticode;
+	}
+	if (options && options->update_checksum) {
+		checksum_init(&checksum, write_checksum_offset(&layout));
+		sink.checksum = &checksum;
+	}
+
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		ppelib_set_error("Failed to open file");
+		return 0;
+	}
+	sink.f = f;
+
+	size_t written = write_to_sink(pe, &layout, &sink);
+
+	// The headers are already written by the time the checksum is known
+	if (written && sink.checksum) {
+		uint8_t field[4];
+		options->checksum = checksum_final(&checksum);
+		write_uint32_t(field, options->checksum);
+		if (file_seek(f, write_checksum_offset(&layout)) && fwrite(field, 1, sizeof(field), f) != sizeof(field)) {
+			ppelib_set_error("Failed to write data");
+		}
+	}
+
+	if (fclose(f) != 0 && !ppelib_error_peek()) {
+		ppelib_set_error("Failed to write data");
+	}
+
+	if (ppelib_error_peek()) {
+		return 0;
+	}
+
+	if (sink.authenticode) {
+		authenticode_final(&authenticode, options->digest);
+	}
+
+	return written;
+}
+
+EXPORT_SYM size_t ppelib_write_to_file(ppelib_file_t *pe, const char *filename) {
+	ppelib_reset_error();
+
+	size_t retval = write_to_file(pe, filename, NULL);
+	context_take_error(pe->context);
+
+	return retval;
+}
+
+EXPORT_SYM size_t ppelib_write_to_file_with_options(ppelib_file_t *pe, const char *filename,
+		write_options_t *options) {
+	ppelib_reset_error();
+
+	size_t retval = 0;
+	if (write_options_check(options)) {
+		retval = write_to_file(pe, filename, options);
+	}
+	context_take_error(pe->context);
+
+	return retval;
+}
+
+EXPORT_SYM size_t ppelib_authenticode_digest(ppelib_file_t *pe, uint32_t algorithm, uint8_t *digest) {
+	ppelib_reset_error();
+
+	write_layout_t layout;
+	write_layout(pe, &layout);
+
+	authenticode_t authenticode;
+	size_t retval = 0;
+	if (write_authenticode_init(pe, &layout, &authenticode, algorithm)) {
+		write_sink_t sink = { NULL, &authenticode, NULL };
+		if (write_to_sink(pe, &layout, &sink)) {
+			authenticode_final(&authenticode, digest);
+			retval = authenticode.digest_size;
+		}
+	}
+	context_take_error(pe->context);
+
+	return retval;
+}
 
-	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		size_t section_size = ppelib_section_deserialize(buffer, size, offset, pe->sections[i]);
-		if (ppelib_error_peek()) {
-			goto out;
-		}
+static uint32_t checksum_handle(ppelib_file_t *pe) {
+	write_layout_t layout;
+	write_layout(pe, &layout);
 
-		section_t *section = pe->sections[i];
-		section->pe = pe;
+	checksum_t checksum;
+	checksum_init(&checksum, write_checksum_offset(&layout));
 
-		if (i == 0) {
-			pe->start_of_section_va = section->virtual_address;
-		} else {
-			pe->start_of_section_va = MIN(pe->start_of_section_va, section->virtual_address);
-		}
+	write_sink_t sink = { NULL, NULL, &checksum };
+	if (!write_to_sink(pe, &layout, &sink)) {
+		return 0;
+	}
 
-		if (section->size_of_raw_data > section->size_of_raw_data + section->virtual_size) {
-			ppelib_set_error("Section data size out of range");
-			goto out;
-		}
+	return checksum_final(&checksum);
+}
 
-		size_t data_size = MIN(section->virtual_size, section->size_of_raw_data);
+EXPORT_SYM uint32_t ppelib_checksum(ppelib_file_t *pe) {
+	ppelib_reset_error();
 
-		if (section->pointer_to_raw_data + data_size > size || section->pointer_to_raw_data > size || data_size > size) {
-			ppelib_set_error("Section data outside of file");
-			goto out;
-		}
+	uint32_t retval = checksum_handle(pe);
+	context_take_error(pe->context);
 
-		section->contents = malloc(data_size);
-		if (!section->contents) {
-			ppelib_set_error("Failed to allocate section data");
-			goto out;
-		}
+	return retval;
+}
 
-		section->contents_size = data_size;
-		memcpy(section->contents, buffer + section->pointer_to_raw_data, section->contents_size);
+EXPORT_SYM uint8_t ppelib_checksum_verify(ppelib_file_t *pe) {
+	ppelib_reset_error();
 
-		if (section->pointer_to_raw_data) {
-			if (first_section) {
-				first_section = 0;
-				pe->start_of_section_data = section->pointer_to_raw_data;
-			} else {
-				pe->start_of_section_data = MIN(pe->start_of_section_data, section->pointer_to_raw_data);
-			}
-		}
+	uint32_t checksum = checksum_handle(pe);
+	uint8_t retval = !ppelib_error_peek() && checksum == pe->header.checksum;
+	context_take_error(pe->context);
 
-		pe->end_of_section_data = MAX(pe->end_of_section_data,
-				section->pointer_to_raw_data + section->size_of_raw_data);
+	return retval;
+}
 
-		offset += section_size;
+static int compare_raw_data(const void *a, const void *b) {
+	const section_t *section_a = *(const section_t *const *)a;
+	const section_t *section_b = *(const section_t *const *)b;
+
+	if (section_a->pointer_to_raw_data != section_b->pointer_to_raw_data) {
+		return section_a->pointer_to_raw_data < section_b->pointer_to_raw_data ? -1 : 1;
 	}
 
-	pe->entrypoint_section = section_find_by_virtual_address(pe, pe->header.address_of_entry_point);
+	return 0;
+}
 
-	if (pe->entrypoint_section) {
-		pe->entrypoint_offset = pe->header.address_of_entry_point - pe->entrypoint_section->virtual_address;
+// One page for the headers, one per 4 KiB of section data in file order and an empty
+// page at the end of the section data.
+static size_t page_hashes(ppelib_file_t *pe, uint32_t algorithm, uint32_t number_of_threads, uint8_t *buffer,
+		size_t buf_size) {
+	size_t entry_size = page_hash_entry_size(algorithm);
+	if (!entry_size) {
+		ppelib_set_error("Unknown digest algorithm");
+		return 0;
 	}
 
-	pe->data_directories = calloc(sizeof(data_directory_t) * pe->header.number_of_rva_and_sizes, 1);
-	if (!pe->data_directories) {
-		ppelib_set_error("Failed to allocate data directories");
-		goto out;
+	const allocator_t *allocator = context_allocator(pe->context);
+	uint16_t number_of_sections = pe->header.number_of_sections;
+	section_t **sections = allocator->malloc(allocator->userdata, sizeof(section_t *) * (number_of_sections + 1u));
+	if (!sections) {
+		ppelib_set_error("Failed to allocate sections");
+		return 0;
 	}
 
-	// Data directories don't have a dedicated deserialize function
-	offset = header_offset + header_size;
-	for (uint32_t i = 0; i < pe->header.number_of_rva_and_sizes; ++i) {
-		uint32_t dir_va = read_uint32_t(buffer + offset + 0);
-		uint32_t dir_size = read_uint32_t(buffer + offset + 4);
-
-		section_t *section = section_find_by_virtual_address(pe, dir_va);
-		if (i != DIR_CERTIFICATE_TABLE && section) {
-			pe->data_directories[i].section = section;
-			pe->data_directories[i].offset = dir_va - section->virtual_address;
-		} else if (dir_size) {
-			// Certificate tables' addresses aren't virtual. Despite the name.
-			pe->data_directories[i].offset = dir_va - pe->end_of_section_data;
+	size_t number_of_pages = 2;
+	uint16_t number_of_data_sections = 0;
+	for (uint16_t i = 0; i < number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (section->pointer_to_raw_data && section->size_of_raw_data) {
+			sections[number_of_data_sections++] = section;
+			number_of_pages += TO_NEAREST((size_t)section->size_of_raw_data, PAGE_HASH_PAGE_SIZE) / PAGE_HASH_PAGE_SIZE;
 		}
-		pe->data_directories[i].size = dir_size;
-		pe->data_directories[i].id = i;
+	}
 
-		offset += DATA_DIRECTORY_SIZE;
+	size_t table_size = number_of_pages * entry_size;
+	if (!buffer) {
+		allocator->free(allocator->userdata, sections);
+		return table_size;
+	}
+
+	if (table_size > buf_size) {
+		allocator->free(allocator->userdata, sections);
+		ppelib_set_error("Target buffer too small.");
+		return 0;
 	}
 
-	if (pe->header.number_of_rva_and_sizes > DIR_IMPORT_TABLE) {
-		section_t *section = pe->data_directories[DIR_IMPORT_TABLE].section;
-		size_t offset = pe->data_directories[DIR_IMPORT_TABLE].offset;
+	qsort(sections, number_of_data_sections, sizeof(section_t *), compare_raw_data);
 
-		if (section) {
-			parse_import_table(section, offset, &pe->import_table, pe->header.magic);
-			if (ppelib_error_peek()) {
-				goto out;
-			}
-		}
+	write_layout_t layout;
+	write_layout(pe, &layout);
+
+	size_t size_of_headers = pe->header.size_of_headers;
+	size_t headers_size = MAX(layout.end_of_headers, size_of_headers);
+	uint8_t *headers = allocator->malloc(allocator->userdata, headers_size);
+	page_hash_page_t *pages = allocator->malloc(allocator->userdata, sizeof(page_hash_page_t) * number_of_pages);
+	if (!headers || !pages) {
+		ppelib_set_error("Failed to allocate pages");
+		table_size = 0;
+		goto out;
 	}
 
-	pe->end_of_section_data = MAX(pe->end_of_section_data, header_offset + header_size);
-	if (orig_size > pe->end_of_section_data) {
-		pe->overlay_size = size - pe->end_of_section_data;
-		pe->overlay = malloc(pe->overlay_size);
-		if (!pe->overlay) {
-			ppelib_set_error("Failed to allocate overlay data");
+	memset(headers, 0, headers_size);
+
+	write_image(pe, &layout, headers, 0);
+
+	size_t page = 0;
+	pages[page].offset = 0;
+	pages[page].data = headers;
+	pages[page].data_size = size_of_headers;
+	pages[page].size = MAX(TO_NEAREST(size_of_headers, PAGE_HASH_PAGE_SIZE), PAGE_HASH_PAGE_SIZE);
+	++page;
+
+	// Contents are loaded here, the threads only read them
+	uint32_t end_of_section_data = 0;
+	for (uint16_t i = 0; i < number_of_data_sections; ++i) {
+		section_t *section = sections[i];
+		const uint8_t *contents = section->contents;
+		if (section->contents_size && !(contents = section_get_contents(section))) {
+			table_size = 0;
 			goto out;
 		}
 
-		memcpy(pe->overlay, buffer + pe->end_of_section_data, pe->overlay_size);
+		size_t contents_size = MIN(section->contents_size, (size_t)section->size_of_raw_data);
+		for (size_t offset = 0; offset < section->size_of_raw_data; offset += PAGE_HASH_PAGE_SIZE) {
+			pages[page].offset = (uint32_t)(section->pointer_to_raw_data + offset);
+			pages[page].data = contents + MIN(offset, contents_size);
+			pages[page].data_size = offset < contents_size ? contents_size - offset : 0;
+			pages[page].size = PAGE_HASH_PAGE_SIZE;
+			++page;
+		}
+
+		end_of_section_data = MAX(end_of_section_data, section->pointer_to_raw_data + section->size_of_raw_data);
+	}
+
+	pages[page].offset = end_of_section_data;
+	pages[page].data = NULL;
+	pages[page].data_size = 0;
+	pages[page].size = 0;
+
+	authenticode_ranges_t ranges;
+	write_authenticode_ranges(pe, &layout, &ranges);
+
+	if (!number_of_threads) {
+		number_of_threads = cpu_count();
 	}
+	page_hashes_compute(allocator, algorithm, &ranges, pages, number_of_pages, number_of_threads, buffer);
 
 out:
-	if (oldptr) {
-		buffer = oldptr;
-		free(zeropage);
+	allocator->free(allocator->userdata, sections);
+	if (headers) {
+		allocator->free(allocator->userdata, headers);
 	}
-	if (ppelib_error_peek()) {
-		ppelib_destroy(pe);
-		return NULL;
+	if (pages) {
+		allocator->free(allocator->userdata, pages);
 	}
-	return pe;
+	return table_size;
 }
 
-EXPORT_SYM ppelib_file_t *ppelib_create_from_file(const char *filename) {
+EXPORT_SYM size_t ppelib_page_hashes(ppelib_file_t *pe, uint32_t algorithm, uint32_t number_of_threads,
+		uint8_t *buffer, size_t size) {
 	ppelib_reset_error();
-	size_t file_size;
-	uint8_t *file_contents;
 
-	FILE *f = fopen(filename, "rb");
+	size_t retval = page_hashes(pe, algorithm, number_of_threads, buffer, size);
+	context_take_error(pe->context);
 
-	if (!f) {
-		ppelib_set_error("Failed to open file");
-		return NULL;
-	}
+	return retval;
+}
 
-	fseek(f, 0, SEEK_END);
-	long ftell_size = ftell(f);
-	rewind(f);
+EXPORT_SYM uint8_t ppelib_page_hashes_verify(ppelib_file_t *pe, uint32_t algorithm, uint32_t number_of_threads,
+		const uint8_t *table, size_t size) {
+	ppelib_reset_error();
 
-	if (ftell_size < 0) {
-		fclose(f);
-		ppelib_set_error("Unable to read file length");
-		return NULL;
+	uint8_t retval = 0;
+	size_t table_size = page_hashes(pe, algorithm, number_of_threads, NULL, 0);
+	if (table_size && table_size == size) {
+		const allocator_t *allocator = context_allocator(pe->context);
+		uint8_t *computed = allocator->malloc(allocator->userdata, table_size);
+		if (!computed) {
+			ppelib_set_error("Failed to allocate table");
+		} else {
+			retval = page_hashes(pe, algorithm, number_of_threads, computed, table_size)
+					&& memcmp(computed, table, table_size) == 0;
+			allocator->free(allocator->userdata, computed);
+		}
 	}
+	context_take_error(pe->context);
 
-	file_size = (size_t)ftell_size;
-
-	if (!file_size) {
-		fclose(f);
-		ppelib_set_error("Empty file");
-		return NULL;
-	}
+	return retval;
+}
 
-	file_contents = malloc(file_size);
-	if (!file_size) {
-		fclose(f);
-		ppelib_set_error("Failed to allocate file data");
-		return NULL;
+static uint8_t pe_changed(const ppelib_file_t *pe) {
+	if (pe->changed || pe->overlay_modified || pe->dos_header.modified || pe->header.modified) {
+		return 1;
 	}
 
-	size_t retsize = fread(file_contents, 1, file_size, f);
-	if (retsize != file_size) {
-		fclose(f);
-		ppelib_set_error("Failed to read file data");
-		return NULL;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		if (pe->sections[i].modified || pe->sections[i].contents_modified) {
+			return 1;
+		}
 	}
 
-	fclose(f);
+	return 0;
+}
 
-	ppelib_file_t *retval = ppelib_create_from_buffer(file_contents, file_size);
-	free(file_contents);
+// Sections that are still where they were in the source, and fit in the space
+// they had there, are patched in place.
+static uint8_t section_in_place(const section_t *section) {
+	if (section->pointer_to_raw_data != section->source_offset) {
+		return 0;
+	}
 
-	return retval;
+	return !section->contents_modified || section->contents_size <= section->source_size;
 }
 
-EXPORT_SYM size_t ppelib_write_to_buffer(ppelib_file_t *pe, uint8_t *buffer, size_t buf_size) {
-	size_t size = 0;
+// Everything else has to come after the original end of the section data, where
+// the tail of the file is rewritten. Returns 0 if the file can't be patched.
+static uint8_t patch_plan(const ppelib_file_t *pe, const write_layout_t *layout, uint8_t *rewrite_tail) {
+	size_t tail = pe->overlay_offset;
 
-	//	size_t dos_stub_size = pe->dos_header.stub_size;
-	size_t header_size = ppelib_header_serialize(&pe->header, NULL, 0);
-	size_t data_tables_size = pe->header.number_of_rva_and_sizes * DATA_DIRECTORY_SIZE;
-	size_t section_header_size = pe->header.number_of_sections * SECTION_SIZE;
+	// Shrinking the file would need truncating it
+	if (layout->size < pe->source_size || layout->end_of_section_data < tail) {
+		return 0;
+	}
 
-	size_t section_size = 0;
+	*rewrite_tail = pe->overlay_modified || layout->end_of_section_data != tail;
 
-	size_t pe_header_offset = pe->dos_header.pe_header_offset + 4;
-	size_t section_header_offset = pe_header_offset + COFF_HEADER_SIZE + pe->header.size_of_optional_header;
+	size_t position = layout->end_of_headers;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		const section_t *section = &pe->sections[i];
+		if (!section->contents_size && !section->contents_modified) {
+			continue;
+		}
 
-	uint32_t file_alignment = MAX(pe->header.file_alignment, 512);
-	file_alignment = MIN(file_alignment, UINT16_MAX);
+		size_t end = section->pointer_to_raw_data + section->contents_size;
+		if (section_in_place(section)) {
+			if (section->contents_modified) {
+				end = section->pointer_to_raw_data + section->source_size;
+			}
+		} else if (section->pointer_to_raw_data >= tail) {
+			*rewrite_tail = 1;
+		} else {
+			return 0;
+		}
 
-	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		section_t *section = pe->sections[i];
+		if (section->pointer_to_raw_data < position) {
+			return 0;
+		}
 
-		size_t this_section_size = section->pointer_to_raw_data;
-		this_section_size += section->size_of_raw_data;
-		section_size = MAX(section_size, this_section_size);
+		position = MAX(position, end);
 	}
 
-	size += 2;
-	size += pe->dos_header.pe_header_offset;
-	size += 4;
-	size += pe->header.size_of_optional_header;
-	size += section_header_size;
-
-	// Some of this stuff may overlap so we need to ensure we have at least as much space
-	// as the furthest out write
-	size = MAX(size, section_size);
-	size = MAX(size, pe_header_offset + header_size);
-	size = MAX(size, pe_header_offset + header_size + data_tables_size);
-	size = MAX(size, section_header_offset + section_header_size);
+	return !*rewrite_tail || layout->end_of_headers <= tail;
+}
 
-	size_t end_of_section_data = size;
+static uint8_t patch_tail(ppelib_file_t *pe, const write_layout_t *layout, FILE *f) {
+	write_sink_t sink = { f, NULL, NULL };
+	size_t position = pe->overlay_offset;
+	if (!file_seek(f, position)) {
+		return 0;
+	}
 
-	size += pe->overlay_size;
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (!section->contents_size || section_in_place(section)) {
+			continue;
+		}
 
-	printf("dos_header_size: %i\n", DOS_HEADER_SIZE);
-	//printf("dos_stub_size: %zi\n", dos_stub_size);
-	printf("header_size: %zi\n", header_size);
-	//printf("data_tables_size: %zi\n", data_tables_size);
-	printf("section_header_size: %zi\n", section_header_size);
-	printf("section_size: %zi\n", section_size);
-	printf("overlay_size: %zi\n", pe->overlay_size);
-	printf("total: %zi\n", size);
+		if (!stream_zeroes(&sink, section->pointer_to_raw_data - position) || !stream_section(pe, section, &sink)) {
+			return 0;
+		}
 
-	if (!buffer) {
-		return size;
+		position = section->pointer_to_raw_data + section->contents_size;
 	}
 
-	if (buffer && size > buf_size) {
-		ppelib_set_error("Target buffer too small.");
+	if (!stream_zeroes(&sink, layout->end_of_section_data - position)) {
 		return 0;
 	}
 
-	memset(buffer, 0, size);
+	return stream_data(&sink, pe->overlay, pe->overlay_size);
+}
 
-	write_uint16_t(buffer, MZ_SIGNATURE);
-	ppelib_dos_header_serialize(&pe->dos_header, buffer, 2);
-	if (pe->dos_header.stub_size) {
-		memcpy(buffer + 2 + DOS_HEADER_SIZE, pe->dos_header.stub, pe->dos_header.stub_size);
-	}
-	write_uint32_t(buffer + pe->dos_header.pe_header_offset, PE_SIGNATURE);
-	ppelib_header_serialize(&pe->header, buffer, pe_header_offset);
+static uint8_t patch_sections(ppelib_file_t *pe, FILE *f) {
+	write_sink_t sink = { f, NULL, NULL };
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (!section->contents_modified || !section_in_place(section)) {
+			continue;
+		}
 
-	size_t offset = pe_header_offset + header_size;
-	for (uint32_t i = 0; i < pe->header.number_of_rva_and_sizes; ++i) {
-		data_directory_t *dir = &pe->data_directories[i];
-		section_t *section = dir->section;
-		uint32_t dir_va = 0;
-		uint32_t dir_size = (uint32_t)dir->size;
+		if (section->contents_size && !section_get_contents(section)) {
+			return 0;
+		}
 
-		if (section) {
-			dir_va = (uint32_t)(section->virtual_address + dir->offset);
-		} else if (dir->size) {
-			dir_va = (uint32_t)(end_of_section_data + dir->offset);
+		if (!file_seek(f, section->pointer_to_raw_data) || !stream_data(&sink, section->contents, section->contents_size) ||
+				!stream_zeroes(&sink, section->source_size - section->contents_size)) {
+			return 0;
 		}
+	}
 
-		write_uint32_t(buffer + offset + 0, dir_va);
-		write_uint32_t(buffer + offset + 4, dir_size);
+	return 1;
+}
 
-		offset += DATA_DIRECTORY_SIZE;
+// Only write the part of the headers that differs from what's in the file
+static uint8_t patch_headers(ppelib_file_t *pe, const write_layout_t *layout, FILE *f) {
+	size_t size = layout->end_of_headers;
+	const allocator_t *allocator = context_allocator(pe->context);
+	uint8_t *headers = allocator->malloc(allocator->userdata, size * 2);
+	if (!headers) {
+		ppelib_set_error("Failed to allocate buffer");
+		return 0;
 	}
 
-	offset = section_header_offset;
-	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		section_t *section = pe->sections[i];
-		ppelib_section_serialize(section, buffer, offset);
+	memset(headers, 0, size * 2);
+	uint8_t *original = headers + size;
+	write_image(pe, layout, headers, 0);
 
-		if (section->contents_size) {
-			memcpy(buffer + section->pointer_to_raw_data, section->contents, section->contents_size);
-		}
+	size_t original_size = 0;
+	if (file_seek(f, 0)) {
+		original_size = fread(original, 1, size, f);
+	}
 
-		offset += SECTION_SIZE;
+	size_t first = 0;
+	while (first < original_size && headers[first] == original[first]) {
+		++first;
+	}
+
+	size_t last = size;
+	if (last <= original_size) {
+		while (last > first && headers[last - 1] == original[last - 1]) {
+			--last;
+		}
 	}
 
-	if (pe->overlay_size) {
-		memcpy(buffer + end_of_section_data, pe->overlay, pe->overlay_size);
+	uint8_t ok = !ppelib_error_peek();
+	if (ok && first < last) {
+		write_sink_t sink = { f, NULL, NULL };
+		ok = file_seek(f, first) && stream_data(&sink, headers + first, last - first);
 	}
 
-	return size;
+	allocator->free(allocator->userdata, headers);
+	return ok;
 }
 
-EXPORT_SYM size_t ppelib_write_to_file(ppelib_file_t *pe, const char *filename) {
-	ppelib_reset_error();
+static size_t write_changes_to_file(ppelib_file_t *pe, const char *filename) {
+	if (!pe->source_size) {
+		ppelib_set_error("Handle wasn't parsed from a file");
+		return 0;
+	}
 
-	FILE *f = fopen(filename, "wb");
+	write_layout_t layout;
+	write_layout(pe, &layout);
+
+	if (!pe_changed(pe)) {
+		return layout.size;
+	}
+
+	uint8_t rewrite_tail = 0;
+	if (!patch_plan(pe, &layout, &rewrite_tail)) {
+		return write_to_file(pe, filename, NULL);
+	}
+
+	// The overlay and string table move, they can't be copied from the part of the
+	// file we're overwriting
+	if (rewrite_tail && !detach_trailing_data(pe)) {
+		return 0;
+	}
+
+	FILE *f = fopen(filename, "r+b");
 	if (!f) {
 		ppelib_set_error("Failed to open file");
 		return 0;
 	}
 
-	size_t bufsize = ppelib_write_to_buffer(pe, NULL, 0);
-	if (ppelib_error_peek()) {
-		fclose(f);
-		return 0;
+	// The headers go last so an interrupted write leaves them describing the old layout
+	if (rewrite_tail) {
+		patch_tail(pe, &layout, f);
 	}
 
-	uint8_t *buffer = malloc(bufsize);
-	if (!buffer) {
-		ppelib_set_error("Failed to allocate buffer");
-		fclose(f);
-		return 0;
+	if (!ppelib_error_peek()) {
+		patch_sections(pe, f);
+	}
+
+	if (!ppelib_error_peek()) {
+		patch_headers(pe, &layout, f);
+	}
+
+	if (fclose(f) != 0 && !ppelib_error_peek()) {
+		ppelib_set_error("Failed to write data");
 	}
 
-	ppelib_write_to_buffer(pe, buffer, bufsize);
 	if (ppelib_error_peek()) {
-		fclose(f);
-		free(buffer);
 		return 0;
 	}
 
-	size_t written = fwrite(buffer, 1, bufsize, f);
-	fclose(f);
-	free(buffer);
+	// The file now holds what we just wrote, later patches start from there
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		if (section->contents && !section_in_place(section)) {
+			section->source_offset = section->pointer_to_raw_data;
+			section->source_size = section->contents_size;
+		}
 
-	if (written != bufsize) {
-		ppelib_set_error("Failed to write data");
+		section->contents_modified = 0;
 	}
 
-	return written;
+	if (rewrite_tail) {
+		pe->overlay_offset = layout.end_of_section_data;
+		pe->source_size = layout.size;
+	}
+	pe->overlay_modified = 0;
+	pe->changed = 0;
+
+	return layout.size;
+}
+
+EXPORT_SYM size_t ppelib_write_changes_to_file(ppelib_file_t *pe, const char *filename) {
+	ppelib_reset_error();
+
+	size_t retval = write_changes_to_file(pe, filename);
+	context_take_error(pe->context);
+
+	return retval;
 }
 
 void recalculate_sections(ppelib_file_t *pe) {
@@ -572,7 +1766,7 @@ void recalculate_sections(ppelib_file_t *pe) {
 	char modified = 0;
 
 	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		section_t *section = pe->sections[i];
+		section_t *section = &pe->sections[i];
 
 		if (section->modified) {
 			modified = 1;
@@ -661,6 +1855,9 @@ void recalculate_sections(ppelib_file_t *pe) {
 	}
 
 	if (modified) {
+		pe->changed = 1;
+		section_index_invalidate(pe);
+
 		// PE files with only data can have this set to garbage. Might as well just keep it.
 		if (size_of_code) {
 			pe->header.base_of_code = base_of_code;
@@ -727,6 +1924,9 @@ void recalculate_header(ppelib_file_t *pe) {
 		recalculate_sections(pe);
 	}
 
+	if (pe->header.modified) {
+		pe->changed = 1;
+	}
 	pe->header.modified = 0;
 }
 
@@ -738,6 +1938,9 @@ void recalculate_dos_header(ppelib_file_t *pe) {
 		recalculate_header(pe);
 	}
 
+	if (pe->dos_header.modified) {
+		pe->changed = 1;
+	}
 	pe->dos_header.modified = 0;
 }
 
@@ -749,6 +1952,8 @@ EXPORT_SYM void ppelib_recalculate_force(ppelib_file_t *pe) {
 	recalculate_dos_header(pe);
 	recalculate_header(pe);
 	recalculate_sections(pe);
+
+	pe->changed = 1;
 }
 
 EXPORT_SYM void ppelib_recalculate(ppelib_file_t *pe) {
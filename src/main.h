@@ -20,14 +20,42 @@
 
 typedef struct data_directory data_directory_t;
 
+#include "arena.h"
+#include "digest.h"
 #include "generated/dos_header_private.h"
 #include "generated/header_private.h"
 #include "generated/section_private.h"
+#include "header/certificate_table.h"
 #include "header/data_directory_private.h"
+#include "header/export_table.h"
 #include "header/import_table.h"
+#include "header/resource_table.h"
+#include "header/symbol_table.h"
+#include "mapped_file.h"
+#include "reader.h"
+#include "section_index.h"
 #include "string_table_private.h"
 
+// Same layout as ppelib_write_options
+typedef struct write_options {
+	uint32_t digest_algorithm;
+	uint8_t digest[DIGEST_MAX_SIZE];
+	uint8_t update_checksum;
+	uint32_t checksum;
+} write_options_t;
+
+enum parse_flags {
+	PARSE_BORROW = 1 << 0,
+	PARSE_LAZY = 1 << 1,
+	PARSE_HEADERS = 1 << 2,
+};
+
 typedef struct ppelib_file {
+	// Everything allocated while parsing, see buffer_is_borrowed()
+	arena_t arena;
+	// Where the handle allocates from and reports errors to, NULL for the default
+	ppelib_context_t *context;
+
 	size_t start_of_section_va;
 
 	size_t start_of_section_data;
@@ -40,16 +68,51 @@ typedef struct ppelib_file {
 	header_t header;
 	data_directory_t *data_directories;
 	import_table_t import_table;
+	uint8_t import_table_loaded;
+	export_table_t export_table;
+	uint8_t export_table_loaded;
+	// Why loading the export table failed, NULL if it didn't
+	const char *export_table_error;
 
 	string_table_t string_table;
-	section_t **sections;
+	symbol_table_t symbol_table;
+	uint8_t symbol_table_loaded;
+	// Stored inline so scans over the section headers stay in one block of memory.
+	// Growing the array moves every section, see sections_grow().
+	section_t *sections;
+	size_t sections_capacity;
+	section_index_t section_index;
 
-	//	certificate_table_t certificate_table;
-	//	ppelib_resource_table_t resource_table;
+	resource_table_t resource_table;
+	uint8_t resource_table_loaded;
+
+	certificate_table_t certificate_table;
+	uint8_t certificate_table_loaded;
 
 	uint8_t *stub;
 	size_t overlay_size;
+	size_t overlay_offset;
 	uint8_t *overlay;
+	uint8_t overlay_modified;
+
+	// Anything changed since parsing or the last ppelib_write_changes_to_file(). The
+	// modified flags of the structures themselves are cleared by ppelib_recalculate().
+	uint8_t changed;
+
+	// Size of the file we were parsed from, see ppelib_write_changes_to_file()
+	size_t source_size;
+
+	// When parsing without copying, section contents and the overlay point into
+	// this memory until they are first modified. See buffer_make_owned().
+	const uint8_t *borrowed;
+	size_t borrowed_size;
+
+	uint8_t *zeropage;
+	mapped_file_t mapped_file;
+
+	// Sources that can't be borrowed from are read from here on demand. Section
+	// contents and the overlay are NULL with a non-zero size until then.
+	reader_t reader;
 } ppelib_file_t;
 
 #endif /* PPELIB_MAIN_H_ */
@@ -0,0 +1,203 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+#include "platform.h"
+#include "ppe_error.h"
+
+// The mapping is read-only. Anything that wants to modify mapped data has to
+// make a private copy first, see buffer_make_owned().
+
+#if defined _WIN32
+void mapped_file_open(const char *filename, mapped_file_t *mapped_file) {
+	memset(mapped_file, 0, sizeof(mapped_file_t));
+
+	// ppelib_write_changes_to_file() patches the file while it is still mapped
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		ppelib_set_error("Failed to open file");
+		return;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		ppelib_set_error("Unable to read file length");
+		return;
+	}
+
+	if (!file_size.QuadPart) {
+		CloseHandle(file);
+		ppelib_set_error("Empty file");
+		return;
+	}
+
+	if ((uint64_t)file_size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		ppelib_set_error("File too large to map");
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		ppelib_set_error("Failed to map file");
+		return;
+	}
+
+	const uint8_t *buffer = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!buffer) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		ppelib_set_error("Failed to map file");
+		return;
+	}
+
+	BY_HANDLE_FILE_INFORMATION info;
+	if (!GetFileInformationByHandle(file, &info)) {
+		UnmapViewOfFile(buffer);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		ppelib_set_error("Failed to map file");
+		return;
+	}
+
+	mapped_file->buffer = buffer;
+	mapped_file->size = (size_t)file_size.QuadPart;
+	mapped_file->device = info.dwVolumeSerialNumber;
+	mapped_file->inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	mapped_file->file = file;
+	mapped_file->mapping = mapping;
+}
+
+void mapped_file_close(mapped_file_t *mapped_file) {
+	if (!mapped_file->buffer) {
+		return;
+	}
+
+	UnmapViewOfFile(mapped_file->buffer);
+	CloseHandle(mapped_file->mapping);
+	CloseHandle(mapped_file->file);
+
+	memset(mapped_file, 0, sizeof(mapped_file_t));
+}
+
+// Windows refuses to truncate a file while it is mapped, writing over the file
+// has to release the mapping first.
+uint8_t mapped_file_is_same_file(const mapped_file_t *mapped_file, const char *filename) {
+	if (!mapped_file->buffer) {
+		return 0;
+	}
+
+	HANDLE file = CreateFileA(filename, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+
+	BY_HANDLE_FILE_INFORMATION info;
+	BOOL ok = GetFileInformationByHandle(file, &info);
+	CloseHandle(file);
+	if (!ok) {
+		return 0;
+	}
+
+	uint64_t inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	return info.dwVolumeSerialNumber == mapped_file->device && inode == mapped_file->inode;
+}
+#else
+void mapped_file_open(const char *filename, mapped_file_t *mapped_file) {
+	memset(mapped_file, 0, sizeof(mapped_file_t));
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		ppelib_set_error("Failed to open file");
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 0) {
+		close(fd);
+		ppelib_set_error("Unable to read file length");
+		return;
+	}
+
+	if (!st.st_size) {
+		close(fd);
+		ppelib_set_error("Empty file");
+		return;
+	}
+
+	if ((uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		ppelib_set_error("File too large to map");
+		return;
+	}
+
+	size_t size = (size_t)st.st_size;
+	void *buffer = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (buffer == MAP_FAILED) {
+		ppelib_set_error("Failed to map file");
+		return;
+	}
+
+	mapped_file->buffer = buffer;
+	mapped_file->size = size;
+	mapped_file->device = (uint64_t)st.st_dev;
+	mapped_file->inode = (uint64_t)st.st_ino;
+}
+
+void mapped_file_close(mapped_file_t *mapped_file) {
+	if (!mapped_file->buffer) {
+		return;
+	}
+
+	munmap((void *)mapped_file->buffer, mapped_file->size);
+
+	memset(mapped_file, 0, sizeof(mapped_file_t));
+}
+
+// Truncating a file while it is mapped makes any access to the mapping fault.
+uint8_t mapped_file_is_same_file(const mapped_file_t *mapped_file, const char *filename) {
+	if (!mapped_file->buffer) {
+		return 0;
+	}
+
+	struct stat st;
+	if (stat(filename, &st) != 0) {
+		return 0;
+	}
+
+	return (uint64_t)st.st_dev == mapped_file->device && (uint64_t)st.st_ino == mapped_file->inode;
+}
+#endif
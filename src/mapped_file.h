@@ -15,41 +15,28 @@
  * limitations under the License.
  */
 
-#ifndef PPELIB_RESOURCE_TABLE_H_
-#define PPELIB_RESOURCE_TABLE_H_
+#ifndef PPELIB_MAPPED_FILE_H_
+#define PPELIB_MAPPED_FILE_H_
 
 #include <inttypes.h>
 #include <stddef.h>
 
-#include <ppelib/ppelib-constants.h>
+typedef struct mapped_file {
+	const uint8_t *buffer;
+	size_t size;
 
-typedef struct ppelib_resource_data {
-	wchar_t *name;
-	uint32_t resource_type;
+	// Volume serial number and file index on Windows
+	uint64_t device;
+	uint64_t inode;
 
-	uint32_t size;
-	uint32_t codepage;
-	uint32_t reserved;
+#if defined _WIN32
+	void *file;
+	void *mapping;
+#endif
+} mapped_file_t;
 
-	uint8_t *data;
-} ppelib_resource_data_t;
+void mapped_file_open(const char *filename, mapped_file_t *mapped_file);
+void mapped_file_close(mapped_file_t *mapped_file);
+uint8_t mapped_file_is_same_file(const mapped_file_t *mapped_file, const char *filename);
 
-typedef struct ppelib_resource_table {
-	uint8_t root;
-
-	wchar_t *name;
-	uint32_t resource_type;
-
-	uint32_t characteristics;
-	uint32_t time_date_stamp;
-	uint16_t major_version;
-	uint16_t minor_version;
-
-	size_t subdirectories_number;
-	struct ppelib_resource_table **subdirectories;
-
-	size_t data_entries_number;
-	struct ppelib_resource_data **data_entries;
-} ppelib_resource_table_t;
-
-#endif /* PPELIB_RESOURCE_TABLE_H_ */
+#endif /* PPELIB_MAPPED_FILE_H_ */
@@ -0,0 +1,118 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "authenticode.h"
+#include "digest.h"
+#include "page_hash.h"
+#include "platform.h"
+#include "threads.h"
+#include "utils.h"
+
+// Pages are handed out in contiguous runs so every thread reads its own part of the
+// file, and each entry goes to the place of its page in the table. The output is the
+// same for any number of threads.
+typedef struct page_hash_job {
+	uint32_t algorithm;
+	const authenticode_ranges_t *ranges;
+	const page_hash_page_t *pages;
+	size_t first_page;
+	size_t number_of_pages;
+	uint8_t *table;
+} page_hash_job_t;
+
+// Threads aren't worth starting for fewer pages than this
+#define PAGES_PER_THREAD 64
+
+static const uint8_t zero_page[PAGE_HASH_PAGE_SIZE];
+
+size_t page_hash_entry_size(uint32_t algorithm) {
+	digest_t digest;
+	size_t digest_size = digest_init(&digest, algorithm);
+	return digest_size ? 4 + digest_size : 0;
+}
+
+static void page_hash(const page_hash_job_t *job, const page_hash_page_t *page, uint8_t *entry) {
+	write_uint32_t(entry, page->offset);
+
+	authenticode_t authenticode;
+	size_t digest_size = authenticode_init(&authenticode, job->algorithm, job->ranges);
+	if (!page->size) {
+		memset(entry + 4, 0, digest_size);
+		return;
+	}
+
+	size_t data_size = MIN(page->data_size, page->size);
+	authenticode.position = page->offset;
+	authenticode_update(&authenticode, page->data, data_size);
+
+	for (size_t zeroes = page->size - data_size; zeroes;) {
+		size_t block = MIN(zeroes, sizeof(zero_page));
+		digest_update(&authenticode.digest, zero_page, block);
+		zeroes -= block;
+	}
+
+	authenticode_final(&authenticode, entry + 4);
+}
+
+static void page_hash_job(void *userdata) {
+	const page_hash_job_t *job = userdata;
+	size_t entry_size = page_hash_entry_size(job->algorithm);
+
+	for (size_t i = job->first_page; i < job->first_page + job->number_of_pages; ++i) {
+		page_hash(job, &job->pages[i], job->table + i * entry_size);
+	}
+}
+
+void page_hashes_compute(const allocator_t *allocator, uint32_t algorithm, const authenticode_ranges_t *ranges, const page_hash_page_t *pages,
+		size_t number_of_pages, uint32_t number_of_threads, uint8_t *table) {
+	size_t max_threads = number_of_pages / PAGES_PER_THREAD + 1;
+	if (number_of_threads > max_threads) {
+		number_of_threads = (uint32_t)max_threads;
+	}
+	if (!number_of_threads) {
+		number_of_threads = 1;
+	}
+
+	page_hash_job_t jobs_on_stack[1];
+	page_hash_job_t *jobs = jobs_on_stack;
+	if (number_of_threads > 1) {
+		jobs = allocator->malloc(allocator->userdata, sizeof(page_hash_job_t) * number_of_threads);
+		if (!jobs) {
+			jobs = jobs_on_stack;
+			number_of_threads = 1;
+		}
+	}
+
+	for (uint32_t i = 0; i < number_of_threads; ++i) {
+		jobs[i].algorithm = algorithm;
+		jobs[i].ranges = ranges;
+		jobs[i].pages = pages;
+		jobs[i].first_page = number_of_pages * i / number_of_threads;
+		jobs[i].number_of_pages = number_of_pages * (i + 1) / number_of_threads - jobs[i].first_page;
+		jobs[i].table = table;
+	}
+
+	threads_run(allocator, page_hash_job, jobs, sizeof(page_hash_job_t), number_of_threads);
+
+	if (jobs != jobs_on_stack) {
+		allocator->free(allocator->userdata, jobs);
+	}
+}
@@ -0,0 +1,46 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_PAGE_HASH_H_
+#define PPELIB_PAGE_HASH_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "authenticode.h"
+#include "context.h"
+
+#define PAGE_HASH_PAGE_SIZE 4096
+
+// A page is size bytes of the file starting at offset, of which the first data_size
+// are in data and the rest are zeroes. Pages of size 0 get a zero digest, that is
+// how the table is ended.
+typedef struct page_hash_page {
+	uint32_t offset;
+	const uint8_t *data;
+	size_t data_size;
+	size_t size;
+} page_hash_page_t;
+
+// The size of a table entry, 0 for unknown algorithms
+size_t page_hash_entry_size(uint32_t algorithm);
+// Writes an entry for every page into table, in the order of pages. The parts of the
+// file in ranges are left out of the digests like they are for the image digest.
+void page_hashes_compute(const allocator_t *allocator, uint32_t algorithm, const authenticode_ranges_t *ranges, const page_hash_page_t *pages,
+		size_t number_of_pages, uint32_t number_of_threads, uint8_t *table);
+
+#endif /* PPELIB_PAGE_HASH_H_ */
@@ -30,6 +30,30 @@
 
 #include "dos_header/rich_table.h"
 
+uint8_t buffer_is_borrowed(const ppelib_file_t *pe, const void *buffer);
+uint8_t buffer_make_owned(const ppelib_file_t *pe, uint8_t **buffer, size_t size);
+void buffer_free(const ppelib_file_t *pe, void *buffer);
+
+ppelib_file_t *create_from_reader(ppelib_context_t *context, const reader_t *reader, uint32_t flags);
+uint8_t *overlay_get(ppelib_file_t *pe);
+
+uint8_t *section_get_contents(section_t *section);
+uint8_t section_make_owned(section_t *section);
+
+uint16_t ppelib_section_create(ppelib_file_t *pe, char name[9], uint32_t virtual_size, uint32_t raw_size,
+		uint32_t characteristics, uint8_t *data);
+void ppelib_section_excise(ppelib_file_t *pe, uint16_t section_index, size_t start, size_t end);
+void ppelib_section_insert_capacity(ppelib_file_t *pe, uint16_t section_index, size_t size, size_t offset);
+void ppelib_section_resize(ppelib_file_t *pe, uint16_t section_index, size_t size);
+uint16_t ppelib_section_find_index(ppelib_file_t *pe, section_t *section);
+
+typedef struct rva_location {
+	const section_t *section;
+	size_t offset;
+	size_t file_offset;
+} rva_location_t;
+
+void section_index_invalidate(ppelib_file_t *pe);
 section_t *section_find_by_physical_address(ppelib_file_t *pe, size_t address);
 section_t *section_find_by_virtual_address(ppelib_file_t *pe, size_t va);
 size_t section_rva_to_offset(const section_t *section, size_t rva);
@@ -38,15 +62,27 @@ void *section_rva_to_pointer(const section_t *section, size_t rva);
 void parse_dos_stub(dos_header_t *dos_header);
 void update_dos_stub(dos_header_t *dos_header);
 
-uint8_t parse_vlv_signature(uint8_t *buffer, size_t size, vlv_signature_t *vlv_signature);
-uint8_t parse_rich_table(uint8_t *buffer, size_t size, rich_table_t *rich_table);
+// The offsets are those of the markers, size + 1 if there is none
+uint8_t parse_vlv_signature(uint8_t *buffer, size_t size, size_t vlv_offset, vlv_signature_t *vlv_signature,
+		arena_t *arena);
+uint8_t parse_rich_table(uint8_t *buffer, size_t size, size_t footer_offset, rich_table_t *rich_table,
+		arena_t *arena);
 
 EXPORT_SYM void ppelib_recalculate(ppelib_file_t *pe);
+EXPORT_SYM void ppelib_destroy(ppelib_file_t *pe);
 
 const char *string_table_get(string_table_t *string_table, size_t offset);
-void string_table_free(string_table_t *string_table);
-void parse_string_table(const uint8_t *buffer, size_t size, size_t offset, string_table_t *string_table);
+const char *string_table_resolve_name(string_table_t *string_table, const char *name, uint32_t *offset);
+size_t string_table_find(string_table_t *string_table, arena_t *arena, const char *name);
+void parse_string_table(const uint8_t *buffer, size_t size, size_t offset, string_table_t *string_table, arena_t *arena,
+		uint8_t copy);
 
-void parse_import_table(const section_t *section, size_t offset, import_table_t *import_table, uint16_t magic);
-void import_table_free(import_table_t *import_table);
+void parse_import_table(section_t *section, size_t offset, import_table_t *import_table, uint16_t magic);
+void import_table_load(ppelib_file_t *pe);
+void export_table_load(ppelib_file_t *pe);
+void symbol_table_load(ppelib_file_t *pe);
+void resource_table_load(ppelib_file_t *pe);
+void certificate_table_load(ppelib_file_t *pe);
+void certificate_table_reset(ppelib_file_t *pe);
+uint8_t resource_entry_read(resource_directory_t *directory, uint32_t index, resource_entry_t *entry);
 #endif /* PPELIB_INTERNAL_H_ */
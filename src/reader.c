@@ -0,0 +1,184 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "platform.h"
+#include "ppe_error.h"
+#include "reader.h"
+#include "utils.h"
+
+// Reads past the end of the source come back as zeroes, the same as the zero
+// padding tiny files get when parsed from a buffer.
+uint8_t reader_read(const reader_t *reader, size_t offset, uint8_t *buffer, size_t size) {
+	size_t available = 0;
+	if (offset < reader->size) {
+		available = MIN(size, reader->size - offset);
+	}
+
+	if (available) {
+		if (reader->buffer) {
+			memcpy(buffer, reader->buffer + offset, available);
+		} else if (reader->read(reader->userdata, offset, buffer, available) != available) {
+			ppelib_set_error("Failed to read file data");
+			return 0;
+		}
+	}
+
+	memset(buffer + available, 0, size - available);
+	return 1;
+}
+
+#if defined _WIN32
+static size_t fd_read(void *userdata, size_t offset, uint8_t *buffer, size_t size) {
+	HANDLE file = (HANDLE)_get_osfhandle((int)(intptr_t)userdata);
+	size_t total = 0;
+
+	while (total < size) {
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(OVERLAPPED));
+		overlapped.Offset = (DWORD)((uint64_t)(offset + total) & 0xFFFFFFFF);
+		overlapped.OffsetHigh = (DWORD)((uint64_t)(offset + total) >> 32);
+
+		DWORD chunk = (DWORD)MIN(size - total, UINT32_MAX);
+		DWORD retsize = 0;
+		if (!ReadFile(file, buffer + total, chunk, &retsize, &overlapped) || !retsize) {
+			break;
+		}
+
+		total += retsize;
+	}
+
+	return total;
+}
+
+void reader_open_fd(int fd, reader_t *reader) {
+	memset(reader, 0, sizeof(reader_t));
+
+	struct _stat64 st;
+	if (_fstat64(fd, &st) != 0 || st.st_size < 0) {
+		ppelib_set_error("Unable to read file length");
+		return;
+	}
+
+	if (!st.st_size) {
+		ppelib_set_error("Empty file");
+		return;
+	}
+
+	if ((uint64_t)st.st_size > SIZE_MAX) {
+		ppelib_set_error("File too large");
+		return;
+	}
+
+	reader->read = fd_read;
+	reader->userdata = (void *)(intptr_t)fd;
+	reader->size = (size_t)st.st_size;
+}
+
+uint8_t reader_is_same_file(const reader_t *reader, const char *filename) {
+	if (reader->read != fd_read) {
+		return 0;
+	}
+
+	HANDLE file = CreateFileA(filename, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+
+	BY_HANDLE_FILE_INFORMATION info1;
+	BY_HANDLE_FILE_INFORMATION info2;
+	BOOL ok1 = GetFileInformationByHandle((HANDLE)_get_osfhandle((int)(intptr_t)reader->userdata), &info1);
+	BOOL ok2 = GetFileInformationByHandle(file, &info2);
+	CloseHandle(file);
+
+	if (!ok1 || !ok2) {
+		return 0;
+	}
+
+	return info1.dwVolumeSerialNumber == info2.dwVolumeSerialNumber && info1.nFileIndexHigh == info2.nFileIndexHigh &&
+		   info1.nFileIndexLow == info2.nFileIndexLow;
+}
+#else
+static size_t fd_read(void *userdata, size_t offset, uint8_t *buffer, size_t size) {
+	int fd = (int)(intptr_t)userdata;
+	size_t total = 0;
+
+	while (total < size) {
+		ssize_t retsize = pread(fd, buffer + total, size - total, (off_t)(offset + total));
+		if (retsize <= 0) {
+			break;
+		}
+
+		total += (size_t)retsize;
+	}
+
+	return total;
+}
+
+void reader_open_fd(int fd, reader_t *reader) {
+	memset(reader, 0, sizeof(reader_t));
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 0) {
+		ppelib_set_error("Unable to read file length");
+		return;
+	}
+
+	if (!st.st_size) {
+		ppelib_set_error("Empty file");
+		return;
+	}
+
+	if ((uint64_t)st.st_size > SIZE_MAX) {
+		ppelib_set_error("File too large");
+		return;
+	}
+
+	reader->read = fd_read;
+	reader->userdata = (void *)(intptr_t)fd;
+	reader->size = (size_t)st.st_size;
+}
+
+// Truncating the file we read from on demand would lose whatever we haven't read yet.
+uint8_t reader_is_same_file(const reader_t *reader, const char *filename) {
+	if (reader->read != fd_read) {
+		return 0;
+	}
+
+	struct stat st1;
+	struct stat st2;
+	if (fstat((int)(intptr_t)reader->userdata, &st1) != 0 || stat(filename, &st2) != 0) {
+		return 0;
+	}
+
+	return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+#endif
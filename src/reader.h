@@ -0,0 +1,40 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_READER_H_
+#define PPELIB_READER_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef size_t (*ppelib_read_func)(void *userdata, size_t offset, uint8_t *buffer, size_t size);
+
+// Where a file is parsed from. Contiguous sources set buffer, everything else
+// is read piecewise through read.
+typedef struct reader {
+	const uint8_t *buffer;
+	ppelib_read_func read;
+	void *userdata;
+	size_t size;
+} reader_t;
+
+uint8_t reader_read(const reader_t *reader, size_t offset, uint8_t *buffer, size_t size);
+
+void reader_open_fd(int fd, reader_t *reader);
+uint8_t reader_is_same_file(const reader_t *reader, const char *filename);
+
+#endif /* PPELIB_READER_H_ */
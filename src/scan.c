@@ -0,0 +1,288 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "scan.h"
+
+// Positions where the first two bytes of a marker match are found with vector
+// compares, those are then checked in full. The markers all start with different
+// bytes, so at most one of them can match at any position.
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PPELIB_SCAN_SSE2 1
+#elif defined __aarch64__ || defined _M_ARM64
+#include <arm_neon.h>
+#define PPELIB_SCAN_NEON 1
+#endif
+
+#if defined PPELIB_CPU_X86_TARGETS
+#include <immintrin.h>
+#define PPELIB_SCAN_AVX2 1
+#endif
+
+typedef struct scan_pattern {
+	uint32_t marker;
+	uint8_t size;
+	uint8_t bytes[4];
+} scan_pattern_t;
+
+// In enum scan_marker_index order
+static const scan_pattern_t patterns[SCAN_NUMBER_OF_MARKERS] = {
+	{ SCAN_MZ, 2, { 'M', 'Z', 0, 0 } },
+	{ SCAN_PE, 4, { 'P', 'E', 0, 0 } },
+	{ SCAN_RICH, 4, { 'R', 'i', 'c', 'h' } },
+	{ SCAN_VLV, 4, { 'V', 'L', 'V', 0 } },
+};
+
+typedef struct scan_set {
+	const scan_pattern_t *patterns[SCAN_NUMBER_OF_MARKERS];
+	uint8_t size;
+} scan_set_t;
+
+static void scan_set_init(scan_set_t *set, uint32_t markers) {
+	set->size = 0;
+	for (uint8_t i = 0; i < SCAN_NUMBER_OF_MARKERS; ++i) {
+		if (markers & patterns[i].marker) {
+			set->patterns[set->size++] = &patterns[i];
+		}
+	}
+}
+
+// The marker at offset, 0 if there is none
+static uint32_t scan_match(const scan_set_t *set, const uint8_t *buffer, size_t size, size_t offset) {
+	for (uint8_t i = 0; i < set->size; ++i) {
+		const scan_pattern_t *pattern = set->patterns[i];
+		if (pattern->size <= size - offset && memcmp(buffer + offset, pattern->bytes, pattern->size) == 0) {
+			return pattern->marker;
+		}
+	}
+
+	return 0;
+}
+
+// Checks every candidate in a bit mask of positions starting at offset
+static size_t scan_candidates(const scan_set_t *set, const uint8_t *buffer, size_t size, size_t offset,
+		uint32_t candidates, uint32_t *marker) {
+	while (candidates) {
+		uint32_t bit = 0;
+		while (!(candidates & ((uint32_t)1 << bit))) {
+			++bit;
+		}
+		candidates &= candidates - 1;
+
+		*marker = scan_match(set, buffer, size, offset + bit);
+		if (*marker) {
+			return offset + bit;
+		}
+	}
+
+	return size + 1;
+}
+
+#if defined PPELIB_SCAN_AVX2
+PPELIB_TARGET_AVX2 static size_t scan_avx2(const scan_set_t *set, const uint8_t *buffer, size_t size, size_t *start,
+		uint32_t *marker) {
+	__m256i first[SCAN_NUMBER_OF_MARKERS];
+	__m256i second[SCAN_NUMBER_OF_MARKERS];
+	for (uint8_t i = 0; i < set->size; ++i) {
+		first[i] = _mm256_set1_epi8((char)set->patterns[i]->bytes[0]);
+		second[i] = _mm256_set1_epi8((char)set->patterns[i]->bytes[1]);
+	}
+
+	size_t i = *start;
+	for (; size - i > 32; i += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)(buffer + i));
+		__m256i next = _mm256_loadu_si256((const __m256i *)(buffer + i + 1));
+
+		__m256i hits = _mm256_setzero_si256();
+		for (uint8_t j = 0; j < set->size; ++j) {
+			hits = _mm256_or_si256(hits,
+					_mm256_and_si256(_mm256_cmpeq_epi8(block, first[j]), _mm256_cmpeq_epi8(next, second[j])));
+		}
+
+		uint32_t candidates = (uint32_t)_mm256_movemask_epi8(hits);
+		if (candidates) {
+			size_t offset = scan_candidates(set, buffer, size, i, candidates, marker);
+			if (offset <= size) {
+				return offset;
+			}
+		}
+	}
+
+	*start = i;
+	return size + 1;
+}
+#endif
+
+// Vector blocks from start for as long as they fit, start is moved past them
+static size_t scan_blocks(const scan_set_t *set, const uint8_t *buffer, size_t size, size_t *start, uint32_t *marker) {
+#if defined PPELIB_SCAN_AVX2
+	if (size - *start > 256 && cpu_has_avx2()) {
+		size_t offset = scan_avx2(set, buffer, size, start, marker);
+		if (offset <= size) {
+			return offset;
+		}
+	}
+#endif
+
+	size_t i = *start;
+
+#if defined PPELIB_SCAN_SSE2
+	__m128i first[SCAN_NUMBER_OF_MARKERS];
+	__m128i second[SCAN_NUMBER_OF_MARKERS];
+	for (uint8_t j = 0; j < set->size; ++j) {
+		first[j] = _mm_set1_epi8((char)set->patterns[j]->bytes[0]);
+		second[j] = _mm_set1_epi8((char)set->patterns[j]->bytes[1]);
+	}
+
+	for (; size - i > 16; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(buffer + i));
+		__m128i next = _mm_loadu_si128((const __m128i *)(buffer + i + 1));
+
+		__m128i hits = _mm_setzero_si128();
+		for (uint8_t j = 0; j < set->size; ++j) {
+			hits = _mm_or_si128(hits, _mm_and_si128(_mm_cmpeq_epi8(block, first[j]), _mm_cmpeq_epi8(next, second[j])));
+		}
+
+		uint32_t candidates = (uint32_t)_mm_movemask_epi8(hits);
+		if (candidates) {
+			size_t offset = scan_candidates(set, buffer, size, i, candidates, marker);
+			if (offset <= size) {
+				return offset;
+			}
+		}
+	}
+#elif defined PPELIB_SCAN_NEON
+	uint8x16_t first[SCAN_NUMBER_OF_MARKERS];
+	uint8x16_t second[SCAN_NUMBER_OF_MARKERS];
+	for (uint8_t j = 0; j < set->size; ++j) {
+		first[j] = vdupq_n_u8(set->patterns[j]->bytes[0]);
+		second[j] = vdupq_n_u8(set->patterns[j]->bytes[1]);
+	}
+
+	for (; size - i > 16; i += 16) {
+		uint8x16_t block = vld1q_u8(buffer + i);
+		uint8x16_t next = vld1q_u8(buffer + i + 1);
+
+		uint8x16_t hits = vdupq_n_u8(0);
+		for (uint8_t j = 0; j < set->size; ++j) {
+			hits = vorrq_u8(hits, vandq_u8(vceqq_u8(block, first[j]), vceqq_u8(next, second[j])));
+		}
+
+		if (vmaxvq_u8(hits)) {
+			// No movemask on NEON, the rare blocks with candidates are checked bytewise
+			uint8_t lanes[16];
+			vst1q_u8(lanes, hits);
+
+			uint32_t candidates = 0;
+			for (uint32_t j = 0; j < 16; ++j) {
+				candidates |= (uint32_t)(lanes[j] & 1) << j;
+			}
+
+			size_t offset = scan_candidates(set, buffer, size, i, candidates, marker);
+			if (offset <= size) {
+				return offset;
+			}
+		}
+	}
+#endif
+
+	*start = i;
+	return size + 1;
+}
+
+size_t scan_next(const uint8_t *buffer, size_t size, size_t start, uint32_t markers, uint32_t *marker) {
+	scan_set_t set;
+	scan_set_init(&set, markers);
+	if (!set.size || start >= size) {
+		return size + 1;
+	}
+
+	size_t i = start;
+	size_t offset = scan_blocks(&set, buffer, size, &i, marker);
+	if (offset <= size) {
+		return offset;
+	}
+
+	for (; i < size; ++i) {
+		*marker = scan_match(&set, buffer, size, i);
+		if (*marker) {
+			return i;
+		}
+	}
+
+	return size + 1;
+}
+
+void scan_first(const uint8_t *buffer, size_t size, uint32_t markers, size_t offsets[SCAN_NUMBER_OF_MARKERS]) {
+	for (uint8_t i = 0; i < SCAN_NUMBER_OF_MARKERS; ++i) {
+		offsets[i] = size + 1;
+	}
+
+	size_t start = 0;
+	while (markers) {
+		uint32_t marker = 0;
+		size_t offset = scan_next(buffer, size, start, markers, &marker);
+		if (offset > size) {
+			break;
+		}
+
+		for (uint8_t i = 0; i < SCAN_NUMBER_OF_MARKERS; ++i) {
+			if (patterns[i].marker == marker) {
+				offsets[i] = offset;
+			}
+		}
+
+		markers &= ~marker;
+		start = offset + 1;
+	}
+}
+
+EXPORT_SYM size_t ppelib_scan_markers(const uint8_t *buffer, size_t size, uint32_t markers, scan_match_t *matches,
+		size_t capacity) {
+	ppelib_reset_error();
+
+	if (!buffer) {
+		return 0;
+	}
+
+	size_t number_of_matches = 0;
+	size_t start = 0;
+	for (;;) {
+		uint32_t marker = 0;
+		size_t offset = scan_next(buffer, size, start, markers, &marker);
+		if (offset > size) {
+			break;
+		}
+
+		if (number_of_matches < capacity) {
+			matches[number_of_matches].offset = offset;
+			matches[number_of_matches].marker = marker;
+		}
+
+		++number_of_matches;
+		start = offset + 1;
+	}
+
+	return number_of_matches;
+}
@@ -0,0 +1,53 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_SCAN_H_
+#define PPELIB_SCAN_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+enum scan_marker_index {
+	SCAN_MZ_INDEX,
+	SCAN_PE_INDEX,
+	SCAN_RICH_INDEX,
+	SCAN_VLV_INDEX,
+	SCAN_NUMBER_OF_MARKERS,
+};
+
+// Same values as enum ppelib_marker
+enum scan_marker {
+	SCAN_MZ = 1 << SCAN_MZ_INDEX,
+	SCAN_PE = 1 << SCAN_PE_INDEX,
+	SCAN_RICH = 1 << SCAN_RICH_INDEX,
+	SCAN_VLV = 1 << SCAN_VLV_INDEX,
+};
+
+// Same layout as ppelib_marker_match
+typedef struct scan_match {
+	size_t offset;
+	uint32_t marker;
+} scan_match_t;
+
+// Offset of the first of the markers at or after start, size + 1 if there is none.
+// marker is set to the one found.
+size_t scan_next(const uint8_t *buffer, size_t size, size_t start, uint32_t markers, uint32_t *marker);
+// The first offset of each of the markers in one pass over buffer, indexed by
+// enum scan_marker_index. Markers that aren't found get size + 1.
+void scan_first(const uint8_t *buffer, size_t size, uint32_t markers, size_t offsets[SCAN_NUMBER_OF_MARKERS]);
+
+#endif /* PPELIB_SCAN_H_ */
@@ -23,18 +23,19 @@
 #include "main.h"
 #include "platform.h"
 #include "ppe_error.h"
+#include "ppelib_internal.h"
 
 #include "generated/section_private.h"
 
 EXPORT_SYM const section_t *ppelib_section_get(ppelib_file_t *pe, uint16_t section_index) {
 	ppelib_reset_error();
 
-	if (section_index > pe->header.number_of_sections) {
+	if (section_index >= pe->header.number_of_sections) {
 		ppelib_set_error("Section index out of range");
 		return NULL;
 	}
 
-	return pe->sections[section_index];
+	return &pe->sections[section_index];
 }
 
 size_t section_rva_to_offset(const section_t *section, size_t rva) {
@@ -58,33 +59,121 @@ size_t section_rva_to_offset(const section_t *section, size_t rva) {
 void *section_rva_to_pointer(const section_t *section, size_t rva) {
 	size_t offset = section_rva_to_offset(section, rva);
 
-	return section->contents + offset;
+	uint8_t *contents = section_get_contents((section_t *)section);
+	if (!contents) {
+		return NULL;
+	}
+
+	return contents + offset;
 }
 
-section_t *section_find_by_virtual_address(ppelib_file_t *pe, size_t va) {
-	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		section_t *section = pe->sections[i];
-		size_t section_va_end = section->virtual_address + section->size_of_raw_data;
+// Files parsed lazily leave contents NULL (with a non-zero contents_size) until
+// something first needs them. Everything reading contents goes through here.
+uint8_t *section_get_contents(section_t *section) {
+	if (section->contents || !section->contents_size) {
+		return section->contents;
+	}
 
-		if (section->virtual_address <= va && section_va_end > va) {
-			return section;
+	ppelib_file_t *pe = section->pe;
+	if (!pe->borrowed && !pe->reader.read) {
+		ppelib_set_error("Section contents not available");
+		return NULL;
+	}
+
+	if (!pe->borrowed) {
+		uint8_t *contents = arena_alloc(&pe->arena, section->contents_size);
+		if (!contents) {
+			ppelib_set_error("Failed to allocate section data");
+			return NULL;
 		}
+
+		if (!reader_read(&pe->reader, section->source_offset, contents, section->contents_size)) {
+			return NULL;
+		}
+
+		section->contents = contents;
+		return section->contents;
+	}
+
+	if (section->source_offset + section->contents_size > pe->borrowed_size) {
+		ppelib_set_error("Section data outside of file");
+		return NULL;
 	}
 
-	return NULL;
+	section->contents = (uint8_t *)pe->borrowed + section->source_offset;
+	return section->contents;
 }
 
-section_t *section_find_by_physical_address(ppelib_file_t *pe, size_t address) {
-	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		section_t *section = pe->sections[i];
-		size_t section_va_end = section->pointer_to_raw_data + section->contents_size;
+// Section contents may point into the buffer the file was parsed from. Anything
+// that resizes or writes to them needs its own copy first.
+uint8_t section_make_owned(section_t *section) {
+	if (section->contents_size && !section_get_contents(section)) {
+		return 0;
+	}
+
+	return buffer_make_owned(section->pe, &section->contents, section->contents_size);
+}
+
+EXPORT_SYM const uint8_t *ppelib_section_get_contents(const section_t *section) {
+	ppelib_reset_error();
+
+	const uint8_t *contents = section_get_contents((section_t *)section);
+	context_take_error(section->pe->context);
+
+	return contents;
+}
+
+EXPORT_SYM size_t ppelib_section_get_contents_size(const section_t *section) {
+	ppelib_reset_error();
+
+	return section->contents_size;
+}
+
+// Make room for one more section. Everything pointing at a section is moved
+// along with the array.
+static uint8_t sections_grow(ppelib_file_t *pe) {
+	size_t number_of_sections = pe->header.number_of_sections;
+	if (number_of_sections < pe->sections_capacity) {
+		return 1;
+	}
+
+	if (number_of_sections == UINT16_MAX) {
+		ppelib_set_error("Too many sections");
+		return 0;
+	}
+
+	size_t capacity = MIN(MAX(pe->sections_capacity * 2, 8), UINT16_MAX);
+	section_t *old_sections = pe->sections;
+	section_t *sections;
 
-		if (section->pointer_to_raw_data <= address && section_va_end >= address) {
-			return section;
+	// Parsed sections live in the arena
+	if (buffer_is_borrowed(pe, old_sections)) {
+		sections = malloc(sizeof(section_t) * capacity);
+		if (sections && number_of_sections) {
+			memcpy(sections, old_sections, sizeof(section_t) * number_of_sections);
 		}
+	} else {
+		sections = realloc(old_sections, sizeof(section_t) * capacity);
+	}
+
+	if (!sections) {
+		ppelib_set_error("Couldn't allocate section");
+		return 0;
 	}
 
-	return NULL;
+	if (pe->entrypoint_section) {
+		pe->entrypoint_section = sections + (pe->entrypoint_section - old_sections);
+	}
+
+	for (uint32_t i = 0; i < pe->header.number_of_rva_and_sizes; ++i) {
+		if (pe->data_directories[i].section) {
+			pe->data_directories[i].section = sections + (pe->data_directories[i].section - old_sections);
+		}
+	}
+
+	pe->sections = sections;
+	pe->sections_capacity = capacity;
+	return 1;
 }
 
 uint16_t ppelib_section_create(ppelib_file_t *pe, char name[9], uint32_t virtual_size, uint32_t raw_size,
@@ -102,61 +191,56 @@ uint16_t ppelib_section_create(ppelib_file_t *pe, char name[9], uint32_t virtual
 		return 0;
 	}
 
-	void *old_ptr = pe->sections;
-	pe->sections = realloc(pe->sections, pe->header.number_of_sections + 1 * sizeof(void *));
-	if (!pe->sections) {
-		pe->sections = old_ptr;
-		ppelib_set_error("Couldn't allocate section");
-		return 0;
-	}
-
-	pe->sections[pe->header.number_of_sections] = calloc(sizeof(section_t), 1);
-	if (!pe->sections[pe->header.number_of_sections]) {
-		pe->sections = realloc(pe->sections, pe->header.number_of_sections);
-		ppelib_set_error("Couldn't allocate section");
-		return 0;
-	}
-
-	section_t *section = pe->sections[pe->header.number_of_sections];
+	uint8_t *contents = NULL;
 	if (raw_size) {
-		section->contents = malloc(raw_size);
-		if (!section->contents) {
-			free(section);
-			pe->sections = realloc(pe->sections, pe->header.number_of_sections);
+		contents = malloc(raw_size);
+		if (!contents) {
 			ppelib_set_error("Couldn't allocate section");
 			return 0;
 		}
 
 		if (data) {
-			memcpy(section->contents, data, raw_size);
+			memcpy(contents, data, raw_size);
+		} else {
+			memset(contents, 0, raw_size);
 		}
 	}
 
-	pe->header.number_of_sections++;
-	memcpy(section->name, name, 8);
-	section->name[8] = 0;
+	if (!sections_grow(pe)) {
+		free(contents);
+		return 0;
+	}
+
+	section_index_invalidate(pe);
+	uint16_t section_index = pe->header.number_of_sections++;
+	section_t *section = &pe->sections[section_index];
+	memset(section, 0, sizeof(section_t));
 
+	memcpy(section->name, name, name_size);
 	section->virtual_size = virtual_size;
 	section->size_of_raw_data = raw_size;
 	section->characteristics = characteristics;
+	section->contents = contents;
+	section->contents_size = raw_size;
 	section->pe = pe;
 
 	//ppelib_recalculate(pe);
 
 	pe->header.modified = 1;
 	section->modified = 1;
-	return pe->header.number_of_sections--;
+	section->contents_modified = 1;
+	return section_index;
 }
 
 void ppelib_section_excise(ppelib_file_t *pe, uint16_t section_index, size_t start, size_t end) {
 	ppelib_reset_error();
 
-	if (section_index > pe->header.number_of_sections) {
+	if (section_index >= pe->header.number_of_sections) {
 		ppelib_set_error("Section index out of range");
 		return;
 	}
 
-	section_t *section = pe->sections[section_index];
+	section_t *section = &pe->sections[section_index];
 
 	if (end > section->contents_size) {
 		ppelib_set_error("Can't delete past section end");
@@ -172,7 +256,12 @@ void ppelib_section_excise(ppelib_file_t *pe, uint16_t section_index, size_t sta
 		return;
 	}
 
-	uint16_t retval = buffer_excise(&pe->sections[section_index]->contents, section->contents_size, start, end);
+	if (!section_make_owned(section)) {
+		ppelib_set_error("Failed to allocate new section contents");
+		return;
+	}
+
+	uint16_t retval = buffer_excise(&section->contents, section->contents_size, start, end);
 	if (!retval) {
 		ppelib_set_error("Failed to allocate new section contents");
 		return;
@@ -180,13 +269,15 @@ void ppelib_section_excise(ppelib_file_t *pe, uint16_t section_index, size_t sta
 
 	section->contents_size -= (end - start);
 	section->modified = 1;
+	section_index_invalidate(pe);
+	section->contents_modified = 1;
 	//ppelib_recalculate(pe);
 }
 
 void ppelib_section_insert_capacity(ppelib_file_t *pe, uint16_t section_index, size_t size, size_t offset) {
 	ppelib_reset_error();
 
-	if (section_index > pe->header.number_of_sections) {
+	if (section_index >= pe->header.number_of_sections) {
 		ppelib_set_error("Section index out of range");
 		return;
 	}
@@ -196,7 +287,7 @@ void ppelib_section_insert_capacity(ppelib_file_t *pe, uint16_t section_index, s
 		return;
 	}
 
-	section_t *section = pe->sections[section_index];
+	section_t *section = &pe->sections[section_index];
 
 	if (section->contents_size + size > UINT32_MAX) {
 		ppelib_set_error("Section size out of range");
@@ -208,6 +299,11 @@ void ppelib_section_insert_capacity(ppelib_file_t *pe, uint16_t section_index, s
 		return;
 	}
 
+	if (!section_make_owned(section)) {
+		ppelib_set_error("Failed to allocate new section contents");
+		return;
+	}
+
 	uint8_t *oldptr = section->contents;
 	section->contents = realloc(section->contents, section->contents_size + size);
 	if (!section->contents) {
@@ -222,13 +318,15 @@ void ppelib_section_insert_capacity(ppelib_file_t *pe, uint16_t section_index, s
 
 	section->contents_size += size;
 	section->modified = 1;
+	section_index_invalidate(pe);
+	section->contents_modified = 1;
 	//ppelib_recalculate(pe);
 }
 
 void ppelib_section_resize(ppelib_file_t *pe, uint16_t section_index, size_t size) {
 	ppelib_reset_error();
 
-	if (section_index > pe->header.number_of_sections) {
+	if (section_index >= pe->header.number_of_sections) {
 		ppelib_set_error("Section index out of range");
 		return;
 	}
@@ -238,7 +336,7 @@ void ppelib_section_resize(ppelib_file_t *pe, uint16_t section_index, size_t siz
 		return;
 	}
 
-	section_t *section = pe->sections[section_index];
+	section_t *section = &pe->sections[section_index];
 
 	if (size == section->contents_size) {
 		return;
@@ -249,6 +347,11 @@ void ppelib_section_resize(ppelib_file_t *pe, uint16_t section_index, size_t siz
 		return;
 	}
 
+	if (!section_make_owned(section)) {
+		ppelib_set_error("Failed to allocate new section contents");
+		return;
+	}
+
 	uint8_t *oldptr = section->contents;
 	section->contents = realloc(section->contents, size);
 	if (!section->contents) {
@@ -259,6 +362,8 @@ void ppelib_section_resize(ppelib_file_t *pe, uint16_t section_index, size_t siz
 
 	section->contents_size = size;
 	section->modified = 1;
+	section_index_invalidate(pe);
+	section->contents_modified = 1;
 	//ppelib_recalculate(pe);
 }
 
@@ -266,7 +371,7 @@ uint16_t ppelib_section_find_index(ppelib_file_t *pe, section_t *section) {
 	ppelib_reset_error();
 
 	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
-		if (pe->sections[i] == section) {
+		if (&pe->sections[i] == section) {
 			return i;
 		}
 	}
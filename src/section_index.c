@@ -0,0 +1,222 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+
+#include "generated/section_private.h"
+
+// Section ranges may overlap in malformed files. Lookups return the first section
+// in table order that holds the address either way, like the linear scans did.
+// File ranges include their end address.
+
+static uint8_t interval_contains(const section_interval_t *interval, size_t address, uint8_t inclusive) {
+	if (address < interval->start) {
+		return 0;
+	}
+
+	return address < interval->end || (inclusive && address == interval->end);
+}
+
+static int interval_compare(const void *a, const void *b) {
+	const section_interval_t *ia = a;
+	const section_interval_t *ib = b;
+
+	if (ia->start != ib->start) {
+		return ia->start < ib->start ? -1 : 1;
+	}
+
+	return ia->section < ib->section ? -1 : ia->section > ib->section;
+}
+
+static void intervals_sort(section_intervals_t *intervals, size_t size, uint8_t inclusive) {
+	qsort(intervals->intervals, size, sizeof(section_interval_t), interval_compare);
+
+	intervals->overlaps = 0;
+	intervals->has_last_hit = 0;
+	for (size_t i = 0; i < size; ++i) {
+		section_interval_t *interval = &intervals->intervals[i];
+		interval->max_end = interval->end;
+
+		if (i) {
+			size_t previous_end = intervals->intervals[i - 1].max_end;
+			interval->max_end = MAX(interval->max_end, previous_end);
+
+			if (interval->start < previous_end || (inclusive && interval->start == previous_end)) {
+				intervals->overlaps = 1;
+			}
+		}
+	}
+}
+
+static uint8_t section_index_build(ppelib_file_t *pe) {
+	section_index_t *index = &pe->section_index;
+	if (index->valid) {
+		return 1;
+	}
+
+	const allocator_t *allocator = context_allocator(pe->context);
+	size_t size = pe->header.number_of_sections;
+	section_interval_t *by_va = allocator->malloc(allocator->userdata, sizeof(section_interval_t) * MAX(size, 1));
+	section_interval_t *by_offset = allocator->malloc(allocator->userdata, sizeof(section_interval_t) * MAX(size, 1));
+	if (!by_va || !by_offset) {
+		allocator->free(allocator->userdata, by_va);
+		allocator->free(allocator->userdata, by_offset);
+		return 0;
+	}
+
+	for (uint16_t i = 0; i < size; ++i) {
+		const section_t *section = &pe->sections[i];
+
+		by_va[i].start = section->virtual_address;
+		by_va[i].end = (size_t)section->virtual_address + section->size_of_raw_data;
+		by_va[i].section = i;
+
+		by_offset[i].start = section->pointer_to_raw_data;
+		by_offset[i].end = section->pointer_to_raw_data + section->contents_size;
+		by_offset[i].section = i;
+	}
+
+	index->by_va.intervals = by_va;
+	index->by_offset.intervals = by_offset;
+	intervals_sort(&index->by_va, size, 0);
+	intervals_sort(&index->by_offset, size, 1);
+
+	index->size = size;
+	index->valid = 1;
+	return 1;
+}
+
+void section_index_invalidate(ppelib_file_t *pe) {
+	section_index_t *index = &pe->section_index;
+	const allocator_t *allocator = context_allocator(pe->context);
+
+	allocator->free(allocator->userdata, index->by_va.intervals);
+	allocator->free(allocator->userdata, index->by_offset.intervals);
+
+	memset(index, 0, sizeof(section_index_t));
+}
+
+static section_t *intervals_find(ppelib_file_t *pe, section_intervals_t *intervals, size_t address, uint8_t inclusive) {
+	size_t size = pe->section_index.size;
+
+	if (!intervals->overlaps && intervals->has_last_hit) {
+		if (interval_contains(&intervals->intervals[intervals->last_hit], address, inclusive)) {
+			return &pe->sections[intervals->intervals[intervals->last_hit].section];
+		}
+	}
+
+	// Number of intervals starting at or before address
+	size_t low = 0;
+	size_t high = size;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (intervals->intervals[middle].start <= address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	// Walk back as long as an earlier interval may still reach address
+	size_t found = SIZE_MAX;
+	for (size_t i = low; i > 0; --i) {
+		const section_interval_t *interval = &intervals->intervals[i - 1];
+		if (interval->max_end < address || (!inclusive && interval->max_end == address)) {
+			break;
+		}
+
+		if (interval_contains(interval, address, inclusive)
+				&& (found == SIZE_MAX || interval->section < intervals->intervals[found].section)) {
+			found = i - 1;
+		}
+	}
+
+	if (found == SIZE_MAX) {
+		return NULL;
+	}
+
+	intervals->has_last_hit = 1;
+	intervals->last_hit = (uint16_t)found;
+	return &pe->sections[intervals->intervals[found].section];
+}
+
+section_t *section_find_by_virtual_address(ppelib_file_t *pe, size_t va) {
+	if (section_index_build(pe)) {
+		return intervals_find(pe, &pe->section_index.by_va, va, 0);
+	}
+
+	// Out of memory for the index, scan instead
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		size_t section_va_end = (size_t)section->virtual_address + section->size_of_raw_data;
+
+		if (section->virtual_address <= va && section_va_end > va) {
+			return section;
+		}
+	}
+
+	return NULL;
+}
+
+section_t *section_find_by_physical_address(ppelib_file_t *pe, size_t address) {
+	if (section_index_build(pe)) {
+		return intervals_find(pe, &pe->section_index.by_offset, address, 1);
+	}
+
+	for (uint16_t i = 0; i < pe->header.number_of_sections; ++i) {
+		section_t *section = &pe->sections[i];
+		size_t section_va_end = section->pointer_to_raw_data + section->contents_size;
+
+		if (section->pointer_to_raw_data <= address && section_va_end >= address) {
+			return section;
+		}
+	}
+
+	return NULL;
+}
+
+EXPORT_SYM size_t ppelib_translate_rvas(ppelib_file_t *pe, const uint32_t *rvas, size_t count,
+		rva_location_t *locations) {
+	ppelib_reset_error();
+
+	size_t found = 0;
+	for (size_t i = 0; i < count; ++i) {
+		rva_location_t *location = &locations[i];
+		const section_t *section = section_find_by_virtual_address(pe, rvas[i]);
+
+		location->section = section;
+		if (!section) {
+			location->offset = 0;
+			location->file_offset = 0;
+			continue;
+		}
+
+		location->offset = rvas[i] - section->virtual_address;
+		location->file_offset = section->pointer_to_raw_data + location->offset;
+		++found;
+	}
+
+	return found;
+}
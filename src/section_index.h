@@ -0,0 +1,50 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_SECTION_INDEX_H_
+#define PPELIB_SECTION_INDEX_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef struct section_interval {
+	size_t start;
+	size_t end;
+	// Largest end of this and every interval sorted before it
+	size_t max_end;
+	uint16_t section;
+} section_interval_t;
+
+typedef struct section_intervals {
+	// Sorted by start, then by section index
+	section_interval_t *intervals;
+	// Without overlaps the last hit can be returned without searching
+	uint8_t overlaps;
+	uint8_t has_last_hit;
+	uint16_t last_hit;
+} section_intervals_t;
+
+// Sections sorted by virtual and by file address for section_find_by_*(). Built
+// on the first lookup and thrown away by anything that moves or resizes a section.
+typedef struct section_index {
+	uint8_t valid;
+	size_t size;
+	section_intervals_t by_va;
+	section_intervals_t by_offset;
+} section_index_t;
+
+#endif /* PPELIB_SECTION_INDEX_H_ */
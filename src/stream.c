@@ -0,0 +1,285 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-constants.h>
+
+#include "main.h"
+#include "platform.h"
+#include "ppe_error.h"
+#include "ppelib_internal.h"
+
+#include "generated/dos_header_private.h"
+#include "generated/header_private.h"
+#include "generated/section_private.h"
+
+// Push parser for files that arrive in pieces. Only the headers are buffered,
+// each state knows how many bytes it needs before it can move on. Once the
+// section table is in, the headers are handed to create_from_reader() and
+// anything fed after that is only counted.
+
+enum stream_state {
+	STREAM_MZ_SIGNATURE = 0,
+	STREAM_DOS_HEADER = 1,
+	STREAM_PE_HEADER = 2,
+	STREAM_SECTION_TABLE = 3,
+	STREAM_DONE = 4,
+	STREAM_ERROR = 5,
+};
+
+typedef struct stream {
+	enum stream_state state;
+
+	uint8_t *buffer;
+	size_t size;
+	size_t needed;
+	size_t total_size;
+	uint8_t finished;
+
+	size_t pe_header_offset;
+	ppelib_file_t *pe;
+} stream_t;
+
+EXPORT_SYM stream_t *ppelib_stream_create() {
+	ppelib_reset_error();
+
+	stream_t *stream = calloc(sizeof(stream_t), 1);
+	if (!stream) {
+		ppelib_set_error("Failed to allocate stream");
+		return NULL;
+	}
+
+	stream->state = STREAM_MZ_SIGNATURE;
+	stream->needed = 2;
+
+	return stream;
+}
+
+EXPORT_SYM void ppelib_stream_destroy(stream_t *stream) {
+	if (!stream) {
+		return;
+	}
+
+	free(stream->buffer);
+	ppelib_destroy(stream->pe);
+	free(stream);
+}
+
+static void stream_fail(stream_t *stream) {
+	stream->state = STREAM_ERROR;
+
+	free(stream->buffer);
+	stream->buffer = NULL;
+	stream->size = 0;
+}
+
+static void stream_finish_headers(stream_t *stream) {
+	reader_t reader;
+	memset(&reader, 0, sizeof(reader_t));
+	reader.buffer = stream->buffer;
+	reader.size = stream->size;
+
+	stream->pe = create_from_reader(NULL, &reader, PARSE_HEADERS);
+	if (!stream->pe) {
+		stream_fail(stream);
+		return;
+	}
+
+	stream->state = STREAM_DONE;
+
+	free(stream->buffer);
+	stream->buffer = NULL;
+	stream->size = 0;
+}
+
+// Move on as far as the buffered bytes allow
+static void stream_advance(stream_t *stream) {
+	while (stream->state < STREAM_DONE) {
+		if (stream->finished) {
+			stream->needed = MIN(stream->needed, stream->size);
+		}
+
+		if (stream->size < stream->needed) {
+			break;
+		}
+
+		switch (stream->state) {
+		case STREAM_MZ_SIGNATURE:
+			if (read_uint16_t(stream->buffer) != MZ_SIGNATURE) {
+				ppelib_set_error("Not a PE file (MZ signature missing)");
+				stream_fail(stream);
+				return;
+			}
+
+			stream->state = STREAM_DOS_HEADER;
+			stream->needed = 2 + DOS_HEADER_SIZE;
+			break;
+
+		case STREAM_DOS_HEADER: {
+			dos_header_t dos_header;
+			ppelib_dos_header_deserialize(stream->buffer, stream->size, 2, &dos_header);
+			if (ppelib_error_peek()) {
+				stream_fail(stream);
+				return;
+			}
+
+			// The DOS stub, PE signature and everything up to the data directories
+			stream->pe_header_offset = dos_header.pe_header_offset;
+			stream->state = STREAM_PE_HEADER;
+			stream->needed = stream->pe_header_offset + 4 + COFF_HEADER_SIZE + PEPLUS_OPTIONAL_HEADER_SIZE;
+			break;
+		}
+
+		case STREAM_PE_HEADER: {
+			if (stream->size < stream->pe_header_offset + sizeof(uint32_t)) {
+				ppelib_set_error("Not a PE file (file too small)");
+				stream_fail(stream);
+				return;
+			}
+
+			if (read_uint32_t(stream->buffer + stream->pe_header_offset) != PE_SIGNATURE) {
+				ppelib_set_error("Not a PE file (PE00 signature missing)");
+				stream_fail(stream);
+				return;
+			}
+
+			size_t header_offset = stream->pe_header_offset + 4;
+
+			header_t header;
+			size_t header_size = ppelib_header_deserialize(stream->buffer, stream->size, header_offset, &header);
+			if (ppelib_error_peek()) {
+				stream_fail(stream);
+				return;
+			}
+
+			// The parser never looks at more than 16 directories if the file is too small to hold them all
+			size_t data_directories_size = MIN(header.number_of_rva_and_sizes, 16) * DATA_DIRECTORY_SIZE;
+			size_t section_offset = header_offset + COFF_HEADER_SIZE + header.size_of_optional_header;
+
+			stream->state = STREAM_SECTION_TABLE;
+			stream->needed = MAX(header_offset + header_size + data_directories_size,
+					section_offset + (size_t)header.number_of_sections * SECTION_SIZE);
+			break;
+		}
+
+		case STREAM_SECTION_TABLE:
+			stream_finish_headers(stream);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+EXPORT_SYM enum stream_state ppelib_stream_feed(stream_t *stream, const uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	if (!buffer && size) {
+		ppelib_set_error("Can't read data from a NULL pointer");
+		return stream->state;
+	}
+
+	stream->total_size += size;
+
+	while (size && stream->state < STREAM_DONE) {
+		size_t wanted = MIN(size, stream->needed - stream->size);
+
+		uint8_t *oldptr = stream->buffer;
+		stream->buffer = realloc(stream->buffer, stream->size + wanted);
+		if (!stream->buffer) {
+			stream->buffer = oldptr;
+			ppelib_set_error("Failed to allocate stream buffer");
+			stream_fail(stream);
+			break;
+		}
+
+		memcpy(stream->buffer + stream->size, buffer, wanted);
+		stream->size += wanted;
+		buffer += wanted;
+		size -= wanted;
+
+		stream_advance(stream);
+	}
+
+	return stream->state;
+}
+
+// Files smaller than a page get parsed as if they were padded with zeroes, so
+// headers that run past the end of the data are still fine once we know there
+// is nothing else coming.
+EXPORT_SYM enum stream_state ppelib_stream_finish(stream_t *stream) {
+	ppelib_reset_error();
+
+	if (stream->state >= STREAM_DONE) {
+		return stream->state;
+	}
+
+	if (stream->total_size < 2 || stream->total_size >= 0x1000) {
+		ppelib_set_error("Not a PE file (file too small)");
+		stream_fail(stream);
+		return stream->state;
+	}
+
+	size_t size = stream->size;
+
+	uint8_t *oldptr = stream->buffer;
+	stream->buffer = realloc(stream->buffer, 0x1000);
+	if (!stream->buffer) {
+		stream->buffer = oldptr;
+		ppelib_set_error("Failed to allocate stream buffer");
+		stream_fail(stream);
+		return stream->state;
+	}
+
+	memset(stream->buffer + size, 0, 0x1000 - size);
+	stream->size = 0x1000;
+	stream->finished = 1;
+
+	stream_advance(stream);
+	if (stream->state < STREAM_DONE) {
+		ppelib_set_error("Not a PE file (file too small)");
+		stream_fail(stream);
+	}
+
+	return stream->state;
+}
+
+EXPORT_SYM size_t ppelib_stream_get_needed(const stream_t *stream) {
+	ppelib_reset_error();
+
+	if (stream->state >= STREAM_DONE) {
+		return 0;
+	}
+
+	return stream->needed - stream->size;
+}
+
+EXPORT_SYM ppelib_file_t *ppelib_stream_get_handle(stream_t *stream) {
+	ppelib_reset_error();
+
+	if (stream->state != STREAM_DONE) {
+		ppelib_set_error("Headers not complete");
+		return NULL;
+	}
+
+	return stream->pe;
+}
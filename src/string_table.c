@@ -30,7 +30,7 @@
 #include "ppelib_internal.h"
 
 const char *string_table_get(string_table_t *string_table, size_t offset) {
-	if (offset > string_table->highest_offset) {
+	if (offset < 4 || offset > string_table->highest_offset) {
 		ppelib_set_error("Offset out of range");
 		return NULL;
 	}
@@ -38,24 +38,111 @@ const char *string_table_get(string_table_t *string_table, size_t offset) {
 	return string_table->strings + offset;
 }
 
-void string_table_free(string_table_t *string_table) {
-	if (!string_table) {
-		return;
+// Section names that don't fit in 8 bytes are stored as "/" followed by the
+// decimal offset of the real name, or "//" and the offset in base64 when it
+// doesn't fit in 7 decimal digits.
+const char *string_table_resolve_name(string_table_t *string_table, const char *name, uint32_t *offset) {
+	static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	if (name[0] != '/') {
+		return NULL;
+	}
+
+	uint64_t value = 0;
+	if (name[1] == '/') {
+		for (const char *c = name + 2; *c; ++c) {
+			const char *digit = strchr(base64, *c);
+			if (!digit || value > UINT32_MAX) {
+				return NULL;
+			}
+			value = value * 64 + (uint64_t)(digit - base64);
+		}
+	} else {
+		for (const char *c = name + 1; *c; ++c) {
+			if (*c < '0' || *c > '9' || value > UINT32_MAX) {
+				return NULL;
+			}
+			value = value * 10 + (uint64_t)(*c - '0');
+		}
+	}
+
+	if (value > UINT32_MAX) {
+		return NULL;
+	}
+
+	if (offset) {
+		*offset = (uint32_t)value;
 	}
 
-	free(string_table->strings);
+	return string_table_get(string_table, (size_t)value);
 }
 
-void parse_string_table(const uint8_t *buffer, size_t size, size_t offset, string_table_t *string_table) {
+static uint8_t string_table_index(string_table_t *string_table, arena_t *arena) {
+	if (string_table->index) {
+		return 1;
+	}
+
+	size_t capacity = hash_index_capacity(string_table->numb_strings);
+
+	string_table_slot_t *index = arena_calloc(arena, sizeof(string_table_slot_t) * capacity);
+	if (!index) {
+		ppelib_set_error("Failed to allocate string table index");
+		return 0;
+	}
+
+	// Repeated strings keep their first offset
+	size_t offset = 4;
+	while (offset <= string_table->highest_offset) {
+		const char *string = string_table->strings + offset;
+		uint32_t hash = fnv1a_string(FNV_OFFSET_BASIS, string);
+
+		size_t slot = hash_index_first(hash, capacity);
+		while (index[slot].offset) {
+			slot = hash_index_next(slot, capacity);
+		}
+
+		index[slot].hash = hash;
+		index[slot].offset = (uint32_t)offset;
+
+		offset += strlen(string) + 1;
+	}
+
+	string_table->index = index;
+	string_table->index_capacity = capacity;
+	return 1;
+}
+
+// Offset of name in the string table, 0 if it isn't there
+size_t string_table_find(string_table_t *string_table, arena_t *arena, const char *name) {
+	if (!string_table->numb_strings || !string_table_index(string_table, arena)) {
+		return 0;
+	}
+
+	uint32_t hash = fnv1a_string(FNV_OFFSET_BASIS, name);
+	size_t capacity = string_table->index_capacity;
+
+	for (size_t slot = hash_index_first(hash, capacity); string_table->index[slot].offset;
+			slot = hash_index_next(slot, capacity)) {
+		const string_table_slot_t *index_slot = &string_table->index[slot];
+		if (index_slot->hash == hash && strcmp(string_table->strings + index_slot->offset, name) == 0) {
+			return index_slot->offset;
+		}
+	}
+
+	return 0;
+}
+
+// When copy isn't set the table keeps pointing into buffer, which then has to
+// live as long as the handle.
+void parse_string_table(const uint8_t *buffer, size_t size, size_t offset, string_table_t *string_table, arena_t *arena,
+		uint8_t copy) {
+	memset(string_table, 0, sizeof(string_table_t));
+
 	if (offset >= size) {
 		ppelib_set_error("String table offset past size");
 		return;
 	}
 
-	string_table->size = 0;
-	string_table->numb_strings = 0;
-	string_table->highest_offset = 0;
-
 	if (offset + 4 > size) {
 		ppelib_set_error("Failed to read string table\n");
 		return;
@@ -71,23 +158,40 @@ void parse_string_table(const uint8_t *buffer, size_t size, size_t offset, strin
 		return;
 	}
 
-	const uint8_t *strings = buffer + offset + 4;
-	string_table->size = string_table_size - 4;
-
-	string_table->strings = malloc(string_table->size);
-	if (!string_table->strings) {
-		ppelib_set_error("Failed to allocate string table\n");
+	// Offsets are 32 bit and 0 marks empty index slots
+	if (string_table_size > UINT32_MAX) {
+		ppelib_set_error("String table too large\n");
 		return;
 	}
 
-	size_t last_found = 0;
-	for (size_t i = 0; i < string_table->size; ++i) {
-		if (strings[i] == '0') {
-			++string_table->numb_strings;
-			string_table->highest_offset = last_found;
-			last_found = i + 1;
+	const char *strings = (const char *)buffer + offset;
+	if (copy) {
+		char *strings_copy = arena_alloc(arena, string_table_size);
+		if (!strings_copy) {
+			ppelib_set_error("Failed to allocate string table\n");
+			return;
+		}
+
+		memcpy(strings_copy, strings, string_table_size);
+		strings = strings_copy;
+	}
+
+	size_t numb_strings = 0;
+	size_t highest_offset = 0;
+	for (size_t i = 4; i < string_table_size; ++i) {
+		if (!strings[i]) {
+			++numb_strings;
+			highest_offset = i;
 		}
 	}
 
-	memcpy(string_table->strings, buffer + offset, string_table->size);
+	// Nothing is terminated
+	if (!numb_strings) {
+		return;
+	}
+
+	string_table->size = string_table_size;
+	string_table->numb_strings = numb_strings;
+	string_table->highest_offset = highest_offset;
+	string_table->strings = strings;
 }
@@ -21,12 +21,25 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+typedef struct string_table_slot {
+	uint32_t hash;
+	// 0 marks an empty slot, strings never start at offset 0
+	uint32_t offset;
+} string_table_slot_t;
+
+// Offsets count from the start of the table, including its 4 byte size field
 typedef struct string_table {
 	size_t size;
 	size_t numb_strings;
+	// Every string starting at or before this offset is terminated inside the table
 	size_t highest_offset;
 
-	char *strings;
+	// Points into the file when that outlives the handle, see parse_string_table()
+	const char *strings;
+
+	// Built on the first string_table_find()
+	string_table_slot_t *index;
+	size_t index_capacity;
 } string_table_t;
 
 #endif /* PPELIB_STRING_TABLE_PRIVATE_H_ */
@@ -0,0 +1,117 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "threads.h"
+
+typedef struct thread_start {
+	thread_func func;
+	void *job;
+} thread_start_t;
+
+#if defined _WIN32
+typedef HANDLE thread_t;
+
+static DWORD WINAPI thread_main(LPVOID userdata) {
+	thread_start_t *start = userdata;
+	start->func(start->job);
+	return 0;
+}
+
+static uint8_t thread_create(thread_t *thread, thread_start_t *start) {
+	*thread = CreateThread(NULL, 0, thread_main, start, 0, NULL);
+	return *thread != NULL;
+}
+
+static void thread_join(thread_t thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+#else
+typedef pthread_t thread_t;
+
+static void *thread_main(void *userdata) {
+	thread_start_t *start = userdata;
+	start->func(start->job);
+	return NULL;
+}
+
+static uint8_t thread_create(thread_t *thread, thread_start_t *start) {
+	return pthread_create(thread, NULL, thread_main, start) == 0;
+}
+
+static void thread_join(thread_t thread) {
+	pthread_join(thread, NULL);
+}
+#endif
+
+void threads_run(const allocator_t *allocator, thread_func func, void *jobs, size_t job_size,
+		uint32_t number_of_jobs) {
+	if (!number_of_jobs) {
+		return;
+	}
+
+	thread_t *threads = NULL;
+	thread_start_t *starts = NULL;
+	uint8_t *started = NULL;
+	if (number_of_jobs > 1) {
+		threads = allocator->malloc(allocator->userdata, sizeof(thread_t) * number_of_jobs);
+		starts = allocator->malloc(allocator->userdata, sizeof(thread_start_t) * number_of_jobs);
+		started = allocator->malloc(allocator->userdata, number_of_jobs);
+		if (started) {
+			memset(started, 0, number_of_jobs);
+		}
+	}
+
+	// Without room to keep track of threads everything runs here
+	if (threads && starts && started) {
+		for (uint32_t i = 1; i < number_of_jobs; ++i) {
+			starts[i].func = func;
+			starts[i].job = (uint8_t *)jobs + job_size * i;
+			started[i] = thread_create(&threads[i], &starts[i]);
+		}
+	}
+
+	func(jobs);
+
+	for (uint32_t i = 1; i < number_of_jobs; ++i) {
+		if (started && started[i]) {
+			thread_join(threads[i]);
+		} else {
+			func((uint8_t *)jobs + job_size * i);
+		}
+	}
+
+	if (threads) {
+		allocator->free(allocator->userdata, threads);
+	}
+	if (starts) {
+		allocator->free(allocator->userdata, starts);
+	}
+	if (started) {
+		allocator->free(allocator->userdata, started);
+	}
+}
@@ -0,0 +1,35 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_THREADS_H_
+#define PPELIB_THREADS_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "context.h"
+
+typedef void (*thread_func)(void *job);
+
+// Runs func once for each of number_of_jobs jobs of job_size bytes, each on its own
+// thread, and waits for all of them. The calling thread runs the first job, and any
+// job a thread couldn't be started for. Threads are started for this call only, the
+// bookkeeping for them is allocated through allocator.
+void threads_run(const allocator_t *allocator, thread_func func, void *jobs, size_t job_size,
+		uint32_t number_of_jobs);
+
+#endif /* PPELIB_THREADS_H_ */
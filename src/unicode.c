@@ -0,0 +1,381 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "ppe_error.h"
+#include "unicode.h"
+#include "utils.h"
+
+// Names are mostly ASCII. Whole blocks of it are converted with vector
+// instructions, everything else one code point at a time.
+#if defined PPELIB_LITTLE_ENDIAN && (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PPELIB_UNICODE_SSE2 1
+#elif defined PPELIB_LITTLE_ENDIAN && (defined __aarch64__ || defined _M_ARM64)
+#include <arm_neon.h>
+#define PPELIB_UNICODE_NEON 1
+#endif
+
+// Converts blocks of 8 code units for as long as they are all ASCII, buffer may be
+// NULL to only count them. Returns the number of code units converted.
+static size_t utf16_ascii_blocks(const uint8_t *string, size_t length, uint8_t *buffer) {
+	size_t i = 0;
+
+#if defined PPELIB_UNICODE_SSE2
+	const __m128i high = _mm_set1_epi16((short)0xFF80);
+	for (; length - i >= 8; i += 8) {
+		__m128i units = _mm_loadu_si128((const __m128i *)(string + i * 2));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, high), _mm_setzero_si128())) != 0xFFFF) {
+			break;
+		}
+
+		if (buffer) {
+			_mm_storel_epi64((__m128i *)(buffer + i), _mm_packus_epi16(units, units));
+		}
+	}
+#elif defined PPELIB_UNICODE_NEON
+	for (; length - i >= 8; i += 8) {
+		uint16x8_t units = vreinterpretq_u16_u8(vld1q_u8(string + i * 2));
+		if (vmaxvq_u16(units) >= 0x80) {
+			break;
+		}
+
+		if (buffer) {
+			vst1_u8(buffer + i, vmovn_u16(units));
+		}
+	}
+#else
+	(void)string;
+	(void)length;
+	(void)buffer;
+#endif
+
+	return i;
+}
+
+// Converts blocks of 16 bytes for as long as they are all ASCII, buffer may be NULL
+// to only count them. Returns the number of bytes converted.
+static size_t utf8_ascii_blocks(const uint8_t *string, size_t length, uint8_t *buffer) {
+	size_t i = 0;
+
+#if defined PPELIB_UNICODE_SSE2
+	for (; length - i >= 16; i += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(string + i));
+		if (_mm_movemask_epi8(bytes)) {
+			break;
+		}
+
+		if (buffer) {
+			_mm_storeu_si128((__m128i *)(buffer + i * 2), _mm_unpacklo_epi8(bytes, _mm_setzero_si128()));
+			_mm_storeu_si128((__m128i *)(buffer + i * 2 + 16), _mm_unpackhi_epi8(bytes, _mm_setzero_si128()));
+		}
+	}
+#elif defined PPELIB_UNICODE_NEON
+	for (; length - i >= 16; i += 16) {
+		uint8x16_t bytes = vld1q_u8(string + i);
+		if (vmaxvq_u8(bytes) >= 0x80) {
+			break;
+		}
+
+		if (buffer) {
+			vst1q_u8(buffer + i * 2, vreinterpretq_u8_u16(vmovl_u8(vget_low_u8(bytes))));
+			vst1q_u8(buffer + i * 2 + 16, vreinterpretq_u8_u16(vmovl_u8(vget_high_u8(bytes))));
+		}
+	}
+#else
+	(void)string;
+	(void)length;
+	(void)buffer;
+#endif
+
+	return i;
+}
+
+uint32_t utf8_next(const uint8_t **string) {
+	const uint8_t *s = *string;
+	uint32_t code_point = 0xFFFD;
+	size_t length = 1;
+
+	if (s[0] < 0x80) {
+		code_point = s[0];
+	} else if ((s[0] & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80) {
+		code_point = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+		length = 2;
+	} else if ((s[0] & 0xF0) == 0xE0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+		code_point = ((uint32_t)(s[0] & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+		length = 3;
+	} else if ((s[0] & 0xF8) == 0xF0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) {
+		code_point = ((uint32_t)(s[0] & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) | ((uint32_t)(s[2] & 0x3F) << 6)
+				| (s[3] & 0x3F);
+		length = 4;
+		if (code_point > 0x10FFFF) {
+			code_point = 0xFFFD;
+		}
+	}
+
+	*string = s + length;
+	return code_point;
+}
+
+uint32_t utf16_next(const uint8_t *string, size_t length, size_t *position) {
+	uint32_t code_point = read_uint16_t(string + *position * 2);
+	++*position;
+
+	if (code_point >= 0xD800 && code_point < 0xDC00 && *position < length) {
+		uint32_t low = read_uint16_t(string + *position * 2);
+		if (low >= 0xDC00 && low < 0xE000) {
+			++*position;
+			return 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+		}
+	}
+
+	return code_point;
+}
+
+size_t utf8_encode(uint32_t code_point, char *buffer) {
+	uint8_t *b = (uint8_t *)buffer;
+
+	if (code_point < 0x80) {
+		b[0] = (uint8_t)code_point;
+		return 1;
+	}
+
+	if (code_point < 0x800) {
+		b[0] = (uint8_t)(0xC0 | (code_point >> 6));
+		b[1] = (uint8_t)(0x80 | (code_point & 0x3F));
+		return 2;
+	}
+
+	if (code_point < 0x10000) {
+		b[0] = (uint8_t)(0xE0 | (code_point >> 12));
+		b[1] = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+		b[2] = (uint8_t)(0x80 | (code_point & 0x3F));
+		return 3;
+	}
+
+	b[0] = (uint8_t)(0xF0 | (code_point >> 18));
+	b[1] = (uint8_t)(0x80 | ((code_point >> 12) & 0x3F));
+	b[2] = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+	b[3] = (uint8_t)(0x80 | (code_point & 0x3F));
+	return 4;
+}
+
+size_t utf8_utf16_length(const char *string) {
+	const uint8_t *s = (const uint8_t *)string;
+	size_t size = strlen(string);
+	const uint8_t *end = s + size;
+	size_t length = 0;
+
+	while (s < end) {
+		size_t ascii = utf8_ascii_blocks(s, (size_t)(end - s), NULL);
+		s += ascii;
+		length += ascii;
+
+		if (s < end) {
+			length += utf8_next(&s) > 0xFFFF ? 2 : 1;
+		}
+	}
+
+	return length;
+}
+
+size_t utf8_to_utf16(const char *string, uint8_t *buffer) {
+	const uint8_t *s = (const uint8_t *)string;
+	size_t size = strlen(string);
+	const uint8_t *end = s + size;
+	size_t length = 0;
+
+	while (s < end) {
+		size_t ascii = utf8_ascii_blocks(s, (size_t)(end - s), buffer + length * 2);
+		s += ascii;
+		length += ascii;
+
+		if (s >= end) {
+			break;
+		}
+
+		uint32_t code_point = utf8_next(&s);
+		if (code_point > 0xFFFF) {
+			code_point -= 0x10000;
+			write_uint16_t(buffer + length++ * 2, (uint16_t)(0xD800 + (code_point >> 10)));
+			code_point = 0xDC00 + (code_point & 0x3FF);
+		}
+
+		write_uint16_t(buffer + length++ * 2, (uint16_t)code_point);
+	}
+
+	return length;
+}
+
+static uint32_t utf16_next_scalar(const uint8_t *string, size_t length, size_t *position) {
+	uint32_t code_point = utf16_next(string, length, position);
+	if (code_point >= 0xD800 && code_point < 0xE000) {
+		return 0xFFFD;
+	}
+
+	return code_point;
+}
+
+size_t utf16_utf8_length(const uint8_t *string, size_t length) {
+	size_t position = 0;
+	size_t size = 0;
+
+	while (position < length) {
+		size_t ascii = utf16_ascii_blocks(string + position * 2, length - position, NULL);
+		position += ascii;
+		size += ascii;
+
+		if (position < length) {
+			uint32_t code_point = utf16_next_scalar(string, length, &position);
+			size += code_point < 0x80 ? 1 : code_point < 0x800 ? 2 : code_point < 0x10000 ? 3 : 4;
+		}
+	}
+
+	return size;
+}
+
+size_t utf16_to_utf8(const uint8_t *string, size_t length, char *buffer) {
+	size_t position = 0;
+	size_t size = 0;
+
+	while (position < length) {
+		size_t ascii = utf16_ascii_blocks(string + position * 2, length - position, (uint8_t *)buffer + size);
+		position += ascii;
+		size += ascii;
+
+		if (position < length) {
+			size += utf8_encode(utf16_next_scalar(string, length, &position), buffer + size);
+		}
+	}
+
+	return size;
+}
+
+void utf8_batch_reset(utf8_batch_t *batch) {
+	batch->size = 0;
+	batch->number_of_strings = 0;
+}
+
+// Reserves the worst case so every string is converted in a single pass
+uint8_t utf8_batch_add(utf8_batch_t *batch, const uint8_t *string, size_t length) {
+	if (batch->number_of_strings == batch->offsets_capacity) {
+		size_t capacity = MAX(batch->offsets_capacity * 2, 16);
+		size_t *offsets = realloc(batch->offsets, sizeof(size_t) * capacity);
+		if (!offsets) {
+			ppelib_set_error("Failed to allocate string batch");
+			return 0;
+		}
+
+		batch->offsets = offsets;
+		batch->offsets_capacity = capacity;
+	}
+
+	if (!string) {
+		batch->offsets[batch->number_of_strings++] = SIZE_MAX;
+		return 1;
+	}
+
+	size_t needed = length * 3 + 1;
+	if (batch->capacity - batch->size < needed) {
+		size_t capacity = MAX(batch->capacity * 2, MAX(batch->size + needed, 1024));
+		char *buffer = realloc(batch->buffer, capacity);
+		if (!buffer) {
+			ppelib_set_error("Failed to allocate string batch");
+			return 0;
+		}
+
+		batch->buffer = buffer;
+		batch->capacity = capacity;
+	}
+
+	batch->offsets[batch->number_of_strings++] = batch->size;
+	batch->size += utf16_to_utf8(string, length, batch->buffer + batch->size);
+	batch->buffer[batch->size++] = 0;
+
+	return 1;
+}
+
+EXPORT_SYM size_t ppelib_utf16_to_utf8(const uint8_t *string, size_t length, char *buffer, size_t size) {
+	ppelib_reset_error();
+
+	size_t needed = utf16_utf8_length(string, length);
+	if (buffer && needed < size) {
+		utf16_to_utf8(string, length, buffer);
+		buffer[needed] = 0;
+	}
+
+	return needed;
+}
+
+EXPORT_SYM size_t ppelib_utf8_to_utf16(const char *string, uint8_t *buffer, size_t size) {
+	ppelib_reset_error();
+
+	size_t needed = utf8_utf16_length(string);
+	if (buffer && needed <= size / 2) {
+		utf8_to_utf16(string, buffer);
+	}
+
+	return needed;
+}
+
+EXPORT_SYM utf8_batch_t *ppelib_utf8_batch_create() {
+	ppelib_reset_error();
+
+	utf8_batch_t *batch = calloc(1, sizeof(utf8_batch_t));
+	if (!batch) {
+		ppelib_set_error("Failed to allocate string batch");
+	}
+
+	return batch;
+}
+
+EXPORT_SYM void ppelib_utf8_batch_destroy(utf8_batch_t *batch) {
+	if (!batch) {
+		return;
+	}
+
+	free(batch->buffer);
+	free(batch->offsets);
+	free(batch);
+}
+
+EXPORT_SYM size_t ppelib_utf8_batch_get_size(const utf8_batch_t *batch) {
+	ppelib_reset_error();
+
+	return batch->number_of_strings;
+}
+
+EXPORT_SYM const char *ppelib_utf8_batch_get(const utf8_batch_t *batch, size_t string_index) {
+	ppelib_reset_error();
+
+	if (string_index >= batch->number_of_strings) {
+		ppelib_set_error("String index out of range");
+		return NULL;
+	}
+
+	if (batch->offsets[string_index] == SIZE_MAX) {
+		return NULL;
+	}
+
+	return batch->buffer + batch->offsets[string_index];
+}
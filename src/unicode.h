@@ -0,0 +1,69 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PPELIB_UNICODE_H_
+#define PPELIB_UNICODE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Decodes one code point of a NULL terminated UTF-8 string, invalid sequences come
+// out as U+FFFD
+uint32_t utf8_next(const uint8_t **string);
+// Decodes one code point of length UTF-16LE code units, unpaired surrogates come out
+// as they are
+uint32_t utf16_next(const uint8_t *string, size_t length, size_t *position);
+
+// Writes code_point as UTF-8 into buffer, which has room for 4 bytes. Returns the
+// number of bytes written.
+size_t utf8_encode(uint32_t code_point, char *buffer);
+
+// Number of UTF-16 code units utf8_to_utf16() produces for string
+size_t utf8_utf16_length(const char *string);
+// Encodes string as UTF-16LE into buffer, which has room for utf8_utf16_length()
+// code units. Returns the number of code units written.
+size_t utf8_to_utf16(const char *string, uint8_t *buffer);
+
+// Number of bytes utf16_to_utf8() produces for length code units, at most 3 per unit
+size_t utf16_utf8_length(const uint8_t *string, size_t length);
+// Encodes length UTF-16LE code units as UTF-8 into buffer, which has room for
+// utf16_utf8_length() bytes. Unpaired surrogates become U+FFFD. Doesn't NULL
+// terminate, returns the number of bytes written.
+size_t utf16_to_utf8(const uint8_t *string, size_t length, char *buffer);
+
+// Many short strings converted into one buffer. The memory is kept between
+// batches, once it is large enough converting doesn't allocate.
+typedef struct utf8_batch {
+	char *buffer;
+	size_t capacity;
+	size_t size;
+
+	// Offset of every string in buffer, SIZE_MAX for strings that are missing
+	size_t *offsets;
+	size_t offsets_capacity;
+	size_t number_of_strings;
+} utf8_batch_t;
+
+void utf8_batch_reset(utf8_batch_t *batch);
+// Appends length code units of string, a NULL string is kept as missing
+uint8_t utf8_batch_add(utf8_batch_t *batch, const uint8_t *string, size_t length);
+
+static inline uint32_t ascii_upper(uint32_t c) {
+	return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+}
+
+#endif /* PPELIB_UNICODE_H_ */
@@ -22,44 +22,6 @@
 #include "platform.h"
 #include "utils.h"
 
-uint8_t read_uint8_t(const uint8_t *buffer) {
-	return *buffer;
-}
-
-void write_uint8_t(uint8_t *buffer, uint8_t val) {
-	buffer[0] = val;
-}
-
-uint16_t read_uint16_t(const uint8_t *buffer) {
-	uint16_t retval;
-	memcpy(&retval, buffer, sizeof(uint16_t));
-	return retval;
-}
-
-void write_uint16_t(uint8_t *buffer, uint16_t val) {
-	memcpy(buffer, &val, sizeof(uint16_t));
-}
-
-uint32_t read_uint32_t(const uint8_t *buffer) {
-	uint32_t retval;
-	memcpy(&retval, buffer, sizeof(uint32_t));
-	return retval;
-}
-
-void write_uint32_t(uint8_t *buffer, uint32_t val) {
-	memcpy(buffer, &val, sizeof(uint32_t));
-}
-
-uint64_t read_uint64_t(const uint8_t *buffer) {
-	uint64_t retval;
-	memcpy(&retval, buffer, sizeof(uint64_t));
-	return retval;
-}
-
-void write_uint64_t(uint8_t *buffer, uint64_t val) {
-	memcpy(buffer, &val, sizeof(uint64_t));
-}
-
 uint16_t buffer_excise(uint8_t **buffer, size_t size, size_t start, size_t end) {
 	if (start >= end) {
 		return 0;
@@ -20,6 +20,7 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <ppelib/ppelib-constants.h>
 
@@ -37,14 +38,113 @@
 		memcpy(y, swap_temp, sizeof(x)); \
 	} while (0)
 
-uint8_t read_uint8_t(const uint8_t *buffer);
-void write_uint8_t(uint8_t *buffer, uint8_t val);
-uint16_t read_uint16_t(const uint8_t *buffer);
-void write_uint16_t(uint8_t *buffer, uint16_t val);
-uint32_t read_uint32_t(const uint8_t *buffer);
-void write_uint32_t(uint8_t *buffer, uint32_t val);
-uint64_t read_uint64_t(const uint8_t *buffer);
-void write_uint64_t(uint8_t *buffer, uint64_t val);
+// PE files are little endian. On little endian hosts these compile down to
+// single (unaligned) loads and stores.
+#if defined _WIN32 || (defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define PPELIB_LITTLE_ENDIAN 1
+#endif
+
+static inline uint8_t read_uint8_t(const uint8_t *buffer) {
+	return *buffer;
+}
+
+static inline void write_uint8_t(uint8_t *buffer, uint8_t val) {
+	buffer[0] = val;
+}
+
+static inline uint16_t read_uint16_t(const uint8_t *buffer) {
+#if defined PPELIB_LITTLE_ENDIAN
+	uint16_t retval;
+	memcpy(&retval, buffer, sizeof(uint16_t));
+	return retval;
+#else
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+#endif
+}
+
+static inline void write_uint16_t(uint8_t *buffer, uint16_t val) {
+#if defined PPELIB_LITTLE_ENDIAN
+	memcpy(buffer, &val, sizeof(uint16_t));
+#else
+	buffer[0] = (uint8_t)val;
+	buffer[1] = (uint8_t)(val >> 8);
+#endif
+}
+
+static inline uint32_t read_uint32_t(const uint8_t *buffer) {
+#if defined PPELIB_LITTLE_ENDIAN
+	uint32_t retval;
+	memcpy(&retval, buffer, sizeof(uint32_t));
+	return retval;
+#else
+	return (uint32_t)read_uint16_t(buffer) | ((uint32_t)read_uint16_t(buffer + 2) << 16);
+#endif
+}
+
+static inline void write_uint32_t(uint8_t *buffer, uint32_t val) {
+#if defined PPELIB_LITTLE_ENDIAN
+	memcpy(buffer, &val, sizeof(uint32_t));
+#else
+	write_uint16_t(buffer, (uint16_t)val);
+	write_uint16_t(buffer + 2, (uint16_t)(val >> 16));
+#endif
+}
+
+static inline uint64_t read_uint64_t(const uint8_t *buffer) {
+#if defined PPELIB_LITTLE_ENDIAN
+	uint64_t retval;
+	memcpy(&retval, buffer, sizeof(uint64_t));
+	return retval;
+#else
+	return (uint64_t)read_uint32_t(buffer) | ((uint64_t)read_uint32_t(buffer + 4) << 32);
+#endif
+}
+
+static inline void write_uint64_t(uint8_t *buffer, uint64_t val) {
+#if defined PPELIB_LITTLE_ENDIAN
+	memcpy(buffer, &val, sizeof(uint64_t));
+#else
+	write_uint32_t(buffer, (uint32_t)val);
+	write_uint32_t(buffer + 4, (uint32_t)(val >> 32));
+#endif
+}
+
+// FNV-1a. Hashes start out as FNV_OFFSET_BASIS and take one byte at a time, so the
+// fields of a key can be mixed in one after another.
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static inline uint32_t fnv1a_byte(uint32_t hash, uint8_t byte) {
+	return (hash ^ byte) * FNV_PRIME;
+}
+
+static inline uint32_t fnv1a_string(uint32_t hash, const char *string) {
+	for (const char *c = string; *c; ++c) {
+		hash = fnv1a_byte(hash, (uint8_t)*c);
+	}
+
+	return hash;
+}
+
+// Lookup indexes are open addressed with linear probing. They are kept at most half
+// full so probe sequences stay short, capacities are powers of two. A probe sequence
+// runs from hash_index_first() through hash_index_next() until an empty slot.
+static inline size_t hash_index_capacity(size_t number_of_entries) {
+	size_t capacity = 16;
+	while (capacity < number_of_entries * 2) {
+		capacity *= 2;
+	}
+
+	return capacity;
+}
+
+static inline size_t hash_index_first(uint32_t hash, size_t capacity) {
+	return hash & (capacity - 1);
+}
+
+static inline size_t hash_index_next(size_t slot, size_t capacity) {
+	return (slot + 1) & (capacity - 1);
+}
 
 uint16_t buffer_excise(uint8_t **buffer, size_t size, size_t start, size_t end);
 uint32_t next_pow2(uint32_t number);
@@ -0,0 +1,159 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-constants.h>
+#include <ppelib/ppelib.h>
+
+static const uint32_t algorithms[] = { PPELIB_DIGEST_SHA1, PPELIB_DIGEST_SHA256 };
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *buffer = malloc(*size + 1);
+	if (buffer && fread(buffer, 1, *size, f) != *size) {
+		free(buffer);
+		buffer = NULL;
+	}
+
+	fclose(f);
+	return buffer;
+}
+
+static int check_errors(void) {
+	uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+
+	if (ppelib_authenticode_digest_buffer((const uint8_t *)"abc", 3, PPELIB_DIGEST_SHA1, digest)
+			|| !ppelib_error()) {
+		printf("Non-PE buffer was hashed\n");
+		return 0;
+	}
+
+	if (ppelib_authenticode_digest_buffer(NULL, 0, 3, digest) || !ppelib_error()) {
+		printf("Unknown algorithm was accepted\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		printf("Usage: %s <infile> <outfile>\n", argv[0]);
+		return 1;
+	}
+
+	if (!check_errors()) {
+		return 1;
+	}
+
+	int retval = 1;
+	uint8_t *in = NULL;
+	uint8_t *out = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	size_t in_size = 0;
+	in = read_file(argv[1], &in_size);
+	if (!in) {
+		printf("Failed to read %s\n", argv[1]);
+		goto out;
+	}
+
+	for (size_t i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); ++i) {
+		uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+		size_t digest_size = ppelib_authenticode_digest(pe, algorithms[i], digest);
+		if (!digest_size) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		ppelib_write_options options = { 0 };
+		options.digest_algorithm = algorithms[i];
+		if (!ppelib_write_to_file_with_options(pe, argv[2], &options)) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		if (memcmp(digest, options.digest, digest_size) != 0) {
+			printf("Digest %u differs between hashing and writing\n", algorithms[i]);
+			goto out;
+		}
+
+		free(out);
+		size_t out_size = 0;
+		out = read_file(argv[2], &out_size);
+		if (!out) {
+			printf("Failed to read %s\n", argv[2]);
+			goto out;
+		}
+
+		uint8_t written_digest[PPELIB_DIGEST_MAX_SIZE];
+		if (ppelib_authenticode_digest_buffer(out, out_size, algorithms[i], written_digest) != digest_size) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		if (memcmp(digest, written_digest, digest_size) != 0) {
+			printf("Digest %u differs from the digest of the written file\n", algorithms[i]);
+			goto out;
+		}
+
+		memset(options.digest, 0, sizeof(options.digest));
+		if (ppelib_write_to_buffer_with_options(pe, out, out_size, &options) != out_size
+				|| memcmp(digest, options.digest, digest_size) != 0) {
+			printf("Digest %u differs when writing to a buffer\n", algorithms[i]);
+			goto out;
+		}
+
+		// A valid signature holds the digest of the file it signs
+		if (ppelib_authenticode_digest_buffer(in, in_size, algorithms[i], written_digest) != digest_size) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		for (size_t offset = 0; offset + digest_size <= in_size; ++offset) {
+			if (memcmp(in + offset, written_digest, digest_size) == 0) {
+				printf("%s: Signed digest found at offset %zu\n", argv[1], offset);
+				break;
+			}
+		}
+	}
+
+	retval = 0;
+
+out:
+	free(in);
+	free(out);
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -0,0 +1,145 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "generated/dos_header_private.h"
+#include "generated/header_private.h"
+#include "generated/import_directory_table_private.h"
+#include "generated/section_private.h"
+
+// Decode the headers, section table and import directory table of a file over
+// and over and report how long a single decode takes.
+
+volatile uint32_t sink;
+
+static double now() {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint8_t *slurp(const char *filename, size_t *size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	long file_size = ftell(f);
+	rewind(f);
+
+	if (file_size <= 0) {
+		fclose(f);
+		return NULL;
+	}
+
+	uint8_t *buffer = malloc((size_t)file_size);
+	if (!buffer || fread(buffer, 1, (size_t)file_size, f) != (size_t)file_size) {
+		free(buffer);
+		fclose(f);
+		return NULL;
+	}
+
+	fclose(f);
+	*size = (size_t)file_size;
+	return buffer;
+}
+
+static void report(const char *name, double start, long iterations) {
+	printf("%-24s %8.2f ns/decode\n", name, (now() - start) / (double)iterations);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2 || argc > 3) {
+		printf("Usage: %s <filename> [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	long iterations = 10000000;
+	if (argc == 3) {
+		iterations = strtol(argv[2], NULL, 10);
+	}
+
+	size_t size = 0;
+	uint8_t *buffer = slurp(argv[1], &size);
+	if (!buffer) {
+		printf("Failed to read %s\n", argv[1]);
+		return 1;
+	}
+
+	int retval = 1;
+
+	dos_header_t dos_header;
+	header_t header;
+	section_t section;
+	import_directory_table_t import_directory_table;
+
+	ppelib_dos_header_deserialize(buffer, size, 2, &dos_header);
+	size_t header_offset = dos_header.pe_header_offset + 4;
+	size_t header_size = ppelib_header_deserialize(buffer, size, header_offset, &header);
+	if (!header_size || header.number_of_rva_and_sizes <= DIR_IMPORT_TABLE || !header.number_of_sections) {
+		printf("%s: Need a PE file with sections and an import table\n", argv[1]);
+		goto out;
+	}
+
+	size_t section_offset = header_offset + COFF_HEADER_SIZE + header.size_of_optional_header;
+	uint32_t import_rva = read_uint32_t(buffer + header_offset + header_size + DIR_IMPORT_TABLE * DATA_DIRECTORY_SIZE);
+
+	size_t import_offset = 0;
+	for (uint16_t i = 0; i < header.number_of_sections; ++i) {
+		ppelib_section_deserialize(buffer, size, section_offset + i * SECTION_SIZE, &section);
+		if (section.virtual_address <= import_rva && section.virtual_address + section.size_of_raw_data > import_rva) {
+			import_offset = import_rva - section.virtual_address + section.pointer_to_raw_data;
+		}
+	}
+
+	if (!import_offset) {
+		printf("%s: Import table not found\n", argv[1]);
+		goto out;
+	}
+
+	double start = now();
+	for (long i = 0; i < iterations; ++i) {
+		ppelib_header_deserialize(buffer, size, header_offset, &header);
+		sink += header.number_of_rva_and_sizes;
+	}
+	report("header", start, iterations);
+
+	start = now();
+	for (long i = 0; i < iterations; ++i) {
+		ppelib_section_deserialize(buffer, size, section_offset + (size_t)(i % header.number_of_sections) * SECTION_SIZE, &section);
+		sink += section.virtual_address;
+	}
+	report("section", start, iterations);
+
+	start = now();
+	for (long i = 0; i < iterations; ++i) {
+		ppelib_import_directory_table_deserialize(buffer, size, import_offset, &import_directory_table);
+		sink += import_directory_table.name_rva;
+	}
+	report("import_directory_table", start, iterations);
+
+	retval = 0;
+
+out:
+	free(buffer);
+	return retval;
+}
@@ -0,0 +1,223 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-constants.h>
+#include <ppelib/ppelib.h>
+
+static void print_span(const char *name, const ppelib_span *span) {
+	printf("  %s:", name);
+	for (size_t i = 0; i < span->size && i < 32; ++i) {
+		printf(" %02X", span->data[i]);
+	}
+	printf("%s\n", span->size > 32 ? " ..." : "");
+}
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t)ftell(f);
+	rewind(f);
+
+	uint8_t *buffer = malloc(*size);
+	if (buffer && fread(buffer, 1, *size, f) != *size) {
+		free(buffer);
+		buffer = NULL;
+	}
+
+	fclose(f);
+	return buffer;
+}
+
+static int write_file(const char *filename, const uint8_t *buffer, size_t size) {
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		return 1;
+	}
+
+	size_t written = fwrite(buffer, 1, size, f);
+	fclose(f);
+
+	return written != size;
+}
+
+// Writing over the file a mapped handle was loaded from unmaps the overlay the
+// certificates were found in. Getting the table again has to find them in the copy.
+static int rewrite_mapped(const char *infile, const char *workfile) {
+	int retval = 1;
+	size_t size = 0;
+	size_t saved_size = 0;
+	uint8_t *saved = NULL;
+	ppelib_handle *pe = NULL;
+
+	uint8_t *original = read_file(infile, &size);
+	if (!original || write_file(workfile, original, size)) {
+		printf("Failed to copy %s to %s\n", infile, workfile);
+		goto out;
+	}
+
+	pe = ppelib_create_from_file_mapped(workfile);
+	if (ppelib_error()) {
+		printf("PElib-error mapped: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_certificate_table *table = ppelib_get_certificate_table(pe);
+	if (!table) {
+		printf("PElib-error mapped: %s\n", ppelib_error());
+		goto out;
+	}
+
+	uint32_t number_of_certificates = ppelib_certificate_table_get_size(table);
+	if (!number_of_certificates) {
+		retval = 0;
+		goto out;
+	}
+
+	ppelib_certificate certificate;
+	ppelib_certificate_table_get(table, 0, &certificate);
+	saved_size = certificate.size;
+	saved = malloc(saved_size + 1);
+	if (!saved) {
+		goto out;
+	}
+	memcpy(saved, certificate.data, saved_size);
+
+	ppelib_write_to_file(pe, workfile);
+	if (ppelib_error()) {
+		printf("PElib-error rewriting: %s\n", ppelib_error());
+		goto out;
+	}
+
+	table = ppelib_get_certificate_table(pe);
+	if (!table || ppelib_certificate_table_get_size(table) != number_of_certificates) {
+		printf("%s: Certificate table changed after rewriting the mapped file\n", infile);
+		goto out;
+	}
+
+	ppelib_certificate_table_get(table, 0, &certificate);
+	if (certificate.size != saved_size || memcmp(certificate.data, saved, saved_size) != 0) {
+		printf("%s: Certificate changed after rewriting the mapped file\n", infile);
+		goto out;
+	}
+
+	ppelib_signer signer;
+	if (certificate.certificate_type == WIN_CERT_TYPE_PKCS_SIGNED_DATA
+			&& !ppelib_certificate_get_signer(&certificate, &signer)) {
+		printf("PElib-error rewritten: %s\n", ppelib_error());
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(pe);
+	free(saved);
+	free(original);
+
+	return retval;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2 && argc != 3) {
+		printf("Usage: %s <filename> [workfile]\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_certificate_table *table = ppelib_get_certificate_table(pe);
+	if (!table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	uint32_t size = ppelib_certificate_table_get_size(table);
+	if (!size != !ppelib_has_signature(pe)) {
+		printf("%s: %u certificates in the table\n", argv[1], size);
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < size; ++i) {
+		ppelib_certificate certificate;
+		if (!ppelib_certificate_table_get(table, i, &certificate)) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		printf("Certificate %u: revision 0x%04X, type %u, %zu bytes\n", i, certificate.revision,
+				certificate.certificate_type, certificate.size);
+		if (certificate.certificate_type != WIN_CERT_TYPE_PKCS_SIGNED_DATA) {
+			continue;
+		}
+
+		ppelib_signer signer;
+		if (!ppelib_certificate_get_signer(&certificate, &signer)) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		print_span("Subject", &signer.subject);
+		print_span("Issuer", &signer.issuer);
+		print_span("Serial", &signer.serial);
+		print_span("Digest algorithm", &signer.digest_algorithm);
+		printf("  Signing time: %.*s\n", (int)signer.signing_time.size, (const char *)signer.signing_time.data);
+		print_span("Image digest", &signer.image_digest);
+
+		if (!signer.issuer.size || !signer.serial.size || !signer.digest || !signer.image_digest.size) {
+			printf("%s: Signer is missing fields\n", argv[1]);
+			goto out;
+		}
+
+		// Spans point into the certificate
+		const uint8_t *end = certificate.data + certificate.size;
+		const ppelib_span *spans[] = { &signer.subject, &signer.issuer, &signer.serial, &signer.digest_algorithm,
+			&signer.signing_time, &signer.image_digest };
+		for (size_t j = 0; j < sizeof(spans) / sizeof(spans[0]); ++j) {
+			if (spans[j]->size && (spans[j]->data < certificate.data || spans[j]->data + spans[j]->size > end)) {
+				printf("%s: Span %zu points outside of the certificate\n", argv[1], j);
+				goto out;
+			}
+		}
+
+		uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+		size_t digest_size = ppelib_authenticode_digest(pe, signer.image_digest_algorithm, digest);
+		if (digest_size != signer.image_digest.size || memcmp(digest, signer.image_digest.data, digest_size) != 0) {
+			printf("%s: Signed digest doesn't match the file\n", argv[1]);
+		}
+	}
+
+	retval = argc == 3 ? rewrite_mapped(argv[1], argv[2]) : 0;
+
+out:
+	ppelib_destroy(pe);
+
+	return retval;
+}
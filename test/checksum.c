@@ -0,0 +1,149 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib.h>
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *buffer = malloc(*size + 1);
+	if (buffer && fread(buffer, 1, *size, f) != *size) {
+		free(buffer);
+		buffer = NULL;
+	}
+
+	fclose(f);
+	return buffer;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		printf("Usage: %s <infile> <outfile>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+	uint8_t *in = NULL;
+	uint8_t *out = NULL;
+	uint8_t *buffer = NULL;
+	ppelib_handle *written = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	size_t in_size = 0;
+	in = read_file(argv[1], &in_size);
+	if (!in) {
+		printf("Failed to read %s\n", argv[1]);
+		goto out;
+	}
+
+	uint8_t valid = ppelib_checksum_verify_buffer(in, in_size);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+	printf("%s: Checksum %08X, %s\n", argv[1], ppelib_checksum_buffer(in, in_size), valid ? "valid" : "invalid");
+
+	uint32_t checksum = ppelib_checksum(pe);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+	size_t digest_size = ppelib_authenticode_digest(pe, PPELIB_DIGEST_SHA256, digest);
+	if (!digest_size) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	// The checksum isn't part of the digest, updating it doesn't change the digest
+	ppelib_write_options options = { 0 };
+	options.digest_algorithm = PPELIB_DIGEST_SHA256;
+	options.update_checksum = 1;
+	if (!ppelib_write_to_file_with_options(pe, argv[2], &options)) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	if (options.checksum != checksum || memcmp(options.digest, digest, digest_size) != 0) {
+		printf("Writing computed checksum %08X, expected %08X\n", options.checksum, checksum);
+		goto out;
+	}
+
+	size_t out_size = 0;
+	out = read_file(argv[2], &out_size);
+	if (!out) {
+		printf("Failed to read %s\n", argv[2]);
+		goto out;
+	}
+
+	if (!ppelib_checksum_verify_buffer(out, out_size) || ppelib_checksum_buffer(out, out_size) != checksum) {
+		printf("Written file doesn't have checksum %08X\n", checksum);
+		goto out;
+	}
+
+	buffer = malloc(out_size);
+	if (!buffer) {
+		goto out;
+	}
+
+	memset(&options, 0, sizeof(options));
+	options.update_checksum = 1;
+	if (ppelib_write_to_buffer_with_options(pe, buffer, out_size, &options) != out_size || options.checksum != checksum
+			|| memcmp(buffer, out, out_size) != 0) {
+		printf("Writing to a buffer differs from writing to a file\n");
+		goto out;
+	}
+
+	written = ppelib_create_from_file(argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	if (!ppelib_checksum_verify(written)) {
+		printf("Written file doesn't verify\n");
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	free(in);
+	free(out);
+	free(buffer);
+	ppelib_destroy(written);
+	ppelib_destroy(pe);
+
+	return retval;
+}
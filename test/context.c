@@ -0,0 +1,128 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib.h>
+
+// Counts what is outstanding so leaks and frees of foreign memory show up
+typedef struct counter {
+	size_t allocations;
+	size_t outstanding;
+} counter_t;
+
+static void *counting_malloc(void *userdata, size_t size) {
+	counter_t *counter = userdata;
+	void *buffer = malloc(size);
+	if (buffer) {
+		++counter->allocations;
+		++counter->outstanding;
+	}
+
+	return buffer;
+}
+
+static void *counting_realloc(void *userdata, void *buffer, size_t size) {
+	counter_t *counter = userdata;
+	void *new_buffer = realloc(buffer, size);
+	if (new_buffer && !buffer) {
+		++counter->allocations;
+		++counter->outstanding;
+	}
+
+	return new_buffer;
+}
+
+static void counting_free(void *userdata, void *buffer) {
+	counter_t *counter = userdata;
+	if (buffer) {
+		--counter->outstanding;
+	}
+
+	free(buffer);
+}
+
+static int check_file(const char *filename, uint32_t parse_options) {
+	counter_t counter = { 0, 0 };
+	ppelib_allocator allocator = { counting_malloc, counting_realloc, counting_free, &counter };
+	int retval = 1;
+
+	ppelib_context *context = ppelib_context_create(&allocator, parse_options);
+	if (!context) {
+		printf("Failed to create context: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_handle *pe = ppelib_context_create_from_file(context, filename);
+	if (!pe) {
+		printf("PElib-error: %s\n", ppelib_context_error(context));
+		goto out;
+	}
+
+	if (counter.allocations < 2) {
+		printf("%s: Parsing didn't use the context allocator\n", filename);
+		goto out;
+	}
+
+	if (!ppelib_write_to_buffer(pe, NULL, 0) || ppelib_context_error(context)) {
+		printf("%s: Failed to size handle\n", filename);
+		goto out;
+	}
+
+	// Errors go to the context and leave the thread's error alone
+	static const uint8_t garbage[] = { 'M', 'Z', 0, 0 };
+	ppelib_handle *bad = ppelib_context_create_from_buffer(context, garbage, sizeof(garbage));
+	if (bad || !ppelib_context_error(context) || ppelib_error()) {
+		printf("%s: Parse error wasn't reported through the context\n", filename);
+		ppelib_destroy(bad);
+		goto out;
+	}
+
+	uint8_t small[1];
+	if (ppelib_write_to_buffer(pe, small, sizeof(small)) || !ppelib_context_error(context) || ppelib_error()) {
+		printf("%s: Write error wasn't reported through the context\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(pe);
+	ppelib_context_destroy(context);
+
+	if (counter.outstanding) {
+		printf("%s: %zu allocations leaked\n", filename, counter.outstanding);
+		retval = 1;
+	}
+
+	return retval;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printf("Usage: %s <infile>\n", argv[0]);
+		return 1;
+	}
+
+	if (check_file(argv[1], 0) || check_file(argv[1], PPELIB_PARSE_BORROW) || check_file(argv[1], PPELIB_PARSE_LAZY)) {
+		return 1;
+	}
+
+	return 0;
+}
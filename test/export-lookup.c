@@ -0,0 +1,203 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+static int same_target(const ppelib_export *e1, const ppelib_export *e2) {
+	return e1->ordinal == e2->ordinal && e1->rva == e2->rva && e1->forwarder == e2->forwarder;
+}
+
+// A copy of the file with size bytes at offset into the export directory replaced,
+// NULL for files without a directory to patch
+static ppelib_handle *patched_copy(ppelib_handle *pe, size_t offset, const uint8_t *bytes, size_t size,
+		uint8_t **buffer) {
+	*buffer = NULL;
+
+	const ppelib_data_directory *data_directory = ppelib_data_directory_get(pe, 0);
+	if (!data_directory || !ppelib_data_directory_get_section(data_directory)
+			|| ppelib_data_directory_get_size(data_directory) < 40) {
+		return NULL;
+	}
+
+	uint32_t rva = ppelib_data_directory_get_rva(data_directory);
+	ppelib_rva_location location;
+	if (ppelib_translate_rvas(pe, &rva, 1, &location) != 1) {
+		return NULL;
+	}
+
+	size_t file_size = ppelib_write_to_buffer(pe, NULL, 0);
+	*buffer = malloc(file_size);
+	if (!*buffer || ppelib_write_to_buffer(pe, *buffer, file_size) != file_size
+			|| location.file_offset + 40 > file_size) {
+		free(*buffer);
+		*buffer = NULL;
+		return NULL;
+	}
+
+	memcpy(*buffer + location.file_offset + offset, bytes, size);
+	return ppelib_create_from_buffer(*buffer, file_size);
+}
+
+// A directory without any exports has its counts and table RVAs set to 0. It has to
+// load as an empty table rather than as tables outside of any section.
+static int check_empty(ppelib_handle *pe, const char *filename) {
+	// Address table entries, number of name pointers and the three table RVAs
+	const uint8_t zeroes[20] = { 0 };
+	uint8_t *buffer;
+	ppelib_handle *empty = patched_copy(pe, 20, zeroes, sizeof(zeroes), &buffer);
+	if (!buffer) {
+		return 0;
+	}
+
+	int retval = 1;
+	if (ppelib_error()) {
+		printf("PElib-error empty: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_export_table *export_table = ppelib_get_export_table(empty);
+	if (!export_table) {
+		printf("%s: Empty export directory failed to load: %s\n", filename, ppelib_error());
+		goto out;
+	}
+
+	ppelib_export export;
+	if (ppelib_export_table_get_number_of_names(export_table)
+			|| ppelib_export_table_find(export_table, "ppelib_no_such_export", &export)
+			|| ppelib_export_table_find_ordinal(export_table, 1, &export)) {
+		printf("%s: Empty export directory has exports\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(empty);
+	free(buffer);
+
+	return retval;
+}
+
+// An address table outside of any section fails to load, and keeps failing with the
+// same error without being parsed again
+static int check_malformed(ppelib_handle *pe, const char *filename) {
+	// One address table entry at the end of the address space
+	const uint8_t patch[12] = { 1, 0, 0, 0, 0, 0, 0, 0, 0xF0, 0xFF, 0xFF, 0xFF };
+	uint8_t *buffer;
+	ppelib_handle *malformed = patched_copy(pe, 20, patch, sizeof(patch), &buffer);
+	if (!buffer) {
+		return 0;
+	}
+
+	int retval = 1;
+	if (ppelib_error()) {
+		printf("PElib-error malformed: %s\n", ppelib_error());
+		goto out;
+	}
+
+	char first_error[100] = "";
+	if (ppelib_get_export_table(malformed) || !ppelib_error()) {
+		printf("%s: Malformed export directory loaded\n", filename);
+		goto out;
+	}
+	strncpy(first_error, ppelib_error(), sizeof(first_error) - 1);
+
+	if (ppelib_get_export_table(malformed) || !ppelib_error() || strcmp(first_error, ppelib_error()) != 0) {
+		printf("%s: Malformed export directory failed differently the second time\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(malformed);
+	free(buffer);
+
+	return retval;
+}
+
+// Every export listed by name has to be found again by name and by ordinal
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_export_table *export_table = ppelib_get_export_table(pe);
+	if (!export_table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	uint32_t number_of_names = ppelib_export_table_get_number_of_names(export_table);
+	for (uint32_t i = 0; i < number_of_names; ++i) {
+		ppelib_export by_index;
+		ppelib_export by_name;
+		ppelib_export by_ordinal;
+
+		if (!ppelib_export_table_get_name(export_table, i, &by_index) || !by_index.name) {
+			printf("%s: Export %u has no name\n", argv[1], i);
+			goto out;
+		}
+
+		if (!by_index.rva == !by_index.forwarder) {
+			printf("%s: Export %s is neither an address nor a forwarder\n", argv[1], by_index.name);
+			goto out;
+		}
+
+		if (!ppelib_export_table_find(export_table, by_index.name, &by_name) || !same_target(&by_index, &by_name)
+				|| by_name.name != by_index.name) {
+			printf("%s: Export %s not found by name\n", argv[1], by_index.name);
+			goto out;
+		}
+
+		if (!ppelib_export_table_find_ordinal(export_table, by_index.ordinal, &by_ordinal)
+				|| !same_target(&by_index, &by_ordinal)) {
+			printf("%s: Export %s not found by ordinal %u\n", argv[1], by_index.name, by_index.ordinal);
+			goto out;
+		}
+	}
+
+	if (ppelib_export_table_find(export_table, "ppelib_no_such_export", NULL)) {
+		printf("%s: Found an export that doesn't exist\n", argv[1]);
+		goto out;
+	}
+
+	if (check_empty(pe, argv[1]) || check_malformed(pe, argv[1])) {
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -16,13 +16,32 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <ppelib/ppelib-low-level.h>
 #include <ppelib/ppelib.h>
 
+// Dumps go to the temporary directory so a test run can't leave them in the tree
 void write_header(ppelib_handle *pe, ppelib_header *header, const char *filename) {
-	FILE *f = fopen(filename, "wb");
+	const char *directory = getenv("TMPDIR");
+	if (!directory) {
+		directory = getenv("TEMP");
+	}
+	if (!directory) {
+		directory = "/tmp";
+	}
+
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s", directory, filename);
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		printf("Failed to write %s\n", path);
+		return;
+	}
+
+	printf("Headers written to %s\n", path);
 	ppelib_header_fprint(f, header);
 
 	uint16_t sections = ppelib_header_get_number_of_sections(header);
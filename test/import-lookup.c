@@ -0,0 +1,206 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// The IAT slot of a named import holds the RVA of its hint and name on disk
+static int check_slot(ppelib_handle *pe, const ppelib_import *import) {
+	uint32_t rvas[2] = { import->import_address_table_rva, 0 };
+	ppelib_rva_location locations[2];
+
+	if (ppelib_translate_rvas(pe, rvas, 1, locations) != 1) {
+		return 1;
+	}
+
+	const uint8_t *contents = ppelib_section_get_contents(locations[0].section);
+	const uint8_t *slot = contents + locations[0].offset;
+	rvas[1] = (uint32_t)slot[0] | (uint32_t)slot[1] << 8 | (uint32_t)slot[2] << 16 | (uint32_t)slot[3] << 24;
+
+	if (ppelib_translate_rvas(pe, &rvas[1], 1, &locations[1]) != 1) {
+		return 1;
+	}
+
+	const uint8_t *hint_name = ppelib_section_get_contents(locations[1].section) + locations[1].offset;
+	uint16_t hint = (uint16_t)(hint_name[0] | hint_name[1] << 8);
+
+	return hint != import->hint || strcmp((const char *)hint_name + 2, import->name) != 0;
+}
+
+// The first line of each DLL ppelib_import_table_fprint() lists
+static size_t list_dlls(ppelib_import_table *import_table, char *first, size_t size) {
+	FILE *listing = tmpfile();
+	if (!listing) {
+		return 0;
+	}
+
+	ppelib_import_table_fprint(listing, import_table);
+	rewind(listing);
+
+	char line[512];
+	size_t number_of_dlls = 0;
+	while (fgets(line, sizeof(line), listing)) {
+		if (!strncmp(line, "DLL name: ", 10)) {
+			if (!number_of_dlls++) {
+				snprintf(first, size, "%s", line);
+			}
+		}
+	}
+
+	fclose(listing);
+	return number_of_dlls;
+}
+
+// A descriptor pointing outside of its section ends the list, the DLLs before it
+// are kept
+static int check_truncated(ppelib_handle *pe, ppelib_import_table *import_table, const char *filename) {
+	char first[512] = "";
+	if (list_dlls(import_table, first, sizeof(first)) < 2) {
+		return 0;
+	}
+
+	const ppelib_data_directory *data_directory = ppelib_data_directory_get(pe, 1);
+	uint32_t rva = data_directory ? ppelib_data_directory_get_rva(data_directory) : 0;
+	ppelib_rva_location location;
+	if (!rva || ppelib_translate_rvas(pe, &rva, 1, &location) != 1) {
+		return 0;
+	}
+
+	size_t size = ppelib_write_to_buffer(pe, NULL, 0);
+	uint8_t *buffer = malloc(size);
+	if (!buffer || ppelib_write_to_buffer(pe, buffer, size) != size || location.file_offset + 40 > size) {
+		free(buffer);
+		return 0;
+	}
+
+	// Name RVA of the second descriptor
+	memset(buffer + location.file_offset + 20 + 12, 0xF0, 4);
+
+	int retval = 1;
+	char truncated_first[512] = "";
+	ppelib_handle *truncated = ppelib_create_from_buffer(buffer, size);
+	ppelib_import_table *truncated_table = truncated ? ppelib_get_import_table(truncated) : NULL;
+	if (!truncated_table) {
+		printf("%s: Truncated import table failed to load: %s\n", filename, ppelib_error());
+		goto out;
+	}
+
+	if (list_dlls(truncated_table, truncated_first, sizeof(truncated_first)) != 1
+			|| strcmp(first, truncated_first) != 0) {
+		printf("%s: Truncated import table doesn't hold just the first DLL\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(truncated);
+	free(buffer);
+
+	return retval;
+}
+
+// Look every import listed by ppelib_import_table_fprint() up again
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+	FILE *listing = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_import_table *import_table = ppelib_get_import_table(pe);
+	if (!import_table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	listing = tmpfile();
+	if (!listing) {
+		printf("Failed to create temporary file\n");
+		goto out;
+	}
+
+	ppelib_import_table_fprint(listing, import_table);
+	rewind(listing);
+
+	char line[512];
+	char dll_name[256] = "";
+	size_t found = 0;
+	while (fgets(line, sizeof(line), listing)) {
+		char name[256];
+		unsigned int hint;
+		unsigned int ordinal;
+		ppelib_import import;
+
+		if (sscanf(line, "DLL name: %255[^,],", dll_name) == 1) {
+			// DLL names don't care about case
+			for (char *c = dll_name; *c; ++c) {
+				*c = (char)tolower(*c);
+			}
+		} else if (sscanf(line, "  Name: %255[^,], hint: 0x%X", name, &hint) == 2) {
+			if (!ppelib_import_table_find(import_table, dll_name, name, &import) || import.hint != hint
+					|| strcmp(import.name, name) != 0) {
+				printf("%s: Import %s!%s not found\n", argv[1], dll_name, name);
+				goto out;
+			}
+
+			if (check_slot(pe, &import)) {
+				printf("%s: Wrong IAT slot for %s!%s\n", argv[1], dll_name, name);
+				goto out;
+			}
+			++found;
+		} else if (sscanf(line, "  Ordinal: 0x%X", &ordinal) == 1) {
+			if (!ppelib_import_table_find_ordinal(import_table, dll_name, (uint16_t)ordinal, &import) || import.name) {
+				printf("%s: Import %s!#%u not found\n", argv[1], dll_name, ordinal);
+				goto out;
+			}
+			++found;
+		}
+	}
+
+	if (found && ppelib_import_table_find(import_table, dll_name, "ppelib_no_such_import", NULL)) {
+		printf("%s: Found an import that doesn't exist\n", argv[1]);
+		goto out;
+	}
+
+	if (check_truncated(pe, import_table, argv[1])) {
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	if (listing) {
+		fclose(listing);
+	}
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -0,0 +1,134 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+static int compare(ppelib_handle *pe, ppelib_handle *pe2, const char *filename, const char *kind) {
+	int retval = 0;
+	uint8_t *b1 = NULL;
+	uint8_t *b2 = NULL;
+
+	size_t len1 = ppelib_write_to_buffer(pe, NULL, 0);
+	size_t len2 = ppelib_write_to_buffer(pe2, NULL, 0);
+	if (len1 != len2) {
+		printf("%s: Size mismatch between copied and %s file\n", filename, kind);
+		retval = 1;
+		goto out;
+	}
+
+	b1 = malloc(len1);
+	b2 = malloc(len2);
+	ppelib_write_to_buffer(pe, b1, len1);
+	ppelib_write_to_buffer(pe2, b2, len2);
+	if (ppelib_error()) {
+		printf("PElib-error writing %s file: %s\n", kind, ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	if (memcmp(b1, b2, len1) != 0) {
+		printf("%s: Content mismatch between copied and %s file\n", filename, kind);
+		retval = 1;
+		goto out;
+	}
+
+	printf("%s: Copied and %s file match\n", filename, kind);
+
+out:
+	free(b1);
+	free(b2);
+
+	return retval;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <infile>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 0;
+
+	ppelib_handle *pe2 = NULL;
+	ppelib_handle *pe3 = NULL;
+	ppelib_handle *pe4 = NULL;
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error infile: %s\n", ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	pe2 = ppelib_create_from_file_mapped(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error mapped infile: %s\n", ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	pe3 = ppelib_create_from_file_lazy(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error lazy infile: %s\n", ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	int fd = open(argv[1], O_RDONLY);
+	if (fd < 0) {
+		printf("Failed to open infile\n");
+		retval = 1;
+		goto out;
+	}
+
+	pe4 = ppelib_create_from_fd(fd);
+	if (ppelib_error()) {
+		printf("PElib-error fd infile: %s\n", ppelib_error());
+		retval = 1;
+		close(fd);
+		goto out;
+	}
+
+	retval = compare(pe, pe2, argv[1], "mapped");
+	if (!retval) {
+		retval = compare(pe, pe3, argv[1], "lazy");
+	}
+	if (!retval) {
+		retval = compare(pe, pe4, argv[1], "fd");
+	}
+
+	ppelib_destroy(pe4);
+	close(fd);
+
+out:
+	ppelib_destroy(pe);
+	ppelib_destroy(pe2);
+	ppelib_destroy(pe3);
+
+	return retval;
+}
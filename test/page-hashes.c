@@ -0,0 +1,137 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib.h>
+
+static const uint32_t algorithms[] = { PPELIB_DIGEST_SHA1, PPELIB_DIGEST_SHA256 };
+static const uint32_t threads[] = { 1, 3, 0 };
+
+static uint32_t read_offset(const uint8_t *entry) {
+	return (uint32_t)entry[0] | (uint32_t)entry[1] << 8 | (uint32_t)entry[2] << 16 | (uint32_t)entry[3] << 24;
+}
+
+static int check_table(const char *filename, const uint8_t *table, size_t size, size_t entry_size) {
+	if (size % entry_size || size < entry_size * 2 || read_offset(table) != 0) {
+		printf("%s: Table of %zu bytes doesn't start with the headers\n", filename, size);
+		return 0;
+	}
+
+	for (size_t offset = entry_size; offset < size; offset += entry_size) {
+		if (read_offset(table + offset) < read_offset(table + offset - entry_size)) {
+			printf("%s: Page at %u comes after page at %u\n", filename, read_offset(table + offset),
+					read_offset(table + offset - entry_size));
+			return 0;
+		}
+	}
+
+	for (size_t i = size - entry_size + 4; i < size; ++i) {
+		if (table[i]) {
+			printf("%s: Last entry has a digest\n", filename);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+	uint8_t *table = NULL;
+	uint8_t *other = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	if (ppelib_page_hashes(pe, 3, 1, NULL, 0) || !ppelib_error()) {
+		printf("Unknown algorithm was accepted\n");
+		goto out;
+	}
+
+	for (size_t i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); ++i) {
+		size_t entry_size = 4 + (algorithms[i] == PPELIB_DIGEST_SHA1 ? 20 : 32);
+		size_t size = ppelib_page_hashes(pe, algorithms[i], 1, NULL, 0);
+		if (!size) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		free(table);
+		free(other);
+		table = malloc(size);
+		other = malloc(size);
+		if (!table || !other) {
+			goto out;
+		}
+
+		if (ppelib_page_hashes(pe, algorithms[i], 1, table, size - 1) || !ppelib_error()) {
+			printf("Table was written to a buffer that is too small\n");
+			goto out;
+		}
+
+		if (ppelib_page_hashes(pe, algorithms[i], 1, table, size) != size) {
+			printf("PElib-error: %s\n", ppelib_error());
+			goto out;
+		}
+
+		if (!check_table(argv[1], table, size, entry_size)) {
+			goto out;
+		}
+
+		// The table doesn't depend on how the work is split up
+		for (size_t j = 0; j < sizeof(threads) / sizeof(threads[0]); ++j) {
+			memset(other, 0, size);
+			if (ppelib_page_hashes(pe, algorithms[i], threads[j], other, size) != size
+					|| memcmp(table, other, size) != 0) {
+				printf("%s: Table differs on %u threads\n", argv[1], threads[j]);
+				goto out;
+			}
+
+			if (!ppelib_page_hashes_verify(pe, algorithms[i], threads[j], table, size)) {
+				printf("%s: Table doesn't verify on %u threads\n", argv[1], threads[j]);
+				goto out;
+			}
+		}
+
+		other[size - entry_size - 1] ^= 1;
+		if (ppelib_page_hashes_verify(pe, algorithms[i], 0, other, size)
+				|| ppelib_page_hashes_verify(pe, algorithms[i], 0, table, size - entry_size)) {
+			printf("%s: Wrong table verifies\n", argv[1]);
+			goto out;
+		}
+	}
+
+	retval = 0;
+
+out:
+	free(table);
+	free(other);
+	ppelib_destroy(pe);
+
+	return retval;
+}
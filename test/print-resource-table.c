@@ -32,15 +32,18 @@ int main(int argc, char *argv[]) {
 	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
 	if (ppelib_error()) {
 		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
 	}
 
-	ppelib_resource_table_t *table = ppelib_get_resource_table(pe);
-	if (ppelib_error()) {
+	ppelib_resource_table *table = ppelib_get_resource_table(pe);
+	if (!table) {
 		printf("PElib-error: %s\n", ppelib_error());
-		return (1);
+		retval = 1;
+		goto out;
 	}
-	ppelib_print_resource_table(table);
+	ppelib_resource_table_print(table);
 
+out:
 	ppelib_destroy(pe);
 
 	return retval;
@@ -22,12 +22,13 @@
 #include <ppelib/ppelib.h>
 
 int main(int argc, char *argv[]) {
-	if (argc != 2) {
-		printf("Usage: %s <filename>\n", argv[0]);
+	if (argc != 3) {
+		printf("Usage: %s <infile> <outfile>\n", argv[0]);
 		return 1;
 	}
 
 	int retval = 0;
+	ppelib_handle *written = NULL;
 
 	printf("Removing signature from %s, copying to %s\n", argv[1], argv[2]);
 
@@ -43,18 +44,46 @@ int main(int argc, char *argv[]) {
 		goto out;
 	}
 
+	// The signature isn't part of the digest it signs
+	uint8_t digest[PPELIB_DIGEST_MAX_SIZE];
+	uint8_t unsigned_digest[PPELIB_DIGEST_MAX_SIZE];
+	size_t digest_size = ppelib_authenticode_digest(pe, PPELIB_DIGEST_SHA256, digest);
+
 	ppelib_signature_remove(pe);
 	if (ppelib_error()) {
 		printf("PElib-error signature_remove: %s\n", ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	if (!digest_size || ppelib_authenticode_digest(pe, PPELIB_DIGEST_SHA256, unsigned_digest) != digest_size
+			|| memcmp(digest, unsigned_digest, digest_size) != 0) {
+		printf("Removing the signature changed the digest\n");
+		retval = 1;
+		goto out;
 	}
 
 	ppelib_write_to_file(pe, argv[2]);
 	if (ppelib_error()) {
 		printf("PElib-error outfile: %s\n", ppelib_error());
-		return (1);
+		retval = 1;
+		goto out;
+	}
+
+	written = ppelib_create_from_file(argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error reading outfile: %s\n", ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	if (ppelib_has_signature(written)) {
+		printf("File %s still has a signature\n", argv[2]);
+		retval = 1;
 	}
 
 out:
+	ppelib_destroy(written);
 	ppelib_destroy(pe);
 
 	return retval;
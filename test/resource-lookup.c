@@ -0,0 +1,213 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// Names outside of ASCII are skipped, the keys are UTF-8
+static int entry_key(const ppelib_resource_entry *entry, ppelib_resource_key *key, char *name) {
+	key->name = NULL;
+	key->id = entry->id;
+
+	if (!entry->name) {
+		return 1;
+	}
+
+	for (uint16_t i = 0; i < entry->name_length; ++i) {
+		uint16_t c = (uint16_t)(entry->name[i * 2] | (entry->name[i * 2 + 1] << 8));
+		if (!c || c >= 0x80) {
+			return 0;
+		}
+		name[i] = (char)c;
+	}
+	name[entry->name_length] = 0;
+
+	key->name = name;
+	return 1;
+}
+
+// A root whose entries all point back at itself has to be an error, not a walk that
+// never ends
+static int check_loop(ppelib_handle *pe, const char *filename) {
+	const ppelib_data_directory *data_directory = ppelib_data_directory_get(pe, 2);
+	if (!data_directory || !ppelib_data_directory_get_section(data_directory)
+			|| ppelib_data_directory_get_size(data_directory) < 64) {
+		return 0;
+	}
+
+	uint32_t rva = ppelib_data_directory_get_rva(data_directory);
+	ppelib_rva_location location;
+	if (ppelib_translate_rvas(pe, &rva, 1, &location) != 1) {
+		return 0;
+	}
+
+	size_t size = ppelib_write_to_buffer(pe, NULL, 0);
+	uint8_t *buffer = malloc(size);
+	if (!buffer || ppelib_write_to_buffer(pe, buffer, size) != size || location.file_offset + 64 > size) {
+		free(buffer);
+		return 0;
+	}
+
+	// Six id entries, each pointing at the directory at offset 0
+	uint8_t *root = buffer + location.file_offset;
+	memset(root, 0, 16);
+	root[14] = 6;
+	for (uint8_t i = 0; i < 6; ++i) {
+		uint8_t entry[8] = { (uint8_t)(i + 1), 0, 0, 0, 0, 0, 0, 0x80 };
+		memcpy(root + 16 + i * 8, entry, sizeof(entry));
+	}
+
+	int retval = 1;
+	ppelib_resource_builder *builder = NULL;
+	ppelib_handle *looped = ppelib_create_from_buffer(buffer, size);
+	if (ppelib_error()) {
+		printf("PElib-error looped: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_resource_table *table = ppelib_get_resource_table(looped);
+	ppelib_resource_directory *directory = table ? ppelib_resource_table_get_root(table) : NULL;
+	if (!directory) {
+		printf("%s: Looped resource table failed to load: %s\n", filename, ppelib_error());
+		goto out;
+	}
+
+	ppelib_resource_entry entry;
+	if (ppelib_resource_directory_get_entry(directory, 0, &entry) || !ppelib_error()) {
+		printf("%s: Resource directory loop not detected\n", filename);
+		goto out;
+	}
+
+	builder = ppelib_resource_builder_create();
+	if (!builder || ppelib_resource_builder_add_table(builder, table)) {
+		printf("%s: Resource directory loop added to builder\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_resource_builder_destroy(builder);
+	ppelib_destroy(looped);
+	free(buffer);
+
+	return retval;
+}
+
+// Every data entry reached by walking the tree has to be found again by its path
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_resource_table *table = ppelib_get_resource_table(pe);
+	if (!table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_resource_directory *root = ppelib_resource_table_get_root(table);
+	if (!root) {
+		retval = 0;
+		goto out;
+	}
+
+	char names[3][UINT16_MAX + 1];
+	for (uint32_t t = 0; t < ppelib_resource_directory_get_number_of_entries(root); ++t) {
+		ppelib_resource_entry type;
+		ppelib_resource_key type_key;
+		if (!ppelib_resource_directory_get_entry(root, t, &type)) {
+			printf("%s: PElib-error: %s\n", argv[1], ppelib_error());
+			goto out;
+		}
+
+		if (!type.directory || !entry_key(&type, &type_key, names[0])) {
+			continue;
+		}
+
+		for (uint32_t n = 0; n < ppelib_resource_directory_get_number_of_entries(type.directory); ++n) {
+			ppelib_resource_entry name;
+			ppelib_resource_key name_key;
+			if (!ppelib_resource_directory_get_entry(type.directory, n, &name)) {
+				printf("%s: PElib-error: %s\n", argv[1], ppelib_error());
+				goto out;
+			}
+
+			if (!name.directory || !entry_key(&name, &name_key, names[1])) {
+				continue;
+			}
+
+			for (uint32_t l = 0; l < ppelib_resource_directory_get_number_of_entries(name.directory); ++l) {
+				ppelib_resource_entry language;
+				ppelib_resource_key language_key;
+				ppelib_resource_data data;
+				if (!ppelib_resource_directory_get_entry(name.directory, l, &language)) {
+					printf("%s: PElib-error: %s\n", argv[1], ppelib_error());
+					goto out;
+				}
+
+				if (language.directory || !entry_key(&language, &language_key, names[2])) {
+					continue;
+				}
+
+				if (!ppelib_resource_table_find(table, &type_key, &name_key, &language_key, &data)
+						|| data.rva != language.data.rva || data.size != language.data.size
+						|| data.data != language.data.data) {
+					printf("%s: Resource %u/%u/%u not found by path\n", argv[1], t, n, l);
+					goto out;
+				}
+
+				if (!l && (!ppelib_resource_table_find(table, &type_key, &name_key, NULL, &data)
+									|| data.rva != language.data.rva)) {
+					printf("%s: Resource %u/%u not found without a language\n", argv[1], t, n);
+					goto out;
+				}
+			}
+		}
+	}
+
+	ppelib_resource_key no_such_type = { "PPELIB_NO_SUCH_TYPE", 0 };
+	ppelib_resource_key id = { NULL, 1 };
+	if (ppelib_resource_table_find(table, &no_such_type, &id, NULL, NULL)) {
+		printf("%s: Found a resource that doesn't exist\n", argv[1]);
+		goto out;
+	}
+
+	if (check_loop(pe, argv[1])) {
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -0,0 +1,161 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// Long enough to cross the vector blocks, with non-ASCII at every position of them
+static const char *strings[] = {
+	"",
+	"A",
+	"VS_VERSION_INFO",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyz",
+	"\xC3\xA9t\xC3\xA9",
+	"ABCDEFG\xC3\xA9IJKLMNOP",
+	"ABCDEFGHIJKLMNO\xE2\x82\xAC" "ABCDEFGHIJKLMNOPQRSTUVWXYZ",
+	"\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E",
+	"ICON_\xF0\x9F\x98\x80_ICON_ICON_ICON_ICON",
+};
+
+static int check_strings(void) {
+	uint8_t utf16[256];
+	char utf8[256];
+
+	for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); ++i) {
+		size_t length = ppelib_utf8_to_utf16(strings[i], utf16, sizeof(utf16));
+		size_t size = ppelib_utf16_to_utf8(utf16, length, utf8, sizeof(utf8));
+		if (size != strlen(strings[i]) || strcmp(utf8, strings[i]) != 0) {
+			printf("String %zu didn't survive conversion: %s\n", i, utf8);
+			return 0;
+		}
+
+		if (ppelib_utf16_to_utf8(utf16, length, utf8, size) != size) {
+			printf("String %zu: wrong size without room\n", i);
+			return 0;
+		}
+	}
+
+	// An unpaired surrogate in the middle of ASCII
+	uint8_t broken[20] = { 'A', 0, 'B', 0, 'C', 0, 'D', 0, 'E', 0, 'F', 0, 'G', 0, 0x00, 0xD8, 'H', 0, 'I', 0 };
+	ppelib_utf16_to_utf8(broken, 10, utf8, sizeof(utf8));
+	if (strcmp(utf8, "ABCDEFG\xEF\xBF\xBDHI") != 0) {
+		printf("Unpaired surrogate not replaced: %s\n", utf8);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int check_directory(const char *filename, ppelib_resource_directory *directory, ppelib_utf8_batch *batch) {
+	if (!ppelib_resource_directory_get_names_utf8(directory, batch)) {
+		printf("%s: PElib-error: %s\n", filename, ppelib_error());
+		return 0;
+	}
+
+	uint32_t number_of_entries = ppelib_resource_directory_get_number_of_entries(directory);
+	if (ppelib_utf8_batch_get_size(batch) != number_of_entries) {
+		printf("%s: Batch has %zu names for %u entries\n", filename, ppelib_utf8_batch_get_size(batch),
+				number_of_entries);
+		return 0;
+	}
+
+	ppelib_resource_directory **subdirectories = calloc(number_of_entries + 1, sizeof(ppelib_resource_directory *));
+	if (!subdirectories) {
+		return 0;
+	}
+
+	static char name[UINT16_MAX * 3 + 1];
+	int retval = 0;
+	for (uint32_t i = 0; i < number_of_entries; ++i) {
+		ppelib_resource_entry entry;
+		if (!ppelib_resource_directory_get_entry(directory, i, &entry)) {
+			printf("%s: PElib-error: %s\n", filename, ppelib_error());
+			goto out;
+		}
+
+		const char *batch_name = ppelib_utf8_batch_get(batch, i);
+		ppelib_resource_entry_get_name_utf8(&entry, name, sizeof(name));
+		if (!entry.name != !batch_name || (batch_name && strcmp(batch_name, name) != 0)) {
+			printf("%s: Entry %u has name %s in the batch, %s by itself\n", filename, i, batch_name, name);
+			goto out;
+		}
+
+		subdirectories[i] = entry.directory;
+	}
+
+	// The batch is reused for the subdirectories
+	for (uint32_t i = 0; i < number_of_entries; ++i) {
+		if (subdirectories[i] && !check_directory(filename, subdirectories[i], batch)) {
+			goto out;
+		}
+	}
+
+	retval = 1;
+
+out:
+	free(subdirectories);
+	return retval;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	if (!check_strings()) {
+		return 1;
+	}
+
+	int retval = 1;
+	ppelib_utf8_batch *batch = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_resource_table *table = ppelib_get_resource_table(pe);
+	if (!table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_resource_directory *root = ppelib_resource_table_get_root(table);
+	if (!root) {
+		retval = 0;
+		goto out;
+	}
+
+	batch = ppelib_utf8_batch_create();
+	if (!batch || !check_directory(argv[1], root, batch)) {
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_utf8_batch_destroy(batch);
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -16,65 +16,218 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <ppelib/ppelib-low-level.h>
 #include <ppelib/ppelib.h>
 
+// Names outside of ASCII are skipped, the keys are UTF-8
+static int entry_key(const ppelib_resource_entry *entry, ppelib_resource_key *key, char *name) {
+	key->name = NULL;
+	key->id = entry->id;
+
+	if (!entry->name) {
+		return 1;
+	}
+
+	for (uint16_t i = 0; i < entry->name_length; ++i) {
+		uint16_t c = (uint16_t)(entry->name[i * 2] | (entry->name[i * 2 + 1] << 8));
+		if (!c || c >= 0x80) {
+			return 0;
+		}
+		name[i] = (char)c;
+	}
+	name[entry->name_length] = 0;
+
+	key->name = name;
+	return 1;
+}
+
+// Every resource of the original has to be found with the same data in the table
+// rebuilt from it
+static int compare_tables(const char *filename, ppelib_resource_table *original, ppelib_resource_table *rebuilt) {
+	ppelib_resource_directory *root = ppelib_resource_table_get_root(original);
+
+	char names[3][UINT16_MAX + 1];
+	for (uint32_t t = 0; t < ppelib_resource_directory_get_number_of_entries(root); ++t) {
+		ppelib_resource_entry type;
+		ppelib_resource_key type_key;
+		if (!ppelib_resource_directory_get_entry(root, t, &type)) {
+			printf("%s: PElib-error: %s\n", filename, ppelib_error());
+			return 0;
+		}
+
+		if (!type.directory || !entry_key(&type, &type_key, names[0])) {
+			continue;
+		}
+
+		for (uint32_t n = 0; n < ppelib_resource_directory_get_number_of_entries(type.directory); ++n) {
+			ppelib_resource_entry name;
+			ppelib_resource_key name_key;
+			if (!ppelib_resource_directory_get_entry(type.directory, n, &name)) {
+				printf("%s: PElib-error: %s\n", filename, ppelib_error());
+				return 0;
+			}
+
+			if (!name.directory || !entry_key(&name, &name_key, names[1])) {
+				continue;
+			}
+
+			for (uint32_t l = 0; l < ppelib_resource_directory_get_number_of_entries(name.directory); ++l) {
+				ppelib_resource_entry language;
+				ppelib_resource_key language_key;
+				ppelib_resource_data data;
+				if (!ppelib_resource_directory_get_entry(name.directory, l, &language)) {
+					printf("%s: PElib-error: %s\n", filename, ppelib_error());
+					return 0;
+				}
+
+				if (language.directory || !entry_key(&language, &language_key, names[2])) {
+					continue;
+				}
+
+				if (!ppelib_resource_table_find(rebuilt, &type_key, &name_key, &language_key, &data)) {
+					printf("%s: Resource %u/%u/%u missing\n", filename, t, n, l);
+					return 0;
+				}
+
+				if (data.size != language.data.size || data.codepage != language.data.codepage || !data.data
+						|| memcmp(data.data, language.data.data, data.size) != 0) {
+					printf("%s: Resource %u/%u/%u differs\n", filename, t, n, l);
+					return 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+// A builder that doesn't point into the old table replaces it in place. The builder
+// comes from the handle's context.
+static int check_replace(const char *filename) {
+	int retval = 1;
+	ppelib_handle *pe = NULL;
+	ppelib_resource_builder *builder = NULL;
+	ppelib_context *context = ppelib_context_create(NULL, 0);
+	if (!context) {
+		printf("Failed to create context: %s\n", ppelib_error());
+		return 1;
+	}
+
+	pe = ppelib_context_create_from_file(context, filename);
+	builder = ppelib_context_resource_builder_create(context);
+	if (!pe || !builder) {
+		printf("PElib-error replace: %s\n", ppelib_context_error(context));
+		goto out;
+	}
+
+	uint8_t data[] = "PPELIB_RESOURCE";
+	ppelib_resource_key type = { NULL, 10 };
+	ppelib_resource_key name = { "PPELIB_REPLACE", 0 };
+	ppelib_resource_key language = { NULL, 1033 };
+	if (!ppelib_resource_builder_add(builder, &type, &name, language.id, data, sizeof(data), 0)
+			|| !ppelib_set_resource_table(pe, builder)) {
+		printf("PElib-error replace: %s\n", ppelib_context_error(context));
+		goto out;
+	}
+
+	ppelib_resource_table *table = ppelib_get_resource_table(pe);
+	ppelib_resource_data found;
+	if (!table || !ppelib_resource_table_find(table, &type, &name, &language, &found) || found.size != sizeof(data)
+			|| !found.data || memcmp(found.data, data, sizeof(data)) != 0) {
+		printf("%s: Replaced resource table doesn't hold the new resource\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_resource_builder_destroy(builder);
+	ppelib_destroy(pe);
+	ppelib_context_destroy(context);
+
+	return retval;
+}
+
 int main(int argc, char *argv[]) {
 	if (argc != 3) {
 		printf("Usage: %s <infile> <outfile>\n", argv[0]);
 		return 1;
 	}
 
-	int retval = 0;
-
-	printf("Copying %s to %s\n", argv[1], argv[2]);
+	int retval = 1;
+	ppelib_handle *original = NULL;
+	ppelib_handle *out = NULL;
+	ppelib_resource_builder *builder = NULL;
 
 	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
 	if (ppelib_error()) {
 		printf("PElib-error infile: %s\n", ppelib_error());
-		retval = 1;
-		goto out;
+		return 1;
 	}
 
-	// Get original header
-	ppelib_header_t *header = ppelib_get_header(pe);
-
-	// Recalculate headers
-	ppelib_update_resource_table(pe);
+	original = ppelib_create_from_file(argv[1]);
 	if (ppelib_error()) {
-		printf("PElib-error update_resource_table: %s\n", ppelib_error());
-		ppelib_free_header(header);
+		printf("PElib-error infile: %s\n", ppelib_error());
 		goto out;
 	}
-	ppelib_recalculate(pe);
 
-	// Get new headers
-	ppelib_header_t *header1 = ppelib_get_header(pe);
+	ppelib_resource_table *table = ppelib_get_resource_table(pe);
+	if (!table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
 
-	// Fix up unstable header fields
-	header1->base_of_data = header->base_of_data;
-	header1->size_of_code = header->size_of_code;
-	header1->size_of_uninitialized_data = header->size_of_uninitialized_data;
-	header1->size_of_initialized_data = header->size_of_initialized_data;
+	if (!ppelib_resource_table_get_root(table)) {
+		retval = 0;
+		goto out;
+	}
 
-	ppelib_set_header(pe, header1);
-	if (ppelib_error()) {
-		printf("PElib-error set_header: %s\n", ppelib_error());
+	builder = ppelib_resource_builder_create();
+	if (!builder || !ppelib_resource_builder_add_table(builder, table)) {
+		printf("PElib-error builder: %s\n", ppelib_error());
+		goto out;
 	}
 
-	ppelib_free_header(header);
-	ppelib_free_header(header1);
+	if (!ppelib_set_resource_table(pe, builder)) {
+		printf("PElib-error set_resource_table: %s\n", ppelib_error());
+		goto out;
+	}
 
 	ppelib_write_to_file(pe, argv[2]);
 	if (ppelib_error()) {
 		printf("PElib-error outfile: %s\n", ppelib_error());
-		retval = 1;
 		goto out;
 	}
 
+	out = ppelib_create_from_file(argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error reading outfile: %s\n", ppelib_error());
+		goto out;
+	}
+
+	ppelib_resource_table *rebuilt = ppelib_get_resource_table(out);
+	if (!rebuilt || !ppelib_resource_table_get_root(rebuilt)) {
+		printf("PElib-error rebuilt: %s\n", ppelib_error() ? ppelib_error() : "No resource table");
+		goto out;
+	}
+
+	if (!compare_tables(argv[1], ppelib_get_resource_table(original), rebuilt)) {
+		goto out;
+	}
+
+	if (check_replace(argv[1])) {
+		goto out;
+	}
+
+	retval = 0;
+
 out:
+	ppelib_resource_builder_destroy(builder);
+	ppelib_destroy(out);
+	ppelib_destroy(original);
 	ppelib_destroy(pe);
 
 	return retval;
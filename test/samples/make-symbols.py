@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# Writes symbols.exe: a PE32+ laid out the way MinGW links with -g. The COFF
+# symbol table and its string table follow the section data, section and symbol
+# names longer than 8 characters are stored in the string table. It is larger than a
+# page so handles mapping it reference the file rather than a padded copy.
+
+import struct
+import sys
+
+FILE_ALIGNMENT = 0x200
+SECTION_ALIGNMENT = 0x1000
+
+strings = bytearray()
+
+
+def string_offset(name):
+    global strings
+    offset = 4 + len(strings)
+    strings += name.encode() + b'\0'
+    return offset
+
+
+def section_name(name):
+    if len(name) <= 8:
+        return name.encode().ljust(8, b'\0')
+    return ('/%d' % string_offset(name)).encode().ljust(8, b'\0')
+
+
+def symbol_name(name):
+    if len(name) <= 8:
+        return name.encode().ljust(8, b'\0')
+    return struct.pack('<II', 0, string_offset(name))
+
+
+sections = [
+    ('.text', 0x60000020, b'\x31\xc0\xc3'.ljust(0x1100, b'\xcc')),
+    ('.data', 0xc0000040, bytes(range(32))),
+    ('.debug_info', 0x42000040, b'\x2a' * 0x30),
+]
+
+records = []
+
+
+def symbol(name, value, section_number, type, storage_class, aux=()):
+    records.append(symbol_name(name) + struct.pack('<IhHBB', value, section_number, type, storage_class, len(aux)))
+    for record in aux:
+        records.append(record.ljust(18, b'\0'))
+
+
+symbol('.file', 0, -2, 0, 103, [b'symbols.c'])
+for i, (name, _, contents) in enumerate(sections):
+    symbol(name, 0, i + 1, 0, 3, [struct.pack('<IHH', len(contents), 0, 0)])
+
+symbol('main', 0, 1, 0x20, 2)
+symbol('mainCRTStartup', 0x10, 1, 0x20, 2)
+symbol('_ZN6ppelib7samples7symbolsEv', 0x20, 1, 0x20, 2)
+symbol('__ppelib_static_helper', 0x30, 1, 0x20, 3)
+for i in range(24):
+    symbol('data_%d' % i if i % 2 else 'a_rather_long_variable_name_%d' % i, i, 2, 0, 2)
+symbol('__debug_info_start', 0, 3, 0, 3)
+symbol('duplicate', 0x08, 1, 0x20, 3)
+symbol('duplicate', 0x18, 1, 0x20, 3)
+symbol('__image_base__', 0x140000000 & 0xffffffff, -1, 0, 2)
+symbol('__imp_ExitProcess', 0, 0, 0, 2)
+
+# With three sections there is room for another section header
+section_table_offset = 0x40 + 4 + 20 + 240
+headers_size = (section_table_offset + 40 * len(sections) + FILE_ALIGNMENT - 1) & ~(FILE_ALIGNMENT - 1)
+
+raw = bytearray()
+section_headers = bytearray()
+pointer = headers_size
+rva = SECTION_ALIGNMENT
+size_of_code = 0
+size_of_initialized_data = 0
+for name, characteristics, contents in sections:
+    size = (len(contents) + FILE_ALIGNMENT - 1) & ~(FILE_ALIGNMENT - 1)
+    section_headers += section_name(name) + struct.pack('<IIIIIIHHI', len(contents), rva, size, pointer, 0, 0, 0, 0,
+                                                        characteristics)
+    raw += contents.ljust(size, b'\0')
+    pointer += size
+    rva += (len(contents) + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1)
+
+    if characteristics & 0x20:
+        size_of_code += size
+    elif characteristics & 0x40:
+        size_of_initialized_data += size
+
+symbol_table_offset = pointer
+image_size = rva
+
+dos = bytearray(0x40)
+dos[0:2] = b'MZ'
+struct.pack_into('<I', dos, 0x3c, 0x40)
+
+coff = struct.pack('<HHIIIHH', 0x8664, len(sections), 0, symbol_table_offset, len(records), 240, 0x0026)
+
+optional = struct.pack('<HBBIIIIIQIIHHHHHHIIIIHHQQQQII', 0x20b, 2, 38, size_of_code, size_of_initialized_data, 0,
+                       SECTION_ALIGNMENT, SECTION_ALIGNMENT,
+                       0x140000000, SECTION_ALIGNMENT, FILE_ALIGNMENT, 4, 0, 0, 0, 5, 2, 0, image_size, headers_size,
+                       0, 3, 0x8160, 0x200000, 0x1000, 0x100000, 0x1000, 0, 16)
+optional += bytes(16 * 8)
+
+headers = (dos + b'PE\0\0' + coff + optional + section_headers).ljust(headers_size, b'\0')
+
+image = headers + raw + b''.join(records) + struct.pack('<I', 4 + len(strings)) + strings
+open(sys.argv[1] if len(sys.argv) > 1 else 'symbols.exe', 'wb').write(image)
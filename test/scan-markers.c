@@ -0,0 +1,159 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib.h>
+
+static const struct {
+	uint32_t marker;
+	size_t size;
+	const char *bytes;
+} markers[] = {
+	{ PPELIB_MARKER_MZ, 2, "MZ" },
+	{ PPELIB_MARKER_PE, 4, "PE\0\0" },
+	{ PPELIB_MARKER_RICH, 4, "Rich" },
+	{ PPELIB_MARKER_VLV, 4, "VLV\0" },
+};
+
+#define ALL_MARKERS (PPELIB_MARKER_MZ | PPELIB_MARKER_PE | PPELIB_MARKER_RICH | PPELIB_MARKER_VLV)
+
+static size_t naive_scan(const uint8_t *buffer, size_t size, uint32_t mask, ppelib_marker_match *matches) {
+	size_t number_of_matches = 0;
+	for (size_t i = 0; i < size; ++i) {
+		for (size_t j = 0; j < sizeof(markers) / sizeof(markers[0]); ++j) {
+			if ((mask & markers[j].marker) && markers[j].size <= size - i
+					&& memcmp(buffer + i, markers[j].bytes, markers[j].size) == 0) {
+				matches[number_of_matches].offset = i;
+				matches[number_of_matches].marker = markers[j].marker;
+				++number_of_matches;
+			}
+		}
+	}
+
+	return number_of_matches;
+}
+
+// Compares the scanner against a byte at a time scan for every combination of markers,
+// or for large buffers only for all of them and each one alone
+static int check(const char *name, const uint8_t *buffer, size_t size, ppelib_marker_match *expected,
+		ppelib_marker_match *matches) {
+	for (uint32_t scan_mask = 1; scan_mask <= ALL_MARKERS; ++scan_mask) {
+		if (size > 4096 && scan_mask != ALL_MARKERS && (scan_mask & (scan_mask - 1))) {
+			continue;
+		}
+
+		size_t number_of_expected = naive_scan(buffer, size, scan_mask, expected);
+		size_t number_of_matches = ppelib_scan_markers(buffer, size, scan_mask, matches, size);
+		if (ppelib_error()) {
+			printf("PElib-error: %s\n", ppelib_error());
+			return 1;
+		}
+
+		if (number_of_matches != number_of_expected) {
+			printf("%s: %zu matches for markers %X, expected %zu\n", name, number_of_matches, scan_mask,
+					number_of_expected);
+			return 1;
+		}
+
+		for (size_t i = 0; i < number_of_matches; ++i) {
+			if (matches[i].offset != expected[i].offset || matches[i].marker != expected[i].marker) {
+				printf("%s: match %zu is %X at %zu, expected %X at %zu\n", name, i, matches[i].marker,
+						matches[i].offset, expected[i].marker, expected[i].offset);
+				return 1;
+			}
+		}
+
+		// Only the count without room for matches
+		if (ppelib_scan_markers(buffer, size, scan_mask, NULL, 0) != number_of_expected) {
+			printf("%s: Counting matches differs from storing them\n", name);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <infile>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if (!f) {
+		printf("Failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size_t size = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	int retval = 1;
+	uint8_t *buffer = malloc(size + 1);
+	uint8_t *planted = malloc(size + 1);
+	ppelib_marker_match *expected = malloc((size + 1) * sizeof(ppelib_marker_match));
+	ppelib_marker_match *matches = malloc((size + 1) * sizeof(ppelib_marker_match));
+	if (!buffer || !planted || !expected || !matches || fread(buffer, 1, size, f) != size) {
+		printf("Failed to read %s\n", argv[1]);
+		goto out;
+	}
+
+	if (check(argv[1], buffer, size, expected, matches)) {
+		goto out;
+	}
+
+	// Every alignment and tail length, to cover the vector blocks and the bytes after them
+	size_t window = size < 1024 ? size : 1024;
+	for (size_t i = 1; i < 64 && i < window; ++i) {
+		if (check(argv[1], buffer + i, window - i, expected, matches)
+				|| check(argv[1], buffer, window - i, expected, matches)) {
+			goto out;
+		}
+	}
+
+	// Markers across the block boundaries and cut off at the end
+	memcpy(planted, buffer, size);
+	const size_t positions[] = { 0, 14, 15, 30, 31, 32, 254, 255, 256, 287, 288 };
+	for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+		const size_t j = i % (sizeof(markers) / sizeof(markers[0]));
+		if (positions[i] + markers[j].size <= size) {
+			memcpy(planted + positions[i], markers[j].bytes, markers[j].size);
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(markers) / sizeof(markers[0]) && markers[i].size <= size; ++i) {
+		memcpy(planted + size - markers[i].size, markers[i].bytes, markers[i].size);
+		if (check(argv[1], planted, size, expected, matches) || check(argv[1], planted, size - 1, expected, matches)) {
+			goto out;
+		}
+	}
+
+	retval = 0;
+
+out:
+	fclose(f);
+	free(buffer);
+	free(planted);
+	free(expected);
+	free(matches);
+
+	return retval;
+}
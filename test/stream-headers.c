@@ -0,0 +1,101 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// Feed the file in small chunks and check the headers come out the same as
+// when parsing it in one go.
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 0;
+	ppelib_stream *stream = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if (!f) {
+		printf("Failed to open %s\n", argv[1]);
+		retval = 1;
+		goto out;
+	}
+
+	stream = ppelib_stream_create();
+
+	uint8_t chunk[61];
+	enum ppelib_stream_state state = PPELIB_STREAM_MZ_SIGNATURE;
+	size_t chunk_size;
+	while ((chunk_size = fread(chunk, 1, sizeof(chunk), f))) {
+		state = ppelib_stream_feed(stream, chunk, chunk_size);
+		if (state == PPELIB_STREAM_DONE || state == PPELIB_STREAM_ERROR) {
+			break;
+		}
+	}
+	fclose(f);
+
+	if (state != PPELIB_STREAM_DONE && state != PPELIB_STREAM_ERROR) {
+		state = ppelib_stream_finish(stream);
+	}
+
+	if (state != PPELIB_STREAM_DONE) {
+		printf("%s: Stream didn't finish: %s\n", argv[1], ppelib_error());
+		retval = 1;
+		goto out;
+	}
+
+	ppelib_handle *pe2 = ppelib_stream_get_handle(stream);
+
+	if (ppelib_header_compare(ppelib_header_get(pe), ppelib_header_get(pe2))) {
+		printf("%s: Header mismatch between file and stream\n", argv[1]);
+		retval = 1;
+		goto out;
+	}
+
+	uint16_t sections = ppelib_header_get_number_of_sections(ppelib_header_get(pe));
+	for (uint16_t i = 0; i < sections; ++i) {
+		const ppelib_section *s1 = ppelib_section_get(pe, i);
+		const ppelib_section *s2 = ppelib_section_get(pe2, i);
+
+		if (strcmp(ppelib_section_get_name(s1), ppelib_section_get_name(s2)) != 0 ||
+				ppelib_section_get_pointer_to_raw_data(s1) != ppelib_section_get_pointer_to_raw_data(s2) ||
+				ppelib_section_get_size_of_raw_data(s1) != ppelib_section_get_size_of_raw_data(s2)) {
+			printf("%s: Section %i mismatch between file and stream\n", argv[1], i);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	printf("%s: Stream headers match\n", argv[1]);
+
+out:
+	ppelib_stream_destroy(stream);
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -0,0 +1,114 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// Every named symbol has to be found again by name, and every symbol that belongs
+// to a section by its address
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_symbol_table *symbol_table = ppelib_get_symbol_table(pe);
+	if (!symbol_table) {
+		printf("PElib-error: %s\n", ppelib_error());
+		goto out;
+	}
+
+	uint32_t size = ppelib_symbol_table_get_size(symbol_table);
+	if (ppelib_header_get_number_of_symbols(ppelib_header_get(pe)) && !size) {
+		printf("%s: Symbol table is empty\n", argv[1]);
+		goto out;
+	}
+
+	uint32_t previous_record_index = 0;
+	for (uint32_t i = 0; i < size; ++i) {
+		ppelib_symbol symbol;
+		ppelib_symbol found;
+
+		if (!ppelib_symbol_table_get(symbol_table, i, &symbol)) {
+			printf("%s: Symbol %u missing\n", argv[1], i);
+			goto out;
+		}
+
+		if (i && symbol.record_index <= previous_record_index) {
+			printf("%s: Symbol %u out of order\n", argv[1], i);
+			goto out;
+		}
+		previous_record_index = symbol.record_index;
+
+		if (!symbol.number_of_aux_symbols != !symbol.aux) {
+			printf("%s: Symbol %u auxiliary records mismatch\n", argv[1], i);
+			goto out;
+		}
+
+		if (symbol.name && (!ppelib_symbol_table_find(symbol_table, symbol.name, &found) || strcmp(found.name, symbol.name) != 0)) {
+			printf("%s: Symbol %s not found by name\n", argv[1], symbol.name);
+			goto out;
+		}
+
+		if (!symbol.section_number || symbol.section_number >= 0x8000) {
+			continue;
+		}
+
+		if (!ppelib_symbol_table_find_address(symbol_table, symbol.section_number, symbol.value, &found)
+				|| found.value != symbol.value || found.section_number != symbol.section_number) {
+			printf("%s: Symbol %u not found by address\n", argv[1], i);
+			goto out;
+		}
+
+		uint32_t indexes[16];
+		size_t count = ppelib_symbol_table_find_range(symbol_table, symbol.section_number, symbol.value,
+				symbol.value + 1, indexes, 16);
+		uint8_t in_range = count > 16;
+		for (size_t l = 0; l < count && l < 16; ++l) {
+			in_range |= indexes[l] == i;
+		}
+
+		if (!in_range) {
+			printf("%s: Symbol %u not found in its range\n", argv[1], i);
+			goto out;
+		}
+	}
+
+	if (ppelib_symbol_table_find(symbol_table, "ppelib_no_such_symbol", NULL)) {
+		printf("%s: Found a symbol that doesn't exist\n", argv[1]);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	ppelib_destroy(pe);
+
+	return retval;
+}
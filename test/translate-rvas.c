@@ -0,0 +1,120 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+// The first section in table order holding the RVA, the way the lookup used to work
+static const ppelib_section *find_section(ppelib_handle *pe, uint16_t number_of_sections, uint32_t rva) {
+	for (uint16_t i = 0; i < number_of_sections; ++i) {
+		const ppelib_section *section = ppelib_section_get(pe, i);
+		size_t start = ppelib_section_get_virtual_address(section);
+		size_t end = start + ppelib_section_get_size_of_raw_data(section);
+
+		if (start <= rva && end > rva) {
+			return section;
+		}
+	}
+
+	return NULL;
+}
+
+// Translate every RVA around the section boundaries and a sweep over the image
+// and compare against a linear scan.
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s <filename>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+	uint32_t *rvas = NULL;
+	ppelib_rva_location *locations = NULL;
+
+	ppelib_handle *pe = ppelib_create_from_file(argv[1]);
+	if (ppelib_error()) {
+		printf("PElib-error: %s\n", ppelib_error());
+		return 1;
+	}
+
+	ppelib_header *header = ppelib_header_get(pe);
+	uint16_t number_of_sections = ppelib_header_get_number_of_sections(header);
+	uint32_t size_of_image = ppelib_header_get_size_of_image(header);
+
+	size_t sweep = 4096;
+	size_t count = sweep + (size_t)number_of_sections * 4;
+	rvas = malloc(sizeof(uint32_t) * count);
+	locations = malloc(sizeof(ppelib_rva_location) * count);
+	if (!rvas || !locations) {
+		printf("Out of memory\n");
+		goto out;
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < sweep; ++i) {
+		rvas[n++] = (uint32_t)((uint64_t)size_of_image * i / (sweep - 1));
+	}
+
+	for (uint16_t i = 0; i < number_of_sections; ++i) {
+		const ppelib_section *section = ppelib_section_get(pe, i);
+		uint32_t start = ppelib_section_get_virtual_address(section);
+		uint32_t end = start + ppelib_section_get_size_of_raw_data(section);
+
+		rvas[n++] = start - 1;
+		rvas[n++] = start;
+		rvas[n++] = end - 1;
+		rvas[n++] = end;
+	}
+
+	size_t expected_found = 0;
+	size_t found = ppelib_translate_rvas(pe, rvas, n, locations);
+	for (size_t i = 0; i < n; ++i) {
+		const ppelib_section *section = find_section(pe, number_of_sections, rvas[i]);
+		if (section) {
+			++expected_found;
+		}
+
+		if (locations[i].section != section) {
+			printf("%s: RVA 0x%08X found in the wrong section\n", argv[1], rvas[i]);
+			goto out;
+		}
+
+		if (section && (locations[i].offset != rvas[i] - ppelib_section_get_virtual_address(section)
+				|| locations[i].file_offset != ppelib_section_get_pointer_to_raw_data(section) + locations[i].offset)) {
+			printf("%s: RVA 0x%08X translated to the wrong offset\n", argv[1], rvas[i]);
+			goto out;
+		}
+	}
+
+	if (found != expected_found) {
+		printf("%s: Found %zu RVAs, expected %zu\n", argv[1], found, expected_found);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	free(rvas);
+	free(locations);
+	ppelib_destroy(pe);
+
+	return retval;
+}
@@ -0,0 +1,294 @@
+/* Copyright 2021 Hein-Pieter van Braam-Stewart
+ *
+ * This file is part of ppelib (Portable Portable Executable LIBrary)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ppelib/ppelib-low-level.h>
+#include <ppelib/ppelib.h>
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t)ftell(f);
+	rewind(f);
+
+	uint8_t *buffer = malloc(*size);
+	if (buffer && fread(buffer, 1, *size, f) != *size) {
+		free(buffer);
+		buffer = NULL;
+	}
+
+	fclose(f);
+	return buffer;
+}
+
+static int write_file(const char *filename, const uint8_t *buffer, size_t size) {
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		return 1;
+	}
+
+	size_t written = fwrite(buffer, 1, size, f);
+	fclose(f);
+
+	return written != size;
+}
+
+// The patched file has to parse into the same image as the handle it was written from
+static int compare(ppelib_handle *pe, const char *filename) {
+	int retval = 1;
+	uint8_t *b1 = NULL;
+	uint8_t *b2 = NULL;
+
+	ppelib_handle *pe2 = ppelib_create_from_file(filename);
+	if (ppelib_error()) {
+		printf("PElib-error reading patched file: %s\n", ppelib_error());
+		return 1;
+	}
+
+	size_t len1 = ppelib_write_to_buffer(pe, NULL, 0);
+	size_t len2 = ppelib_write_to_buffer(pe2, NULL, 0);
+	if (len1 != len2) {
+		printf("%s: Size mismatch between handle and patched file\n", filename);
+		goto out;
+	}
+
+	b1 = malloc(len1);
+	b2 = malloc(len2);
+	ppelib_write_to_buffer(pe, b1, len1);
+	ppelib_write_to_buffer(pe2, b2, len2);
+
+	if (memcmp(b1, b2, len1) != 0) {
+		printf("%s: Content mismatch between handle and patched file\n", filename);
+		goto out;
+	}
+
+	retval = 0;
+
+out:
+	free(b1);
+	free(b2);
+	ppelib_destroy(pe2);
+
+	return retval;
+}
+
+static char **symbol_names(ppelib_handle *pe, uint32_t *size) {
+	ppelib_symbol_table *symbol_table = ppelib_get_symbol_table(pe);
+	*size = symbol_table ? ppelib_symbol_table_get_size(symbol_table) : 0;
+
+	char **names = calloc(*size + 1, sizeof(char *));
+	for (uint32_t i = 0; names && i < *size; ++i) {
+		ppelib_symbol symbol;
+		if (ppelib_symbol_table_get(symbol_table, i, &symbol) && symbol.name) {
+			names[i] = strdup(symbol.name);
+		}
+	}
+
+	return names;
+}
+
+static void free_names(char **names, uint32_t size) {
+	for (uint32_t i = 0; names && i < size; ++i) {
+		free(names[i]);
+	}
+
+	free(names);
+}
+
+static int resources_grow(ppelib_handle *pe, const char *filename) {
+	int retval = 1;
+	uint32_t size = 0;
+	char **names = symbol_names(pe, &size);
+	uint8_t *data = calloc(65536, 1);
+	ppelib_resource_builder *builder = ppelib_resource_builder_create();
+
+	if (!names || !data || !builder) {
+		printf("Failed to allocate\n");
+		goto out;
+	}
+
+	ppelib_resource_table *resource_table = ppelib_get_resource_table(pe);
+	if (resource_table) {
+		ppelib_resource_builder_add_table(builder, resource_table);
+	}
+
+	ppelib_resource_key type = { NULL, 10 };
+	ppelib_resource_key name = { "PPELIB_WRITE_CHANGES", 0 };
+	if (!ppelib_resource_builder_add(builder, &type, &name, 1033, data, 65536, 0)
+			|| !ppelib_set_resource_table(pe, builder)) {
+		// Not every file can take a larger resource table
+		retval = 0;
+		goto out;
+	}
+
+	ppelib_write_changes_to_file(pe, filename);
+	if (ppelib_error()) {
+		printf("PElib-error resources: %s\n", ppelib_error());
+		goto out;
+	}
+
+	if (compare(pe, filename)) {
+		goto out;
+	}
+
+	ppelib_symbol_table *symbol_table = ppelib_get_symbol_table(pe);
+	for (uint32_t i = 0; i < size; ++i) {
+		ppelib_symbol symbol;
+		if (!ppelib_symbol_table_get(symbol_table, i, &symbol) || !symbol.name != !names[i]
+				|| (names[i] && strcmp(symbol.name, names[i]) != 0)) {
+			printf("%s: Symbol %u changed name after the tail moved\n", filename, i);
+			goto out;
+		}
+	}
+
+	retval = 0;
+
+out:
+	ppelib_resource_builder_destroy(builder);
+	free(data);
+	free_names(names, size);
+
+	return retval;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		printf("Usage: %s <infile> <workfile>\n", argv[0]);
+		return 1;
+	}
+
+	int retval = 1;
+	size_t size = 0;
+	size_t patched_size = 0;
+	uint8_t *patched = NULL;
+	size_t written_size = 0;
+	uint8_t *written = NULL;
+	ppelib_handle *pe = NULL;
+
+	uint8_t *original = read_file(argv[1], &size);
+	if (!original || write_file(argv[2], original, size)) {
+		printf("Failed to copy %s to %s\n", argv[1], argv[2]);
+		goto out;
+	}
+
+	pe = ppelib_create_from_file_mapped(argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error infile: %s\n", ppelib_error());
+		goto out;
+	}
+
+	// Nothing changed, nothing to write
+	ppelib_write_changes_to_file(pe, argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error unmodified: %s\n", ppelib_error());
+		goto out;
+	}
+
+	patched = read_file(argv[2], &patched_size);
+	if (!patched || patched_size != size || memcmp(original, patched, size) != 0) {
+		printf("%s: Unmodified handle changed the file\n", argv[1]);
+		goto out;
+	}
+	free(patched);
+
+	// A header field only touches the headers. They have to match writing the whole
+	// file, everything after them has to be left as it was.
+	ppelib_header *header = ppelib_header_get(pe);
+	ppelib_header_set_time_date_stamp(header, ~ppelib_header_get_time_date_stamp(header));
+
+	ppelib_write_changes_to_file(pe, argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error header: %s\n", ppelib_error());
+		goto out;
+	}
+
+	patched = read_file(argv[2], &patched_size);
+	if (!patched || patched_size != size) {
+		printf("%s: Header change resized the file\n", argv[1]);
+		goto out;
+	}
+
+	written_size = ppelib_write_to_buffer(pe, NULL, 0);
+	written = malloc(written_size);
+	if (!written || ppelib_write_to_buffer(pe, written, written_size) != written_size) {
+		printf("PElib-error writing: %s\n", ppelib_error());
+		goto out;
+	}
+
+	size_t size_of_headers = ppelib_header_get_size_of_headers(header);
+	if (size_of_headers > size || written_size < size_of_headers) {
+		size_of_headers = size < written_size ? size : written_size;
+	}
+
+	if (memcmp(written, patched, size_of_headers) != 0) {
+		printf("%s: Header change differs from writing the whole file\n", argv[1]);
+		goto out;
+	}
+
+	if (memcmp(original + size_of_headers, patched + size_of_headers, size - size_of_headers) != 0) {
+		printf("%s: Header change rewrote more than the headers\n", argv[1]);
+		goto out;
+	}
+
+	if (compare(pe, argv[2])) {
+		goto out;
+	}
+
+	// Growing the overlay only appends
+	size_t overlay_size = ppelib_get_overlay_size(pe);
+	uint8_t *overlay = calloc(overlay_size + 4096, 1);
+	if (overlay_size) {
+		memcpy(overlay, ppelib_get_overlay_data(pe), overlay_size);
+	}
+	memset(overlay + overlay_size, 0xcc, 4096);
+	ppelib_set_overlay_data(pe, overlay, overlay_size + 4096);
+	free(overlay);
+
+	ppelib_write_changes_to_file(pe, argv[2]);
+	if (ppelib_error()) {
+		printf("PElib-error overlay: %s\n", ppelib_error());
+		goto out;
+	}
+
+	if (compare(pe, argv[2])) {
+		goto out;
+	}
+
+	// Growing the resources moves the tail of the file, symbol names resolved through
+	// the string table must not change with it
+	if (resources_grow(pe, argv[2])) {
+		goto out;
+	}
+
+	printf("%s: Patched file matches\n", argv[1]);
+	retval = 0;
+
+out:
+	free(original);
+	free(patched);
+	free(written);
+	ppelib_destroy(pe);
+
+	return retval;
+}